@@ -0,0 +1,108 @@
+// Readers of a sync::ArcSwap against readers of a std::atomic<std::shared_ptr> and of a
+// std::shared_ptr behind a std::mutex, from 1 to 64 threads, while one more thread replaces the
+// value every 100us. The loads are split over the readers, so a flat time per load is perfect
+// scaling. A SafeVal is not in the race, its borrows throw instead of waiting for the writer
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <atomic>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace rs;
+
+constexpr usize Loads = usize(1) << 22;
+constexpr int Runs = 3;
+
+struct Config {
+	u64 timeout;
+	u64 retries;
+};
+
+// One run, timed from the moment all the readers are started until the last one is done
+template<typename Read, typename Write>
+static double run_once(usize readers, Read& read, Write& write) {
+	auto start = std::latch(static_cast<std::ptrdiff_t>(readers + 1));
+	auto done = std::atomic<bool>(false);
+	auto writer = std::thread([&] {
+		auto version = u64(0);
+		while (!done.load(std::memory_order_relaxed)) {
+			write(++version);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+
+	auto workers = std::vector<std::thread>();
+	for (usize reader = 0; reader < readers; reader++) {
+		workers.emplace_back([&] {
+			auto sum = u64(0);
+			start.arrive_and_wait();
+			for (usize i = 0; i < Loads / readers; i++) {
+				sum += read();
+			}
+			bench::keep(sum);
+		});
+	}
+
+	auto begin = bench::Clock::now();
+	start.arrive_and_wait();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	auto ns = std::chrono::duration<double, std::nano>(bench::Clock::now() - begin).count();
+
+	done.store(true, std::memory_order_relaxed);
+	writer.join();
+	return ns;
+}
+
+// Spreads Loads calls of read() over readers, the best of a few runs
+template<typename Read, typename Write>
+static double run(usize readers, Read read, Write write) {
+	auto best = 1e300;
+	for (int i = 0; i < Runs; i++) {
+		best = std::min(best, run_once(readers, read, write));
+	}
+	return best;
+}
+
+int main() {
+	auto swap = sync::ArcSwap<Config>(Config{ 30, 3 });
+	auto atomic = std::atomic<std::shared_ptr<const Config>>(std::make_shared<const Config>(Config{ 30, 3 }));
+	auto shared = std::make_shared<const Config>(Config{ 30, 3 });
+	auto lock = std::mutex();
+
+	std::printf("%zu loads, a store every 100us, best of %d runs\n", Loads, Runs);
+
+	for (usize readers : { 1, 2, 4, 8, 16, 32, 64 }) {
+		char label[96];
+
+		std::snprintf(label, sizeof(label), "ArcSwap::load, %zu readers", readers);
+		bench::report(label, run(readers,
+			[&] { return swap.load()->timeout; },
+			[&](u64 version) { swap.store(Config{ version, 3 }); }), Loads);
+
+		std::snprintf(label, sizeof(label), "std::atomic<std::shared_ptr>, %zu readers", readers);
+		bench::report(label, run(readers,
+			[&] { return atomic.load()->timeout; },
+			[&](u64 version) { atomic.store(std::make_shared<const Config>(Config{ version, 3 })); }), Loads);
+
+		std::snprintf(label, sizeof(label), "std::mutex + std::shared_ptr, %zu readers", readers);
+		bench::report(label, run(readers,
+			[&] {
+				auto lock_guard = std::lock_guard(lock);
+				auto snapshot = shared;
+				return snapshot->timeout;
+			},
+			[&](u64 version) {
+				auto next = std::make_shared<const Config>(Config{ version, 3 });
+				auto lock_guard = std::lock_guard(lock);
+				shared = std::move(next);
+			}), Loads);
+	}
+
+	return 0;
+}
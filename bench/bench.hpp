@@ -0,0 +1,39 @@
+// The timing helpers shared by the benchmarks, each benchmark is a plain main() built on these
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace bench {
+
+	using Clock = std::chrono::steady_clock;
+
+	// Hides a value from the optimizer, so the work that produced it is not thrown away
+	template<typename Type>
+	inline void keep(const Type& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "m"(value) : "memory");
+#else
+		static const void* volatile s_Sink;
+		s_Sink = &value;
+#endif
+	}
+
+	// Runs f a few times and returns the best of the runs in nanoseconds
+	template<typename F>
+	inline double best_ns(int runs, F&& f) {
+		auto best = 1e300;
+		for (int i = 0; i < runs; i++) {
+			auto start = Clock::now();
+			f();
+			best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	// One row of a table: what was measured, the time of a run and the time per operation
+	inline void report(const char* name, double ns, double operations) {
+		std::printf("%-52s %10.3f ms %10.2f ns/op\n", name, ns / 1e6, ns / operations);
+	}
+}
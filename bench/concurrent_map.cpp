@@ -0,0 +1,120 @@
+// A sync::ConcurrentMap against a std::unordered_map behind one std::shared_mutex, for a read
+// mostly load (95% lookups) and a write heavy one (50% updates), from 1 to 64 threads. The
+// operations are split over the threads, so a flat time per operation is perfect scaling
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <latch>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace rs;
+
+constexpr u64 Keys = u64(1) << 16;
+constexpr usize Operations = usize(1) << 21;
+constexpr int Runs = 3;
+
+// Does what the map does under the one lock that the shards of a ConcurrentMap replace
+class LockedMap {
+public:
+	inline auto get(u64 key) const {
+		auto lock = std::shared_lock(m_Lock);
+		auto found = m_Map.find(key);
+		return found == m_Map.end() ? u64(0) : found->second;
+	}
+
+	inline void add(u64 key, u64 value) {
+		auto lock = std::unique_lock(m_Lock);
+		m_Map[key] += value;
+	}
+
+private:
+	mutable std::shared_mutex m_Lock;
+	std::unordered_map<u64, u64> m_Map;
+};
+
+// A xorshift per thread, std::mt19937 would be a good part of what is measured
+static inline u64 next(u64& state) {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+// One run, timed from the moment all the threads are started
+template<typename F>
+static double run_once(usize threads, F& operation) {
+	auto start = std::latch(static_cast<std::ptrdiff_t>(threads + 1));
+	auto workers = std::vector<std::thread>();
+	for (usize thread = 0; thread < threads; thread++) {
+		workers.emplace_back([&, thread] {
+			auto state = u64(0x9e3779b97f4a7c15) * (thread + 1);
+			start.arrive_and_wait();
+			for (usize i = 0; i < Operations / threads; i++) {
+				operation(state);
+			}
+		});
+	}
+
+	auto begin = bench::Clock::now();
+	start.arrive_and_wait();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return std::chrono::duration<double, std::nano>(bench::Clock::now() - begin).count();
+}
+
+// Runs Operations calls of operation(state) spread over threads, the best of a few runs
+template<typename F>
+static double run(usize threads, F operation) {
+	auto best = 1e300;
+	for (int i = 0; i < Runs; i++) {
+		best = std::min(best, run_once(threads, operation));
+	}
+	return best;
+}
+
+int main() {
+	auto map = sync::ConcurrentMap<u64, u64>();
+	auto locked = LockedMap();
+	for (u64 key = 0; key < Keys; key++) {
+		map.insert(key, key);
+		locked.add(key, key);
+	}
+
+	std::printf("%llu keys, %zu operations, best of %d runs\n", static_cast<unsigned long long>(Keys), Operations, Runs);
+
+	for (auto [name, writes] : { std::pair("read mostly", u64(5)), std::pair("write heavy", u64(50)) }) {
+		for (usize threads : { 1, 2, 4, 8, 16, 32, 64 }) {
+			char label[96];
+
+			std::snprintf(label, sizeof(label), "%s, ConcurrentMap, %zu threads", name, threads);
+			bench::report(label, run(threads, [&](u64& state) {
+				auto random = next(state);
+				auto key = random % Keys;
+				if ((random >> 32) % 100 < writes) {
+					**map.get_mut(key).unwrap() += 1;
+				}
+				else {
+					bench::keep(**map.get(key).unwrap());
+				}
+			}), Operations);
+
+			std::snprintf(label, sizeof(label), "%s, shared_mutex + unordered_map, %zu threads", name, threads);
+			bench::report(label, run(threads, [&](u64& state) {
+				auto random = next(state);
+				auto key = random % Keys;
+				if ((random >> 32) % 100 < writes) {
+					locked.add(key, 1);
+				}
+				else {
+					bench::keep(locked.get(key));
+				}
+			}), Operations);
+		}
+	}
+
+	return 0;
+}
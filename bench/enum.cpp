@@ -0,0 +1,69 @@
+// Dispatching on an Enum with match against a std::variant with std::visit, for 2 to 32
+// alternatives picked at random so the branch predictor can not learn the order
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <random>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace rs;
+
+template<usize I>
+struct Alternative {
+	u32 value;
+};
+
+constexpr usize Count = usize(1) << 20;
+constexpr int Runs = 5;
+
+template<usize... Is>
+static void run(std::index_sequence<Is...>) {
+	using E = Enum<Alternative<Is>...>;
+	using V = std::variant<Alternative<Is>...>;
+	constexpr auto Alternatives = sizeof...(Is);
+
+	auto enums = std::vector<E>();
+	auto variants = std::vector<V>();
+	auto random = std::mt19937(42);
+	for (usize i = 0; i < Count; i++) {
+		auto index = random() % Alternatives;
+		auto value = static_cast<u32>(i);
+		((index == Is ? (enums.push_back(Alternative<Is>{ value }), variants.push_back(Alternative<Is>{ value }), 0) : 0), ...);
+	}
+
+	// Every alternative does something different, so the dispatch can not be folded away
+	auto visit = []<usize I>(const Alternative<I>& alternative) -> u32 { return alternative.value * (I + 1); };
+
+	char label[96];
+	std::snprintf(label, sizeof(label), "match, Enum of %zu", Alternatives);
+	bench::report(label, bench::best_ns(Runs, [&] {
+		auto sum = u32(0);
+		for (const auto& e : enums) {
+			sum += match(e, visit);
+		}
+		bench::keep(sum);
+	}), Count);
+
+	std::snprintf(label, sizeof(label), "std::visit, std::variant of %zu", Alternatives);
+	bench::report(label, bench::best_ns(Runs, [&] {
+		auto sum = u32(0);
+		for (const auto& v : variants) {
+			sum += std::visit(visit, v);
+		}
+		bench::keep(sum);
+	}), Count);
+}
+
+int main() {
+	std::printf("%zu values, best of %d runs\n", Count, Runs);
+
+	run(std::make_index_sequence<2>());
+	run(std::make_index_sequence<4>());
+	run(std::make_index_sequence<8>());
+	run(std::make_index_sequence<16>());
+	run(std::make_index_sequence<32>());
+
+	return 0;
+}
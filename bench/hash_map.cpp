@@ -0,0 +1,115 @@
+// A HashMap against std::unordered_map: inserting, looking up keys that are there and keys that
+// are not, iterating and removing, each with its default hasher
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace rs;
+
+int main() {
+	constexpr usize Count = usize(1) << 20;
+	constexpr int Runs = 5;
+
+	// the keys that are inserted and keys that are not, in a different order for the lookups
+	auto keys = std::vector<u64>(Count);
+	auto misses = std::vector<u64>(Count);
+	auto random = std::mt19937_64(42);
+	for (usize i = 0; i < Count; i++) {
+		keys[i] = random() | 1;
+		misses[i] = random() & ~u64(1);
+	}
+	auto lookups = keys;
+	std::shuffle(lookups.begin(), lookups.end(), random);
+
+	std::printf("%zu u64 keys, best of %d runs\n", Count, Runs);
+
+	bench::report("insert, HashMap", bench::best_ns(Runs, [&] {
+		auto map = HashMap<u64, u64>();
+		for (auto key : keys) {
+			map.insert(key, key);
+		}
+		bench::keep(map);
+	}), Count);
+
+	bench::report("insert, std::unordered_map", bench::best_ns(Runs, [&] {
+		auto map = std::unordered_map<u64, u64>();
+		for (auto key : keys) {
+			map.insert_or_assign(key, key);
+		}
+		bench::keep(map);
+	}), Count);
+
+	auto map = HashMap<u64, u64>();
+	auto standard = std::unordered_map<u64, u64>();
+	for (auto key : keys) {
+		map.insert(key, key);
+		standard.insert_or_assign(key, key);
+	}
+
+	bench::report("lookup hit, HashMap", bench::best_ns(Runs, [&] {
+		auto sum = u64(0);
+		for (auto key : lookups) {
+			sum += *map.get(key).unwrap();
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("lookup hit, std::unordered_map", bench::best_ns(Runs, [&] {
+		auto sum = u64(0);
+		for (auto key : lookups) {
+			sum += standard.find(key)->second;
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("lookup miss, HashMap", bench::best_ns(Runs, [&] {
+		auto found = usize(0);
+		for (auto key : misses) {
+			found += map.contains_key(key);
+		}
+		bench::keep(found);
+	}), Count);
+
+	bench::report("lookup miss, std::unordered_map", bench::best_ns(Runs, [&] {
+		auto found = usize(0);
+		for (auto key : misses) {
+			found += standard.contains(key);
+		}
+		bench::keep(found);
+	}), Count);
+
+	bench::report("iterate, HashMap", bench::best_ns(Runs, [&] {
+		auto sum = u64(0);
+		for (auto [key, value] : map.iter()) {
+			sum += value;
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("iterate, std::unordered_map", bench::best_ns(Runs, [&] {
+		auto sum = u64(0);
+		for (const auto& [key, value] : standard) {
+			sum += value;
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("remove, HashMap", bench::best_ns(1, [&] {
+		for (auto key : lookups) {
+			map.remove(key);
+		}
+		bench::keep(map);
+	}), Count);
+
+	bench::report("remove, std::unordered_map", bench::best_ns(1, [&] {
+		for (auto key : lookups) {
+			standard.erase(key);
+		}
+		bench::keep(standard);
+	}), Count);
+
+	return 0;
+}
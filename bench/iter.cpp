@@ -0,0 +1,72 @@
+// Iterator chains against the loops they should compile into: a fused map/filter/sum, a plain sum
+// (which Iter hands to the SIMD kernels of the slices) and the same chain with std::views
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <numeric>
+#include <ranges>
+
+using namespace rs;
+
+int main() {
+	constexpr usize Count = usize(1) << 24;
+	constexpr int Runs = 10;
+
+	auto values = Vec<u32>::with_capacity(Count);
+	for (usize i = 0; i < Count; i++) {
+		values.push(static_cast<u32>(i * 2654435761u));
+	}
+	auto data = values.as_ptr();
+
+	std::printf("%zu u32 values, best of %d runs\n", Count, Runs);
+
+	bench::report("map/filter/sum, hand written loop", bench::best_ns(Runs, [&] {
+		u32 sum = 0;
+		for (usize i = 0; i < Count; i++) {
+			auto x = data[i] * 3;
+			if (x % 5 == 0) {
+				sum += x;
+			}
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("map/filter/sum, Iter", bench::best_ns(Runs, [&] {
+		auto sum = values.iter()
+			.map([](u32 x) { return x * 3; })
+			.filter([](u32 x) { return x % 5 == 0; })
+			.sum();
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("map/filter/sum, std::views", bench::best_ns(Runs, [&] {
+		auto view = std::views::all(values)
+			| std::views::transform([](u32 x) { return x * 3; })
+			| std::views::filter([](u32 x) { return x % 5 == 0; });
+		u32 sum = 0;
+		for (auto x : view) {
+			sum += x;
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("sum, hand written loop", bench::best_ns(Runs, [&] {
+		u32 sum = 0;
+		for (usize i = 0; i < Count; i++) {
+			sum += data[i];
+		}
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("sum, Iter", bench::best_ns(Runs, [&] {
+		auto sum = values.iter().sum();
+		bench::keep(sum);
+	}), Count);
+
+	bench::report("sum, std::accumulate", bench::best_ns(Runs, [&] {
+		auto sum = std::accumulate(data, data + Count, u32(0));
+		bench::keep(sum);
+	}), Count);
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+// Scaling of a parallel map/reduce with the number of workers, against the same chain on iter().
+// The thread pool is global and sized once, so every worker count runs in a process of its own
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <string>
+
+using namespace rs;
+
+// Enough work per element that the memory bandwidth is not all that is measured
+static inline u64 mix(u64 x) {
+	for (int i = 0; i < 8; i++) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+	}
+	return x;
+}
+
+// 100M elements, 800MB, so the work outweighs the cost of splitting it at every worker count
+static auto make_values() {
+	constexpr usize Count = 100'000'000;
+	auto values = Vec<u64>::with_capacity(Count);
+	for (usize i = 0; i < Count; i++) {
+		values.push(i);
+	}
+	return values;
+}
+
+int main(int argc, char** argv) {
+	constexpr int Runs = 5;
+
+	auto values = make_values();
+	auto count = static_cast<double>(values.len());
+
+	if (argc < 2) {
+		bench::report("map/sum, iter()", bench::best_ns(Runs, [&] {
+			auto sum = values.iter().map([](const u64& x) { return mix(x); }).sum();
+			bench::keep(sum);
+		}), count);
+		std::fflush(stdout);
+
+		for (auto threads : { 1, 2, 4, 8, 16, 32, 64 }) {
+			auto command = "RS_NUM_THREADS=" + std::to_string(threads) + " " + argv[0] + " run";
+			if (std::system(command.c_str()) != 0) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	auto threads = std::getenv("RS_NUM_THREADS");
+	auto label = [&](const char* what) {
+		static char buffer[96];
+		std::snprintf(buffer, sizeof(buffer), "%s, %s workers", what, threads);
+		return buffer;
+	};
+
+	bench::report(label("map/sum, par_iter()"), bench::best_ns(Runs, [&] {
+		auto sum = values.par_iter().map([](const u64& x) { return mix(x); }).sum();
+		bench::keep(sum);
+	}), count);
+
+	bench::report(label("map/reduce(max), par_iter()"), bench::best_ns(Runs, [&] {
+		auto max = values.par_iter()
+			.map([](const u64& x) { return mix(x); })
+			.reduce([] { return u64(0); }, [](u64 a, u64 b) { return std::max(a, b); });
+		bench::keep(max);
+	}), count);
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Handing a value down a chain of 10 calls and back, like foo0 = pass_through(foo0) in the README:
+// a Val and a SafeVal passed as lvalues and with std::move, against a std::unique_ptr and a plain
+// value. The calls are kept out of line, so every level really passes its argument on
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <memory>
+
+using namespace rs;
+
+struct Foo {
+	u64 x;
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+template<int Depth, typename Type>
+BENCH_NOINLINE Type pass_through(Type value) {
+	if constexpr (Depth == 0) {
+		return value;
+	}
+	else {
+		return pass_through<Depth - 1>(value);
+	}
+}
+
+template<int Depth, typename Type>
+BENCH_NOINLINE Type pass_through_moved(Type value) {
+	if constexpr (Depth == 0) {
+		return value;
+	}
+	else {
+		return pass_through_moved<Depth - 1>(std::move(value));
+	}
+}
+
+int main() {
+	constexpr usize Count = usize(1) << 22;
+	constexpr int Runs = 5;
+	constexpr int Depth = 10;
+
+	std::printf("%zu round trips through %d calls, best of %d runs\n", Count, Depth, Runs);
+
+	auto val = Val<Foo>(Foo{ 1 });
+	bench::report("Val<T>, passed as an lvalue", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			val = pass_through<Depth>(val);
+		}
+		bench::keep(val);
+	}), Count);
+
+	bench::report("Val<T>, std::move", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			val = pass_through_moved<Depth>(std::move(val));
+		}
+		bench::keep(val);
+	}), Count);
+
+	auto safe = SafeVal<Foo>(Foo{ 1 });
+	bench::report("SafeVal<T>, passed as an lvalue", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			safe = pass_through<Depth>(safe);
+		}
+		bench::keep(safe);
+	}), Count);
+
+	bench::report("SafeVal<T>, std::move", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			safe = pass_through_moved<Depth>(std::move(safe));
+		}
+		bench::keep(safe);
+	}), Count);
+
+	auto unique = std::make_unique<Foo>(Foo{ 1 });
+	bench::report("std::unique_ptr<T>, std::move", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			unique = pass_through_moved<Depth>(std::move(unique));
+		}
+		bench::keep(unique);
+	}), Count);
+
+	auto plain = Foo{ 1 };
+	bench::report("T, by value", bench::best_ns(Runs, [&] {
+		for (usize i = 0; i < Count; i++) {
+			plain = pass_through<Depth>(plain);
+		}
+		bench::keep(plain);
+	}), Count);
+
+	if (!val.is_valid() || !safe.is_valid() || val->x != 1 || safe->x != 1 || unique->x != 1) {
+		std::puts("a value got lost on the way");
+		return 1;
+	}
+	return 0;
+}
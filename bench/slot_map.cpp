@@ -0,0 +1,94 @@
+// A SlotMap against the scattered std::vector<Val<T*>> it replaces: inserting, iterating and
+// removing at random positions
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace rs;
+
+struct Particle {
+	f32 x, y, vx, vy;
+};
+
+int main() {
+	constexpr usize Count = usize(1) << 20;
+	constexpr int Runs = 5;
+
+	// the order in which the values are removed, the same for both
+	auto order = std::vector<u32>(Count);
+	for (usize i = 0; i < Count; i++) {
+		order[i] = static_cast<u32>(i);
+	}
+	std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+	std::printf("%zu particles, best of %d runs\n", Count, Runs);
+
+	bench::report("insert, SlotMap", bench::best_ns(Runs, [&] {
+		auto map = SlotMap<Particle>();
+		for (usize i = 0; i < Count; i++) {
+			map.insert(Particle{ f32(i), 0, 1, 1 });
+		}
+		bench::keep(map);
+	}), Count);
+
+	bench::report("insert, std::vector<Val<T*>>", bench::best_ns(Runs, [&] {
+		auto values = std::vector<Val<Particle*>>();
+		for (usize i = 0; i < Count; i++) {
+			values.push_back(Val<Particle*>(new Particle{ f32(i), 0, 1, 1 }));
+		}
+		bench::keep(values);
+	}), Count);
+
+	auto map = SlotMap<Particle>();
+	auto keys = std::vector<SlotKey>();
+	auto pointers = std::vector<Particle*>();
+	for (usize i = 0; i < Count; i++) {
+		keys.push_back(map.insert(Particle{ f32(i), 0, 1, 1 }));
+		pointers.push_back(new Particle{ f32(i), 0, 1, 1 });
+	}
+	// the pointers of the vector end up as scattered as those of a long running program
+	std::shuffle(pointers.begin(), pointers.end(), std::mt19937(7));
+	auto values = std::vector<Val<Particle*>>();
+	for (auto pointer : pointers) {
+		values.push_back(Val<Particle*>(pointer));
+	}
+
+	bench::report("iterate and update, SlotMap", bench::best_ns(Runs, [&] {
+		for (auto& particle : map.iter_mut()) {
+			particle.x += particle.vx;
+			particle.y += particle.vy;
+		}
+		bench::keep(map);
+	}), Count);
+
+	bench::report("iterate and update, std::vector<Val<T*>>", bench::best_ns(Runs, [&] {
+		for (auto& value : values) {
+			value->x += value->vx;
+			value->y += value->vy;
+		}
+		bench::keep(values);
+	}), Count);
+
+	bench::report("remove at random, SlotMap", bench::best_ns(1, [&] {
+		for (auto index : order) {
+			map.remove(keys[index]);
+		}
+		bench::keep(map);
+	}), Count);
+
+	bench::report("remove at random, std::vector<Val<T*>>", bench::best_ns(1, [&] {
+		// a swap remove, the vector has no stable keys so the position stands in for one
+		for (auto index : order) {
+			auto position = index % values.size();
+			if (position + 1 != values.size()) {
+				values[position] = std::move(values.back());
+			}
+			values.pop_back();
+		}
+		bench::keep(values);
+	}), Count);
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+// Round trips of a TCP echo server and its clients over loopback, all running on one Runtime,
+// with 1 to 32 workers
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <cstring>
+
+using namespace rs;
+
+using Error = std::error_code;
+
+constexpr usize MessageSize = 64;
+
+static auto echo(net::TcpStream stream) -> Task<Result<usize, Error>> {
+	u8 buffer[4096];
+	for (;;) {
+		auto n = co_await stream.read(SliceMut<u8>::from_raw_parts(buffer, sizeof(buffer))).propagate();
+		if (n == 0) {
+			co_return Ok<usize, Error>(0);
+		}
+		co_await stream.write_all(Slice<u8>::from_raw_parts(buffer, n)).propagate();
+	}
+}
+
+static auto serve_one(net::TcpStream stream) -> Task<void> {
+	auto result = co_await echo(std::move(stream));
+	(void)result;
+}
+
+static auto accept_all(Runtime& runtime, net::TcpListener& listener, usize clients) -> Task<void> {
+	for (usize i = 0; i < clients; i++) {
+		auto stream = co_await listener.accept();
+		if (stream.is_ok()) {
+			runtime.spawn(serve_one(std::move(*stream.unwrap())));
+		}
+	}
+}
+
+static auto client(u16 port, usize rounds) -> Task<Result<usize, Error>> {
+	auto stream = co_await net::TcpStream::connect("127.0.0.1", port).propagate();
+	u8 out[MessageSize];
+	u8 in[MessageSize];
+	std::memset(out, 7, sizeof(out));
+
+	for (usize round = 0; round < rounds; round++) {
+		co_await stream.write_all(Slice<u8>::from_raw_parts(out, MessageSize)).propagate();
+		usize have = 0;
+		while (have < MessageSize) {
+			auto n = co_await stream.read(SliceMut<u8>::from_raw_parts(in + have, MessageSize - have)).propagate();
+			if (n == 0) {
+				co_return Err<usize, Error>(std::make_error_code(std::errc::connection_reset));
+			}
+			have += n;
+		}
+	}
+	co_return Ok<usize, Error>(std::move(rounds));
+}
+
+static auto report_to(u16 port, usize rounds, sync::Sender<usize> done) -> Task<void> {
+	auto result = co_await client(port, rounds);
+	done.send(result.is_ok() ? *result.unwrap() : 0);
+}
+
+static auto run(Runtime& runtime, usize clients, usize rounds) -> Task<usize> {
+	auto listener = std::move(*net::TcpListener::bind("127.0.0.1", 0).unwrap());
+	runtime.spawn(accept_all(runtime, listener, clients));
+
+	auto [tx, rx] = sync::channel<usize>();
+	for (usize i = 0; i < clients; i++) {
+		runtime.spawn(report_to(listener.local_port(), rounds, tx));
+	}
+	{
+		auto drop = std::move(tx);
+	}
+
+	usize total = 0;
+	for (;;) {
+		auto done = co_await rx.recv();
+		if (done.is_none()) {
+			break;
+		}
+		total += *done.unwrap();
+	}
+	co_return total;
+}
+
+int main() {
+	constexpr usize Clients = 64;
+	constexpr usize Rounds = 500;
+
+	std::printf("%zu clients, %zu round trips of %zu bytes each\n", Clients, Rounds, MessageSize);
+	for (usize workers : { 1, 2, 4, 8, 16, 32 }) {
+		auto runtime = Runtime(workers);
+		auto completed = usize(0);
+		auto ns = bench::best_ns(3, [&] { completed = runtime.block_on(run(runtime, Clients, Rounds)); });
+		if (completed != Clients * Rounds) {
+			std::printf("only %zu of %zu round trips completed\n", completed, Clients * Rounds);
+			return 1;
+		}
+
+		char label[64];
+		std::snprintf(label, sizeof(label), "echo round trip, %zu workers", workers);
+		bench::report(label, ns, static_cast<double>(Clients * Rounds));
+	}
+	return 0;
+}
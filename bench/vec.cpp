@@ -0,0 +1,52 @@
+// Pushing into a Vec against a std::vector, without reserving, for payloads that are trivially
+// relocatable: a u64, a 64 byte struct and a std::unique_ptr, which a Vec moves with a memcpy
+// when it grows and a std::vector moves one by one
+#include "rusty.hpp"
+#include "bench.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace rs;
+
+struct Particle {
+	f32 position[4];
+	f32 velocity[4];
+	u64 padding[4];
+};
+
+constexpr usize Count = usize(1) << 20;
+constexpr int Runs = 5;
+
+template<typename Make>
+static void run(const char* name, Make make) {
+	char label[96];
+
+	std::snprintf(label, sizeof(label), "push, Vec<%s>", name);
+	bench::report(label, bench::best_ns(Runs, [&] {
+		auto values = Vec<decltype(make(0))>();
+		for (usize i = 0; i < Count; i++) {
+			values.push(make(i));
+		}
+		bench::keep(values);
+	}), Count);
+
+	std::snprintf(label, sizeof(label), "push_back, std::vector<%s>", name);
+	bench::report(label, bench::best_ns(Runs, [&] {
+		auto values = std::vector<decltype(make(0))>();
+		for (usize i = 0; i < Count; i++) {
+			values.push_back(make(i));
+		}
+		bench::keep(values);
+	}), Count);
+}
+
+int main() {
+	std::printf("%zu values, best of %d runs\n", Count, Runs);
+
+	run("u64", [](usize i) { return static_cast<u64>(i); });
+	run("Particle", [](usize i) { return Particle{ { f32(i) }, { 1.0f }, { i } }; });
+	run("std::unique_ptr<u64>", [](usize i) { return std::make_unique<u64>(i); });
+
+	return 0;
+}
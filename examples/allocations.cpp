@@ -0,0 +1,110 @@
+// Everything created inside of a ResourceScope takes its memory from the scope's resource:
+// the global operator new is replaced by one that counts its calls and it must not be called at all
+#include "rusty.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+
+using namespace rs;
+
+static auto s_GlobalNews = usize(0);
+
+void* operator new(std::size_t size) {
+	s_GlobalNews++;
+	if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	s_GlobalNews++;
+	auto align = static_cast<std::size_t>(alignment);
+	if (auto ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+// Counts what reaches the resource, so the example also shows that the memory went somewhere
+class CountingResource : public std::pmr::memory_resource {
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream)
+		: m_Upstream(upstream)
+	{
+	}
+
+	usize allocations = 0;
+
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		allocations++;
+		return m_Upstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+		m_Upstream->deallocate(ptr, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+	std::pmr::memory_resource* m_Upstream;
+};
+
+int main() {
+	static auto buffer = std::array<std::byte, 256 * 1024>();
+	auto mono = std::pmr::monotonic_buffer_resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+	auto counting = CountingResource(&mono);
+
+	auto before = s_GlobalNews;
+	auto total = i64(0);
+	{
+		auto scope = ResourceScope(&counting);
+
+		auto val = Val<i32>(5);
+		auto safe = SafeVal<i32>(6);
+		{
+			auto ref = val.borrow();
+			auto safeRef = safe.borrow();
+			total += *ref + *safeRef;
+		}
+		{
+			auto ref = val.borrow_mut();
+			*ref += 1;
+		}
+
+		auto some = Some<i32>(7);
+		total += *some.unwrap();
+
+		auto vec = Vec<i32>();
+		for (i32 i = 0; i < 1000; i++) {
+			vec.push(i);
+		}
+		total += vec.iter().sum();
+
+		auto map = HashMap<i32, i32>();
+		for (i32 i = 0; i < 1000; i++) {
+			map.insert(i, i * 2);
+		}
+		total += *map.get(10).unwrap();
+		total += *val.borrow();
+	}
+	auto news = s_GlobalNews - before;
+
+	std::printf("total %lld, %zu allocations from the resource, %zu calls to the global operator new\n", static_cast<long long>(total), counting.allocations, news);
+	if (news != 0 || counting.allocations == 0) {
+		std::puts("something inside of the ResourceScope bypassed its resource");
+		return 1;
+	}
+	return 0;
+}
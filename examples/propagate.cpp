@@ -0,0 +1,52 @@
+// An Err propagated through three levels of tasks: leaf fails, mid and top return it without
+// running any of their code after the propagate()
+#include "rusty.hpp"
+
+#include <cstdio>
+
+using namespace rs;
+
+static auto s_MidContinued = false;
+static auto s_TopContinued = false;
+
+auto leaf(bool fail) -> Task<Result<i32, str>> {
+	if (fail) {
+		co_return Err<i32, str>(str("leaf failed"));
+	}
+	co_return Ok<i32, str>(1);
+}
+
+auto mid(bool fail) -> Task<Result<i32, str>> {
+	auto value = co_await leaf(fail).propagate();
+	s_MidContinued = true;
+	co_return Ok<i32, str>(value + 10);
+}
+
+auto top(bool fail) -> Task<Result<i32, str>> {
+	auto value = co_await mid(fail).propagate();
+	s_TopContinued = true;
+	co_return Ok<i32, str>(value + 100);
+}
+
+int main() {
+	auto ok = block_on(top(false));
+	if (!ok.is_ok() || *ok.unwrap() != 111 || !s_MidContinued || !s_TopContinued) {
+		std::puts("the Ok path did not reach top");
+		return 1;
+	}
+
+	s_MidContinued = false;
+	s_TopContinued = false;
+	auto err = block_on(top(true));
+	if (!err.is_err() || *err.unwrap_err() != "leaf failed") {
+		std::puts("the Err of leaf did not reach top");
+		return 1;
+	}
+	if (s_MidContinued || s_TopContinued) {
+		std::puts("a task was resumed after its propagate() got an Err");
+		return 1;
+	}
+
+	std::puts("the Err of leaf went through mid and top untouched");
+	return 0;
+}
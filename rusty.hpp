@@ -27,6 +27,38 @@ SOFTWARE.
 
 #define RS_EXPORT // A hack for now...
 
+// Checked mode keeps the borrow expiry checks on the fast paths that are allowed to drop them,
+// it defaults to on unless NDEBUG is defined
+#ifndef RS_CHECKED
+	#ifdef NDEBUG
+		#define RS_CHECKED 0
+	#else
+		#define RS_CHECKED 1
+	#endif
+#endif
+
+// The slice scans use SIMD kernels picked at runtime on x86 with GCC and Clang,
+// everything else (or defining RS_NO_SIMD) gets the scalar versions
+#if !defined(RS_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	#define RS_SIMD_X86 1
+#else
+	#define RS_SIMD_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define RS_ALWAYS_INLINE inline __attribute__((always_inline))
+	#define RS_NOINLINE __attribute__((noinline))
+	#define RS_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER)
+	#define RS_ALWAYS_INLINE __forceinline
+	#define RS_NOINLINE __declspec(noinline)
+	#define RS_TARGET(isa)
+#else
+	#define RS_ALWAYS_INLINE inline
+	#define RS_NOINLINE
+	#define RS_TARGET(isa)
+#endif
+
 // C++ Headers
 #include <sstream>
 #include <fstream>
@@ -35,17 +67,56 @@ SOFTWARE.
 #include <string>
 #include <numeric>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <initializer_list>
 #include <format>
 #include <optional>
+#include <variant>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <ranges>
 #include <utility>
 #include <functional>
 #include <exception>
+#include <vector>
+#include <deque>
+#include <array>
+#include <tuple>
+#include <thread>
+#include <condition_variable>
+#include <coroutine>
+#include <chrono>
+#include <stdexcept>
+#include <bit>
+#include <span>
+#include <unordered_map>
+#include <system_error>
+#include <cerrno>
 #include <assert.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if RS_SIMD_X86
+#include <immintrin.h>
+#endif
+
 // Types
 namespace rs
 {
@@ -195,6 +266,15 @@ namespace rs
 				return "ResultRaw is Err!";
 			}
 		};
+
+		class IndexOutOfBoundsException : public std::exception
+		{
+		public:
+			const char* what() const noexcept override
+			{
+				return "Index is out of bounds!";
+			}
+		};
 	}
 
 #ifdef RS_EXPORT
@@ -219,6 +299,189 @@ namespace rs {
 	template<typename Type, typename Err, bool ThreadSafe>
 	class ResultRaw;
 
+	template<typename Type, bool Mutability>
+	class TraitView;
+
+	template<typename Type, bool Mutability>
+	class SliceRaw;
+
+	template<typename Type, usize InlineCapacity, typename Growth>
+	class VecRaw;
+
+	template<typename ElementType>
+	class SliceIter;
+
+	template<typename Source>
+	class Iter;
+
+	template<typename Iterable>
+	inline auto iter(Iterable&& iterable);
+
+	template<typename Producer>
+	class ParIter;
+
+	template<typename Type>
+	class ArenaVal;
+
+	template<typename Type>
+	class SlotMap;
+
+	template<typename Key, typename Value, typename Hasher>
+	class HashMap;
+
+	template<typename Key, typename Hasher>
+	class HashSet;
+
+	template<typename Type>
+	class OnceCell;
+
+	template<typename Type>
+	class RefCell;
+
+	template<typename Type>
+	class Cow;
+
+	template<typename... Variants>
+	class Enum;
+
+	namespace internal::par {
+		template<typename Type, bool Mutability>
+		class SliceProducer;
+
+		template<typename Type>
+		class ChunksProducer;
+	}
+
+	namespace internal::iter {
+		template<typename Type>
+		class Once;
+
+		template<typename Source, bool Mutability>
+		class Loaned;
+
+		template<typename Type>
+		struct option_traits;
+
+		template<typename Type>
+		struct result_traits;
+	}
+
+	/*
+	* The equivalents of Rust's Send and Sync. IsSend<T> says whether a T may be moved to another
+	* thread, IsSync<T> whether a T may be used from several threads at once through references.
+	*
+	* Types with ThreadSafe = false keep their borrow counters in plain integers, so they are neither,
+	* everything holding them (Vec, Option, std containers) derives the markers from what it holds.
+	* Other types are assumed to be both, a user type that wraps non thread safe state opts out (or
+	* derives the markers from its fields) by specializing the traits:
+	*
+	*	template<> struct rs::IsSend<Foo> : rs::IsSend<std::tuple<Val<i32>, str>> {};
+	*	template<> struct rs::IsSync<Foo> : std::false_type {};
+	*
+	* The threading APIs require them for everything they move or share between threads. Closures
+	* can not be looked into, so what a lambda captures is still up to the caller.
+	*/
+	template<typename Type>
+	struct IsSend : std::true_type {};
+
+	template<typename Type>
+	struct IsSync : std::true_type {};
+
+	template<typename Type>
+	concept Send = IsSend<std::remove_cvref_t<Type>>::value;
+
+	template<typename Type>
+	concept Sync = IsSync<std::remove_cvref_t<Type>>::value;
+
+	template<typename Type, bool ThreadSafe>
+	struct IsSend<ValRaw<Type, ThreadSafe>> : std::bool_constant<ThreadSafe && Send<Type>> {};
+
+	template<typename Type, bool ThreadSafe>
+	struct IsSync<ValRaw<Type, ThreadSafe>> : std::bool_constant<ThreadSafe && Sync<Type>> {};
+
+	// A shared ref moved to another thread shares the value, a mutable one moves access to it
+	template<typename Type, bool Mutability, bool ThreadSafe>
+	struct IsSend<RefRaw<Type, Mutability, ThreadSafe>> : std::bool_constant<ThreadSafe && (Mutability ? Send<Type> : Sync<Type>)> {};
+
+	template<typename Type, bool Mutability, bool ThreadSafe>
+	struct IsSync<RefRaw<Type, Mutability, ThreadSafe>> : std::bool_constant<ThreadSafe && Sync<Type>> {};
+
+	template<typename Type, bool ThreadSafe>
+	struct IsSend<OptionRaw<Type, ThreadSafe>> : std::bool_constant<ThreadSafe && Send<Type>> {};
+
+	template<typename Type, bool ThreadSafe>
+	struct IsSync<OptionRaw<Type, ThreadSafe>> : std::bool_constant<ThreadSafe && Sync<Type>> {};
+
+	template<typename Type, typename Err, bool ThreadSafe>
+	struct IsSend<ResultRaw<Type, Err, ThreadSafe>> : std::bool_constant<ThreadSafe && Send<Type> && Send<Err>> {};
+
+	template<typename Type, typename Err, bool ThreadSafe>
+	struct IsSync<ResultRaw<Type, Err, ThreadSafe>> : std::bool_constant<ThreadSafe && Sync<Type> && Sync<Err>> {};
+
+	// Slices and trait views hold a non thread safe loan of what they point into, its count is
+	// written when they are copied or dropped, so they can not be sent or shared. The parallel
+	// iterators keep the loan on the calling thread and hand the workers raw parts instead
+	template<typename Type, bool Mutability>
+	struct IsSend<SliceRaw<Type, Mutability>> : std::false_type {};
+
+	template<typename Type, bool Mutability>
+	struct IsSync<SliceRaw<Type, Mutability>> : std::false_type {};
+
+	template<typename Type, bool Mutability>
+	struct IsSend<TraitView<Type, Mutability>> : std::false_type {};
+
+	template<typename Type, bool Mutability>
+	struct IsSync<TraitView<Type, Mutability>> : std::false_type {};
+
+	template<typename Type, usize InlineCapacity, typename Growth>
+	struct IsSend<VecRaw<Type, InlineCapacity, Growth>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type, usize InlineCapacity, typename Growth>
+	struct IsSync<VecRaw<Type, InlineCapacity, Growth>> : std::bool_constant<Sync<Type>> {};
+
+	template<typename Type>
+	struct IsSend<std::optional<Type>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type>
+	struct IsSync<std::optional<Type>> : std::bool_constant<Sync<Type>> {};
+
+	template<typename Type, typename Allocator>
+	struct IsSend<std::vector<Type, Allocator>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type, typename Allocator>
+	struct IsSync<std::vector<Type, Allocator>> : std::bool_constant<Sync<Type>> {};
+
+	template<typename Type, usize N>
+	struct IsSend<std::array<Type, N>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type, usize N>
+	struct IsSync<std::array<Type, N>> : std::bool_constant<Sync<Type>> {};
+
+	template<typename First, typename Second>
+	struct IsSend<std::pair<First, Second>> : std::bool_constant<Send<First> && Send<Second>> {};
+
+	template<typename First, typename Second>
+	struct IsSync<std::pair<First, Second>> : std::bool_constant<Sync<First> && Sync<Second>> {};
+
+	template<typename... Types>
+	struct IsSend<std::tuple<Types...>> : std::bool_constant<(Send<Types> && ...)> {};
+
+	template<typename... Types>
+	struct IsSync<std::tuple<Types...>> : std::bool_constant<(Sync<Types> && ...)> {};
+
+	template<typename Type, typename Deleter>
+	struct IsSend<std::unique_ptr<Type, Deleter>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type, typename Deleter>
+	struct IsSync<std::unique_ptr<Type, Deleter>> : std::bool_constant<Sync<Type>> {};
+
+	// Every copy of a shared_ptr can reach the value, so moving one is sharing the value
+	template<typename Type>
+	struct IsSend<std::shared_ptr<Type>> : std::bool_constant<Send<Type> && Sync<Type>> {};
+
+	template<typename Type>
+	struct IsSync<std::shared_ptr<Type>> : std::bool_constant<Send<Type> && Sync<Type>> {};
+
 	template<typename Type>
 	concept IsRefRaw = requires(Type t) {
 		{ t.is_ref_mutable() } -> std::same_as<bool>;
@@ -240,6 +503,71 @@ namespace rs {
 	template <typename Type>
 	concept IsSmartPtrOrRawPtr = IsSmartPtr<Type> || IsRawPtr<Type>;
 
+	namespace internal {
+		// Where the owning types created on this thread allocate from, null for the global allocator
+		inline thread_local RawPtr<std::pmr::memory_resource> t_Resource = nullptr;
+
+		template<typename Type, typename... Args>
+		inline auto resource_new(RawPtr<std::pmr::memory_resource> resource, Args&&... args) -> RawPtr<Type> {
+			if (resource == nullptr) {
+				return new Type(std::forward<Args>(args)...);
+			}
+
+			auto memory = resource->allocate(sizeof(Type), alignof(Type));
+			try {
+				return new (memory) Type(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				resource->deallocate(memory, sizeof(Type), alignof(Type));
+				throw;
+			}
+		}
+
+		template<typename Type>
+		inline void resource_delete(RawPtr<std::pmr::memory_resource> resource, RawPtr<Type> ptr) {
+			if (resource == nullptr) {
+				delete ptr;
+				return;
+			}
+
+			std::destroy_at(ptr);
+			resource->deallocate(ptr, sizeof(Type), alignof(Type));
+		}
+	}
+
+	/*
+	* Routes the allocations of the owning types to a std::pmr::memory_resource (a
+	* monotonic_buffer_resource, a pool per NUMA node, huge pages, ...) while it is alive.
+	*
+	* Every Val, Option, Result and Vec created on this thread inside the scope allocates its
+	* control block (and the mutex of the thread safe ones) or its buffer from the resource and
+	* remembers it, so it is given back to the right resource wherever it is dropped. The
+	* resource must outlive everything created in the scope. Scopes nest, the innermost wins.
+	*/
+	class ResourceScope {
+	public:
+		inline explicit ResourceScope(RawPtr<std::pmr::memory_resource> resource) noexcept
+			: m_Previous(internal::t_Resource)
+		{
+			internal::t_Resource = resource;
+		}
+
+		inline ResourceScope(const ResourceScope&) = delete;
+		inline auto operator=(const ResourceScope&) -> ResourceScope& = delete;
+
+		inline ~ResourceScope() {
+			internal::t_Resource = m_Previous;
+		}
+
+		// The resource the owning types use on this thread, null if they use the global allocator
+		static inline auto current() noexcept {
+			return internal::t_Resource;
+		}
+
+	private:
+		RawPtr<std::pmr::memory_resource> m_Previous;
+	};
+
 	template<bool ThreadSafe>
 	class ValidityCheckBlock
 	{
@@ -250,7 +578,8 @@ namespace rs {
 		inline auto operator=(const ValidityCheckBlock& other)->ValidityCheckBlock & = delete;
 		inline auto operator=(ValidityCheckBlock&& other)->ValidityCheckBlock & = delete;
 
-		inline ValidityCheckBlock(bool validity) : m_Validity(validity), m_RefCounter(1) {}
+		inline ValidityCheckBlock(bool validity, RawPtr<std::pmr::memory_resource> resource = nullptr)
+			: m_Validity(validity), m_RefCounter(1), m_Resource(resource) {}
 
 		inline ~ValidityCheckBlock() = default;
 
@@ -274,9 +603,19 @@ namespace rs {
 			return m_RefCounter;
 		}
 
+		inline auto validity_flag() const {
+			return &m_Validity;
+		}
+
+		// What the block (and the mutex of its checker) was allocated from
+		inline auto resource() const {
+			return m_Resource;
+		}
+
 	private:
 		std::conditional_t<ThreadSafe, std::atomic_bool, bool> m_Validity = true;
 		std::conditional_t<ThreadSafe, std::atomic_uint32_t, u32> m_RefCounter = 0;
+		RawPtr<std::pmr::memory_resource> m_Resource;
 	};
 
 
@@ -295,9 +634,17 @@ namespace rs {
 
 		inline ValidityChecker(bool value)
 		{
-			m_Block = new ValidityCheckBlock<ThreadSafe>(value);
+			auto resource = internal::t_Resource;
+			m_Block = internal::resource_new<ValidityCheckBlock<ThreadSafe>>(resource, value, resource);
 			if constexpr (ThreadSafe) {
-				m_Mutex = new std::mutex();
+				// The destructor does not run when a constructor throws, so the block is freed here
+				try {
+					m_Mutex = internal::resource_new<std::mutex>(resource);
+				}
+				catch (...) {
+					internal::resource_delete(resource, m_Block);
+					throw;
+				}
 			}
 		}
 
@@ -307,7 +654,9 @@ namespace rs {
 			if constexpr (ThreadSafe) {
 				m_Mutex = other.m_Mutex;
 			}
-			m_Block->increment();
+			if (m_Block != nullptr) {
+				m_Block->increment();
+			}
 		}
 
 		inline ValidityChecker(ValidityChecker&& other) noexcept
@@ -317,7 +666,9 @@ namespace rs {
 				m_Mutex = other.m_Mutex;
 			}
 			other.m_Block = nullptr;
-			other.m_Mutex = nullptr;
+			if constexpr (ThreadSafe) {
+				other.m_Mutex = nullptr;
+			}
 		}
 
 		inline auto operator=(const ValidityChecker& other) -> ValidityChecker& {
@@ -327,12 +678,14 @@ namespace rs {
 				if constexpr (ThreadSafe) {
 					m_Mutex = other.m_Mutex;
 				}
-				m_Block->increment();
+				if (m_Block != nullptr) {
+					m_Block->increment();
+				}
 			}
 			return *this;
 		}
 
-		inline auto operator=(ValidityChecker&& other) -> ValidityChecker& {
+		inline auto operator=(ValidityChecker&& other) noexcept -> ValidityChecker& {
 			if (this != &other) {
 				reset();
 				m_Block = other.m_Block;
@@ -356,19 +709,20 @@ namespace rs {
 
 				if constexpr (ThreadSafe) {
 					bool didDrop = false;
+					auto resource = m_Block->resource();
 					{
 						std::lock_guard<std::mutex> lock(*m_Mutex);
 						m_Block->decrement();
 
 						if (m_Block->get_ref_count() == 0) {
-							delete m_Block;
+							internal::resource_delete(resource, m_Block);
 							m_Block = nullptr;
 							didDrop = true;
 						}
 					}
 
 					if (didDrop) {
-						delete m_Mutex;
+						internal::resource_delete(resource, m_Mutex);
 						m_Mutex = nullptr;
 					}
 				}
@@ -376,7 +730,7 @@ namespace rs {
 					m_Block->decrement();
 
 					if (m_Block->get_ref_count() == 0) {
-						delete m_Block;
+						internal::resource_delete(m_Block->resource(), m_Block);
 						m_Block = nullptr;
 					}
 				}
@@ -399,6 +753,11 @@ namespace rs {
 			m_Block->drop();
 		}
 
+		// The flag stays readable for as long as this checker holds on to the block
+		inline auto validity_flag() const {
+			return m_Block->validity_flag();
+		}
+
 		inline void swap(ValidityChecker& other) {
 			std::swap(m_Block, other.m_Block);
 			if constexpr (ThreadSafe) {
@@ -407,30 +766,35 @@ namespace rs {
 		}
 
 
-		inline auto get_mutex() {
+		inline auto get_mutex() requires(ThreadSafe) {
 			return m_Mutex;
 		}
 
 	private:
 		RawPtr<ValidityCheckBlock<ThreadSafe>> m_Block;
-		std::conditional_t<ThreadSafe, RawPtr<std::mutex>, bool> m_Mutex;
+		// Only the thread safe checker has a mutex, the other one is just the pointer to the block
+		[[no_unique_address]] std::conditional_t<ThreadSafe, RawPtr<std::mutex>, std::monostate> m_Mutex;
 	};
 
+	namespace internal {
+		// The mutable borrow flag of a borrow word that holds the immutable count as well (ValRaw)
+		inline constexpr u32 MutableBorrow = 1u << 31;
+	}
+
 	template<typename Type, bool Mutability, bool ThreadSafe>
 	class RefRaw {
 	public:
-		using RefBackType = std::conditional_t<Mutability,
-			std::conditional_t<ThreadSafe, std::atomic_bool, bool>,
-			std::conditional_t<ThreadSafe, std::atomic_uint32_t, u32>>;
+		// The immutable borrow count or the mutable borrow flag of the owner, the flag is a u32 as well
+		// so a ValRaw can keep both in the same word. Releasing a mutable borrow stores 0 into it
+		using RefBackType = std::conditional_t<ThreadSafe, std::atomic_uint32_t, u32>;
 
 		using ValueType = std::conditional_t<Mutability, RawPtr<std::remove_pointer_t<Type>>, RawPtr<std::remove_pointer_t<Type> const>>;
 
 		inline RefRaw(RefRaw&& other) noexcept
-			: m_Ref(other.m_Ref),
-			m_ImmutableBorrowCount(other.m_ImmutableBorrowCount),
-			m_DropCheck(other.m_DropCheck)
+			: m_Ref(std::exchange(other.m_Ref, nullptr)),
+			m_DropCheck(std::move(other.m_DropCheck)),
+			m_ImmutableBorrowCount(std::exchange(other.m_ImmutableBorrowCount, nullptr))
 		{
-			other.reset_values();
 		}
 
 		inline RefRaw(RefRaw& other) = delete;
@@ -440,13 +804,12 @@ namespace rs {
 			drop();
 		}
 
-		inline auto& operator=(RefRaw&& other) {
+		inline auto& operator=(RefRaw&& other) noexcept {
 			if (this != &other) {
 				drop();
-				m_Ref = other.m_Ref;
-				m_ImmutableBorrowCount = other.m_ImmutableBorrowCount;
-				m_DropCheck = other.m_DropCheck;
-				other.reset_values();
+				m_Ref = std::exchange(other.m_Ref, nullptr);
+				m_ImmutableBorrowCount = std::exchange(other.m_ImmutableBorrowCount, nullptr);
+				m_DropCheck = std::move(other.m_DropCheck);
 			}
 			return *this;
 		}
@@ -454,8 +817,10 @@ namespace rs {
 		inline auto& operator=(RefRaw& other) = delete;
 		inline auto& operator=(const RefRaw& other) = delete;
 
+		// A reference without a checker is an unchecked reborrow (like the ones handed out by
+		// slices made from raw memory), its validity is only guaranteed by whoever created it
 		inline bool is_valid() const {
-			return m_Ref != nullptr && m_DropCheck.is_valid();
+			return m_Ref != nullptr && (m_DropCheck.is_null() || m_DropCheck.is_valid());
 		}
 
 		inline operator bool() const {
@@ -478,13 +843,22 @@ namespace rs {
 			return m_Ref;
 		}
 
+		// Without a checker the counter belongs to something that outlives the reference, like a RefCell.
+		// The views reborrowed from a mutable borrow (see reborrow) count themselves on top of its flag,
+		// so a flag left alone is cleared and anything above it is counted down
 		inline void drop() {
-			if (m_DropCheck.is_valid()) {
-				if constexpr (Mutability) {
-					*m_ImmutableBorrowCount = false;
+			if (m_ImmutableBorrowCount != nullptr && (m_DropCheck.is_null() || m_DropCheck.is_valid())) {
+				if constexpr (ThreadSafe) {
+					if constexpr (Mutability) {
+						*m_ImmutableBorrowCount = 0;
+					}
+					else {
+						*m_ImmutableBorrowCount -= 1;
+					}
 				}
 				else {
-					*m_ImmutableBorrowCount -= 1;
+					auto& count = *m_ImmutableBorrowCount;
+					count = count == internal::MutableBorrow ? 0 : count - 1;
 				}
 			}
 			reset_values();
@@ -511,7 +885,24 @@ namespace rs {
 			return Mutability;
 		}
 
+		/*
+		* Moves the borrow over to a part of the value, f gets the value and returns a reference to
+		* the part, like Rust's Ref::map. This reference is left invalid.
+		*/
+		template<typename F>
+		inline auto map(F&& f) {
+			auto& part = f(*value());
+			auto mapped = RefRaw<std::remove_cvref_t<decltype(part)>, Mutability, ThreadSafe>(&part, m_ImmutableBorrowCount, std::move(m_DropCheck));
+			reset_values();
+			return mapped;
+		}
+
 	private:
+		inline RefRaw()
+			: m_ImmutableBorrowCount(nullptr)
+		{
+		}
+
 		RefRaw(
 			ValueType ref,
 			RawPtr<RefBackType> backCountPtr,
@@ -528,6 +919,46 @@ namespace rs {
 			m_DropCheck = ValidityChecker<ThreadSafe>();
 		}
 
+		// Creates another immutable borrow of the same value
+		inline auto share() const requires(!Mutability) {
+			if (!is_valid()) {
+				throw RefValueExpiredException();
+			}
+
+			if (m_ImmutableBorrowCount != nullptr) {
+				*m_ImmutableBorrowCount += 1;
+			}
+			return RefRaw(m_Ref, m_ImmutableBorrowCount, m_DropCheck);
+		}
+
+		// Another borrow of the same owner for a view made from this one, mutable or not. It is counted
+		// in the word of the owner so the owner stays borrowed until the last of them is dropped
+		template<bool M>
+		inline auto reborrow() const requires(!ThreadSafe) {
+			static_assert(Mutability || !M, "An immutable borrow can not be reborrowed mutably");
+
+			if (!is_valid()) {
+				throw RefValueExpiredException();
+			}
+
+			if (m_ImmutableBorrowCount != nullptr) {
+				*m_ImmutableBorrowCount += 1;
+			}
+			return RefRaw<Type, M, ThreadSafe>(m_Ref, m_ImmutableBorrowCount, m_DropCheck);
+		}
+
+		// Moves the borrow into a type erased one which only keeps the bookkeeping,
+		// this reference is left invalid
+		inline auto erase() {
+			if (!is_valid()) {
+				throw RefValueExpiredException();
+			}
+
+			auto erased = RefRaw<void, Mutability, ThreadSafe>(m_Ref, m_ImmutableBorrowCount, m_DropCheck);
+			reset_values();
+			return erased;
+		}
+
 	private:
 		ValueType m_Ref = nullptr;
 		ValidityChecker<ThreadSafe> m_DropCheck;
@@ -536,6 +967,42 @@ namespace rs {
 
 		template <typename Ty, bool Ts>
 		friend class ValRaw;
+
+		template <typename Ty, bool M, bool Ts>
+		friend class RefRaw;
+
+		template <typename Ty, bool M>
+		friend class TraitView;
+
+		template <typename Ty, bool M>
+		friend class SliceRaw;
+
+		template <typename Ty, usize N, typename G>
+		friend class VecRaw;
+
+		template <typename Source>
+		friend class Iter;
+
+		template <typename Ty>
+		friend class ArenaVal;
+
+		template <typename Ty>
+		friend class SlotMap;
+
+		template <typename K, typename V, typename H>
+		friend class HashMap;
+
+		template <typename K, typename H>
+		friend class HashSet;
+
+		template <typename Ty>
+		friend class OnceCell;
+
+		template <typename Ty>
+		friend class RefCell;
+
+		template <typename... Vs>
+		friend class Enum;
 	};
 
 	template<typename Type>
@@ -574,85 +1041,39 @@ namespace rs {
 			: m_Value(value)
 		{
 			m_DropCheck = ValidityChecker<ThreadSafe>(true);
-			m_ImmutableBorrowCount = 0;
-			m_IsMutableBorrowed = false;
 		}
 
 		inline ValRaw(Type&& value) noexcept
 			: m_Value(std::move(value))
 		{
 			m_DropCheck = ValidityChecker<ThreadSafe>(true);
-			m_ImmutableBorrowCount = 0;
-			m_IsMutableBorrowed = false;
 		}
 
-		inline ValRaw(ValRaw&& other)
-		{
-			if (!other.is_valid()) {
-				throw ValValueMovedException();
-			}
-
-			m_DropCheck = std::move(other.m_DropCheck);
-			m_Value = std::move(other.m_Value);
-			m_ImmutableBorrowCount = static_cast<u32>(other.m_ImmutableBorrowCount);
-			m_IsMutableBorrowed = static_cast<bool>(other.m_IsMutableBorrowed);
-
-			other.reset_values();
+		// Moving hands over the value and the pointer to the control block, nothing is counted or
+		// locked. Moving from an empty Val gives an empty one, using it throws just like using the source would.
+		// Moving a borrowed Val expires its references like drop() does, the new one gets a block of its own
+		inline ValRaw(ValRaw&& other) noexcept(std::is_nothrow_move_constructible_v<Type>) {
+			take_from(other);
 		}
 
-		inline ValRaw(ValRaw& other) {
-			if (!other.is_valid()) {
-				throw ValValueMovedException();
-			}
-
-			m_DropCheck = other.m_DropCheck;
-			m_Value = std::move(other.m_Value);
-			m_ImmutableBorrowCount = static_cast<u32>(other.m_ImmutableBorrowCount);
-			m_IsMutableBorrowed = static_cast<bool>(other.m_IsMutableBorrowed);
-
-			other.reset_values();
+		inline ValRaw(ValRaw& other) noexcept(std::is_nothrow_move_constructible_v<Type>) {
+			take_from(other);
 		}
 
 		inline ValRaw(const ValRaw& other) = delete;
 
-		inline auto operator=(ValRaw&& other) -> ValRaw& {
+		inline auto operator=(ValRaw&& other) noexcept(std::is_nothrow_move_constructible_v<Type>) -> ValRaw& {
 			if (this != &other) {
-				if (!other.is_valid()) {
-					throw ValValueMovedException();
-				}
-
-				if (!m_DropCheck.is_null()) {
-					m_DropCheck.drop(); // Ownership is consumed by this instance
-					// all references to the value are now invalid
-				}
-
-				m_DropCheck = other.m_DropCheck;
-				m_Value = std::move(other.m_Value);
-				m_ImmutableBorrowCount = (u32)other.m_ImmutableBorrowCount;
-				m_IsMutableBorrowed = (bool)other.m_IsMutableBorrowed;
-
-				other.reset_values();
+				drop(); // all references to the old value are now invalid
+				take_from(other);
 			}
 			return *this;
 		}
 
-		inline auto operator=(ValRaw& other) -> ValRaw& {
+		inline auto operator=(ValRaw& other) noexcept(std::is_nothrow_move_constructible_v<Type>) -> ValRaw& {
 			if (this != &other) {
-				if (!other.is_valid()) {
-					throw ValValueMovedException();
-				}
-
-				if (!m_DropCheck.is_null()) {
-					m_DropCheck.drop(); // Ownership is consumed by this instance
-					// all references to the value are now invalid
-				}
-
-				m_DropCheck = other.m_DropCheck;
-				m_Value = std::move(other.m_Value);
-				m_ImmutableBorrowCount = (u32)other.m_ImmutableBorrowCount;
-				m_IsMutableBorrowed = (bool)other.m_IsMutableBorrowed;
-
-				other.reset_values();
+				drop();
+				take_from(other);
 			}
 			return *this;
 		}
@@ -667,39 +1088,22 @@ namespace rs {
 
 			if (!is_valid()) return;
 
-			if (!m_DropCheck.is_null()) {
-				m_DropCheck.drop();
-			}
+			m_DropCheck.drop();
 
 			if constexpr (ThreadSafe) {
 				std::lock_guard<std::mutex> lock(*m_DropCheck.get_mutex());
-
-				if constexpr (IsRawPtr<Type>) {
-					delete m_Value.value();
-				}
-				else if constexpr (IsSmartPtr<Type>) {
-					m_Value.value().reset();
-				}
-
-				m_Value = std::nullopt;
+				destroy_value();
 			}
 			else {
-				if constexpr (IsRawPtr<Type>) {
-					delete m_Value.value();
-				}
-				else if constexpr (IsSmartPtr<Type>) {
-					m_Value.value().reset();
-				}
-
-				m_Value = std::nullopt;
+				destroy_value();
 			}
 
-			// m_ImmutableBorrowCount = 0;
-			// m_IsMutableBorrowed = false;
+			// The references still see the block, dropped, this lets go of it and marks the value empty
+			m_DropCheck = ValidityChecker<ThreadSafe>();
 		}
 
 		inline bool is_valid() const {
-			return m_Value.has_value();
+			return !m_DropCheck.is_null();
 		}
 
 		inline operator bool() const {
@@ -712,13 +1116,13 @@ namespace rs {
 			}
 
 			if constexpr (IsSmartPtrOrRawPtr<Type>) {
-				return m_Value.value();
+				return m_Value;
 			}
 			else if constexpr (IsRefRaw<Type>) {
-				return m_Value.value().value();
+				return m_Value.value();
 			}
 			else {
-				return &m_Value.value();
+				return &m_Value;
 			}
 		}
 
@@ -728,13 +1132,13 @@ namespace rs {
 			}
 
 			if constexpr (IsSmartPtrOrRawPtr<Type>) {
-				return m_Value.value();
+				return m_Value;
 			}
 			else if constexpr (IsRefRaw<Type>) {
-				return m_Value.value().value();
+				return m_Value.value();
 			}
 			else {
-				return &m_Value.value();
+				return &m_Value;
 			}
 		}
 
@@ -754,12 +1158,14 @@ namespace rs {
 			return *value();
 		}
 
+		// The slices reborrowed from a mutable borrow are counted under its flag, they are not immutable borrows
 		inline u32 num_borrows() const {
-			return m_ImmutableBorrowCount;
+			u32 state = m_BorrowState;
+			return (state & MutableBorrow) != 0 ? 0 : state;
 		}
 
 		inline bool is_mutable_borrowed() const {
-			return m_IsMutableBorrowed;
+			return (m_BorrowState & MutableBorrow) != 0;
 		}
 
 		inline auto clone() const {
@@ -768,13 +1174,13 @@ namespace rs {
 			}
 
 			if constexpr (IsSmartPtr<Type>) {
-				return ValRaw<Type, ThreadSafe>(m_Value.value()->clone_sm());
+				return ValRaw<Type, ThreadSafe>(m_Value->clone_sm());
 			}
 			else if constexpr (IsRawPtr<Type>) {
-				return ValRaw<Type, ThreadSafe>(m_Value.value()->clone());
+				return ValRaw<Type, ThreadSafe>(m_Value->clone());
 			}
 			else {
-				return ValRaw<Type, ThreadSafe>(m_Value.value());
+				return ValRaw<Type, ThreadSafe>(m_Value);
 			}
 		}
 
@@ -783,21 +1189,21 @@ namespace rs {
 				throw ValValueMovedException();
 			}
 
-			if (m_IsMutableBorrowed) {
+			if (is_mutable_borrowed()) {
 				throw AlreadyBorrowedMutablyException();
 			}
 
-			m_ImmutableBorrowCount++;
+			m_BorrowState += 1;
 
 
 			if constexpr (IsRawPtr<Type>) {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>(m_Value.get(), &m_ImmutableBorrowCount, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>(m_Value, &m_BorrowState, m_DropCheck));
 			}
 			else if constexpr (IsSmartPtr<Type>) {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>(m_Value.get(), &m_ImmutableBorrowCount, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>(m_Value.get(), &m_BorrowState, m_DropCheck));
 			}
 			else {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<Type, false, ThreadSafe>(&m_Value.value(), &m_ImmutableBorrowCount, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe>(RefRaw<Type, false, ThreadSafe>(&m_Value, &m_BorrowState, m_DropCheck));
 			}
 		}
 
@@ -806,55 +1212,158 @@ namespace rs {
 				throw ValValueMovedException();
 			}
 
-			if (m_IsMutableBorrowed) {
+			if (is_mutable_borrowed()) {
 				throw AlreadyBorrowedMutablyException();
 			}
 
-			if (m_ImmutableBorrowCount > 0) {
+			if (num_borrows() > 0) {
 				throw AlreadyBorrowedImmutablyException();
 			}
 
-			m_IsMutableBorrowed = true;
+			m_BorrowState = MutableBorrow;
 
 			if constexpr (IsRawPtr<Type>) {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>(m_Value.get(), &m_IsMutableBorrowed, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>(m_Value, &m_BorrowState, m_DropCheck));
 			}
 			else if constexpr (IsSmartPtr<Type>) {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>(m_Value.get(), &m_IsMutableBorrowed, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>(m_Value.get(), &m_BorrowState, m_DropCheck));
 			}
 			else {
-				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<Type, true, ThreadSafe>(&m_Value.value(), &m_IsMutableBorrowed, m_DropCheck));
+				return ValRaw< RefRaw<std::remove_pointer_t<Type>, true, ThreadSafe>, ThreadSafe>(RefRaw<Type, true, ThreadSafe>(&m_Value, &m_BorrowState, m_DropCheck));
 			}
 		}
 
 
 
 		inline auto raw() {
-			return &m_Value.value();
+			return &m_Value;
 		}
 
+		/*
+		* Borrows a contiguous container (std::vector, std::array, ...) immutably as a Slice.
+		*/
+		inline auto as_slice() requires(std::ranges::contiguous_range<Type> && !ThreadSafe) {
+			if (!is_valid()) {
+				throw ValValueMovedException();
+			}
 
-	private:
-		inline ValRaw() noexcept {
-			reset_values();
-		}
+			if (is_mutable_borrowed()) {
+				throw AlreadyBorrowedMutablyException();
+			}
 
-		template <typename Ty, bool Ts>
-		static inline auto None() noexcept {
-			return ValRaw<Ty, Ts>();
+			m_BorrowState += 1;
+			return SliceRaw<std::ranges::range_value_t<Type>, false>(std::ranges::data(m_Value), std::ranges::size(m_Value), RefRaw<void, false, false>(this, &m_BorrowState, m_DropCheck));
 		}
 
-		inline void reset_values() {
-			m_Value = std::nullopt;
-			m_ImmutableBorrowCount = 0;
-			m_IsMutableBorrowed = false;
+		/*
+		* Borrows a contiguous container (std::vector, std::array, ...) mutably as a SliceMut.
+		*/
+		inline auto as_mut_slice() requires(std::ranges::contiguous_range<Type> && !ThreadSafe) {
+			if (!is_valid()) {
+				throw ValValueMovedException();
+			}
+
+			if (is_mutable_borrowed()) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (num_borrows() > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			m_BorrowState = MutableBorrow;
+			return SliceRaw<std::ranges::range_value_t<Type>, true>(std::ranges::data(m_Value), std::ranges::size(m_Value), RefRaw<void, true, false>(this, &m_BorrowState, m_DropCheck));
+		}
+
+
+	private:
+		inline ValRaw() noexcept {
+		}
+
+		// Moves the value out without the borrow checks of value(), this is left empty just like after a drop
+		inline Type take_value() {
+			if (!is_valid()) {
+				throw ValValueMovedException();
+			}
+
+			auto value = Type(std::move(m_Value));
+			std::destroy_at(&m_Value);
+			m_DropCheck.drop();
 			m_DropCheck = ValidityChecker<ThreadSafe>();
+			return value;
+		}
+
+		template <typename Ty, bool Ts>
+		static inline auto None() noexcept {
+			return ValRaw<Ty, Ts>();
+		}
+
+		inline void destroy_value() {
+			if constexpr (IsRawPtr<Type>) {
+				delete m_Value;
+			}
+			std::destroy_at(&m_Value);
+		}
+
+		// Only called while this is empty
+		inline void take_from(ValRaw& other) noexcept(std::is_nothrow_move_constructible_v<Type>) {
+			if (!other.is_valid()) {
+				return;
+			}
+
+			// A move has both Vals to itself, so a SafeVal needs no ordering here and a seq_cst access
+			// would cost a locked instruction on every hand over
+			if constexpr (ThreadSafe) {
+				if (other.m_BorrowState.load(std::memory_order_relaxed) != 0) [[unlikely]] {
+					take_borrowed_from(other);
+					return;
+				}
+				m_BorrowState.store(0, std::memory_order_relaxed);
+			}
+			else {
+				if (other.m_BorrowState != 0) [[unlikely]] {
+					take_borrowed_from(other);
+					return;
+				}
+				m_BorrowState = 0;
+			}
+
+			std::construct_at(&m_Value, std::move(other.m_Value));
+			std::destroy_at(&other.m_Value);
+			m_DropCheck = std::move(other.m_DropCheck);
 		}
 
 	private:
-		std::optional<Type> m_Value;
-		std::conditional_t<ThreadSafe, std::atomic_uint32_t, u32> m_ImmutableBorrowCount = 0;
-		std::conditional_t<ThreadSafe, std::atomic_bool, bool> m_IsMutableBorrowed = false;
+		static constexpr u32 MutableBorrow = internal::MutableBorrow;
+
+		// The references of other point into it and count in its word, they expire like on drop
+		// and this Val starts over with a block of its own. Kept out of line, it is not the usual move
+		RS_NOINLINE void take_borrowed_from(ValRaw& other) noexcept(std::is_nothrow_move_constructible_v<Type>) {
+			auto dropCheck = ValidityChecker<ThreadSafe>(true);
+			other.m_DropCheck.drop();
+			if constexpr (ThreadSafe) {
+				std::lock_guard<std::mutex> lock(*other.m_DropCheck.get_mutex());
+				std::construct_at(&m_Value, std::move(other.m_Value));
+				std::destroy_at(&other.m_Value);
+				m_BorrowState.store(0, std::memory_order_relaxed);
+				other.m_BorrowState.store(0, std::memory_order_relaxed);
+			}
+			else {
+				std::construct_at(&m_Value, std::move(other.m_Value));
+				std::destroy_at(&other.m_Value);
+				m_BorrowState = 0;
+				other.m_BorrowState = 0;
+			}
+			other.m_DropCheck = ValidityChecker<ThreadSafe>();
+			m_DropCheck = std::move(dropCheck);
+		}
+
+		// Constructed only while m_DropCheck holds a block, so there is no engaged flag like in a std::optional
+		union {
+			Type m_Value;
+		};
+		// The number of immutable borrows, or MutableBorrow while it is borrowed mutably
+		std::conditional_t<ThreadSafe, std::atomic_uint32_t, u32> m_BorrowState = 0;
 		ValidityChecker<ThreadSafe> m_DropCheck;
 
 	private:
@@ -867,6 +1376,9 @@ namespace rs {
 
 		template<typename Ty, typename Er, bool Ts>
 		friend class ResultRaw;
+
+		template<typename Ty>
+		friend class Cow;
 	};
 
 
@@ -876,6 +1388,11 @@ namespace rs {
 	template<typename Type>
 	using SafeVal = ValRaw<Type, true>;
 
+	// The value, one word for the borrow count and flag and the pointer to its ValidityCheckBlock
+	static_assert(sizeof(Val<u32>) == 2 * sizeof(u32) + sizeof(RawPtr<void>));
+	static_assert(sizeof(Val<RawPtr<u64>>) == 3 * sizeof(RawPtr<void>));
+	static_assert(sizeof(Ref<u64>) == 3 * sizeof(RawPtr<void>));
+
 	template<typename Type, typename... Args>
 	static inline auto MakeVal(Args&&... args) {
 		return Val<Type>(Type(std::forward<Args>(args)...));
@@ -982,6 +1499,14 @@ namespace rs {
 			else return NoneRaw<RefRaw<std::remove_pointer_t<Type>, false, ThreadSafe>, ThreadSafe >();
 		}
 
+		/*
+		* Returns an iterator over the contained value, it yields it once for Some and nothing for None.
+		*/
+		inline auto iter() {
+			using ItemType = std::remove_reference_t<decltype(*m_Value)>;
+			return Iter<internal::iter::Once<ItemType>>(internal::iter::Once<ItemType>(is_some() ? &*m_Value : nullptr));
+		}
+
 		/*
 		* Converts from OptionRaw<T> to OptionRaw<RefMut<T>>
 		*/
@@ -1109,12 +1634,16 @@ namespace rs {
 		inline OptionRaw() noexcept { }
 		inline OptionRaw(ValRaw<Type, ThreadSafe> value) : m_Value(value) {}
 
+		inline Type take_some() { return m_Value.take_value(); }
 
 	private:
 		ValRaw<Type, ThreadSafe> m_Value;
 
 		template<typename U, bool Ts>
 		friend class OptionRaw;
+
+		template<typename U>
+		friend struct internal::iter::option_traits;
 	};
 
 	template <typename T>
@@ -1528,12 +2057,19 @@ namespace rs {
 			}
 		}
 
+		inline Type take_ok() { return m_Value.take_value(); }
+
+		inline Err take_err() { return m_Error.take_value(); }
+
 	private:
 		ValRaw<Type, ThreadSafe> m_Value;
 		ValRaw<Err, ThreadSafe> m_Error;
 
 		template<typename U, typename E, bool Ts>
 		friend class ResultRaw;
+
+		template<typename U>
+		friend struct internal::iter::result_traits;
 	};
 
 	template<typename T, typename E>
@@ -1574,186 +2110,10691 @@ namespace rs {
 
 }
 
-// the print proxy for all the types
+// SIMD kernels for the slice operations
 namespace rs {
 
-	template<bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const ValidityCheckBlock<ThreadSafe>& a) -> std::ostream& {
-		return os << typeid(a).name() << " { is_valid: " << a.is_valid() << " }";
-	}
+	namespace internal::simd {
 
-	template<bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const ValidityChecker<ThreadSafe>& a) -> std::ostream& {
-		if (a.is_null()) {
-			return os << typeid(a).name() << " { is_null: true }";
-		}
-		return os << typeid(a).name() << " { is_valid: " << a.is_valid() << ", ref_count: " << a.ref_count() << " }";
-	}
+		enum class Level : u8 {
+			Scalar,
+			SSE2,
+			AVX2,
+			AVX512
+		};
 
-	template<typename Type, bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const ValRaw<Type, ThreadSafe>& a) -> std::ostream& {
-		if (!a.is_valid()) {
-			return os << typeid(a).name() << " { is_valid: false }";
+		inline auto detect_level() -> Level {
+#if RS_SIMD_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+				return Level::AVX512;
+			}
+			if (__builtin_cpu_supports("avx2")) {
+				return Level::AVX2;
+			}
+			if (__builtin_cpu_supports("sse2")) {
+				return Level::SSE2;
+			}
+#endif
+			return Level::Scalar;
 		}
-		return os << typeid(a).name() << " { value: " << *a.value() << " }";
-	}
 
-	template<typename Type, bool Mutable, bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const RefRaw<Type, Mutable, ThreadSafe>& a) -> std::ostream& {
-		if (!a.is_valid()) {
-			return os << typeid(a).name() << " { is_valid: false }";
-		}
-		return os << typeid(a).name() << " { value: " << *a.value() << " }";
-	}
+		// Detected once during static initialization, anything that runs before that uses the scalar kernels
+		inline const Level s_Level = detect_level();
 
-	template<typename Type, bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const OptionRaw<Type, ThreadSafe>& a) -> std::ostream& {
-		if (a.is_some()) {
-			return os << typeid(a).name() << " { is_some: true, value: " << *a.unsafe_ptr() << " }";
-		}
-		return os << typeid(a).name() << " { is_some: false }";
-	}
+		template<typename Type>
+		concept IsSimdElement = std::is_arithmetic_v<Type> && !std::is_same_v<Type, bool>
+			&& (sizeof(Type) == 1 || sizeof(Type) == 2 || sizeof(Type) == 4 || sizeof(Type) == 8);
 
-	template<typename Type, typename Err, bool ThreadSafe>
-	inline auto operator<<(std::ostream& os, const ResultRaw<Type, Err, ThreadSafe>& a) -> std::ostream& {
-		if (a.is_ok()) {
-			return os << typeid(a).name() << " { Ok, value: " << *a.unsafe_ptr() << " }";
-		}
-		return os << typeid(a).name() << " { Err, error: " << *a.unsafe_error_ptr() << " }";
-	}
-}
+		template<typename Type>
+		using LaneBits = std::conditional_t<sizeof(Type) == 1, u8,
+			std::conditional_t<sizeof(Type) == 2, u16,
+			std::conditional_t<sizeof(Type) == 4, u32, u64>>>;
 
-#ifdef RS_EXPORT
+		// Scalar kernels, also used for the tails of the vector ones
 
-namespace std {
-	template<bool ThreadSafe>
-	struct formatter<rs::ValidityCheckBlock<ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::ValidityCheckBlock<ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		template<typename Type>
+		inline usize find_scalar(RawPtr<const Type> data, usize len, Type value, usize i = 0) {
+			for (; i < len; i++) {
+				if (data[i] == value) {
+					return i;
+				}
+			}
+			return len;
 		}
-	};
 
-	template<bool ThreadSafe>
-	struct formatter<rs::ValidityChecker<ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::ValidityChecker<ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		template<typename Type>
+		inline usize count_scalar(RawPtr<const Type> data, usize len, Type value, usize i = 0) {
+			usize count = 0;
+			for (; i < len; i++) {
+				count += data[i] == value;
+			}
+			return count;
 		}
-	};
 
-	template<typename Type, bool ThreadSafe>
-	struct formatter<rs::ValRaw<Type, ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::ValRaw<Type, ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		// Integers wrap around instead of overflowing
+		template<typename Type>
+		inline Type sum_scalar(RawPtr<const Type> data, usize len, Type sum = Type(), usize i = 0) {
+			if constexpr (std::is_integral_v<Type>) {
+				auto total = static_cast<LaneBits<Type>>(sum);
+				for (; i < len; i++) {
+					total += static_cast<LaneBits<Type>>(data[i]);
+				}
+				return static_cast<Type>(total);
+			}
+			else {
+				for (; i < len; i++) {
+					sum += data[i];
+				}
+				return sum;
+			}
 		}
-	};
 
-	template<typename Type, bool Mutable, bool ThreadSafe>
-	struct formatter<rs::RefRaw<Type, Mutable, ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::RefRaw<Type, Mutable, ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		// NaNs are skipped, the identity is returned if there is nothing else
+		template<typename Type, bool Max>
+		inline Type extremum_scalar(RawPtr<const Type> data, usize len, Type result, usize i = 0) {
+			for (; i < len; i++) {
+				if (Max ? data[i] > result : data[i] < result) {
+					result = data[i];
+				}
+			}
+			return result;
 		}
-	};
 
-	template<typename Type, bool ThreadSafe>
-	struct formatter<rs::OptionRaw<Type, ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::OptionRaw<Type, ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		template<typename Type>
+		inline bool eq_scalar(RawPtr<const Type> a, RawPtr<const Type> b, usize len, usize i = 0) {
+			for (; i < len; i++) {
+				if (!(a[i] == b[i])) {
+					return false;
+				}
+			}
+			return true;
 		}
-	};
 
-	template<typename Type, typename Err, bool ThreadSafe>
-	struct formatter<rs::ResultRaw<Type, Err, ThreadSafe>>
-	{
-		template<typename ParseContext>
-		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
-		template<typename FormatContext>
-		auto format(const rs::ResultRaw<Type, Err, ThreadSafe>& value, FormatContext& ctx) const
-		{
-			auto ss = std::stringstream();
-			ss << value;
-			return format_to(ctx.out(), "{}", ss.str());
+		template<typename Type, bool Max>
+		constexpr Type extremum_identity() {
+			if constexpr (std::is_floating_point_v<Type>) {
+				return Max ? -std::numeric_limits<Type>::infinity() : std::numeric_limits<Type>::infinity();
+			}
+			else {
+				return Max ? std::numeric_limits<Type>::lowest() : std::numeric_limits<Type>::max();
+			}
 		}
-	};
-}
 
-#endif
+#if RS_SIMD_X86
+		// The kernels are written once with the compiler's vector extensions and instantiated
+		// for 16, 32 and 64 byte vectors inside functions compiled for SSE2, AVX2 and AVX-512
 
-// Traits for C++
+		template<typename Type, usize Bytes>
+		struct vector_of {
+			typedef Type type __attribute__((vector_size(Bytes)));
+		};
 
-namespace rs {
+		template<typename Type, usize Bytes>
+		using Vector = typename vector_of<Type, Bytes>::type;
 
-    namespace internal {
-        constexpr auto hash_string(const char* input) {
-            usize hash = sizeof(usize) == 8 ? 0xcbf29ce484222325 : 0x811c9dc5;
-            const size_t prime = sizeof(usize) == 8 ? 0x00000100000001b3 : 0x01000193;
+		RS_TARGET("sse2") inline u64 movemask_16(const void* mask) {
+			__m128i bits;
+			std::memcpy(&bits, mask, 16);
+			return static_cast<u32>(_mm_movemask_epi8(bits));
+		}
 
-            while (*input) {
-                hash ^= static_cast<usize>(*input);
-                hash *= prime;
-                ++input;
-            }
+		RS_TARGET("avx2") inline u64 movemask_32(const void* mask) {
+			__m256i bits;
+			std::memcpy(&bits, mask, 32);
+			return static_cast<u32>(_mm256_movemask_epi8(bits));
+		}
 
-                return hash;
-        }
+		RS_TARGET("avx512f,avx512bw") inline u64 movemask_64(const void* mask) {
+			__m512i bits;
+			std::memcpy(&bits, mask, 64);
+			return _mm512_movepi8_mask(bits);
+		}
 
-        template <auto T> 
-        constexpr auto get_type_hash()
-        {
-            #ifdef _MSC_VER
-            return hash_string(__FUNCSIG__);
-            #else
-            return hash_string(__PRETTY_FUNCTION__);
-            #endif
-        }
+		// One bit per byte of the mask vector
+		template<usize Bytes, typename Mask>
+		RS_ALWAYS_INLINE u64 movemask(const Mask& mask) {
+			if constexpr (Bytes == 16) {
+				return movemask_16(&mask);
+			}
+			else if constexpr (Bytes == 32) {
+				return movemask_32(&mask);
+			}
+			else {
+				return movemask_64(&mask);
+			}
+		}
 
-        template<typename... T>
-        struct func_types;
+		// Vectors are only passed around between always inlined functions, so the ABI notes do not apply
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
 
-        template<typename RetType, typename Class, typename... ValTypes> 
-        struct func_types<RetType(Class::*)(ValTypes...)> {
-            using ParamsType = std::tuple<ValTypes...>;
-			using ParamsTypeWithContext = std::tuple<void*, ValTypes...>;
-            using ReturnType = RetType;
-            using ClassType = Class;
-            using FunctionType = RetType(ValTypes...);
-            using FunctionTypeWithContext = RetType(void*, ValTypes...);
-        };
-    }
+		template<usize Bytes, typename Type>
+		RS_ALWAYS_INLINE auto load(RawPtr<const Type> data) {
+			Vector<Type, Bytes> value;
+			std::memcpy(&value, data, Bytes);
+			return value;
+		}
+
+		struct Find {
+			template<usize Bytes, typename Type>
+			RS_ALWAYS_INLINE static usize run(RawPtr<const Type> data, usize len, Type value) {
+				constexpr usize Lanes = Bytes / sizeof(Type);
+				auto needle = Vector<Type, Bytes>{} + value;
+
+				usize i = 0;
+				for (; i + 4 * Lanes <= len; i += 4 * Lanes) {
+					auto m0 = load<Bytes>(data + i) == needle;
+					auto m1 = load<Bytes>(data + i + Lanes) == needle;
+					auto m2 = load<Bytes>(data + i + 2 * Lanes) == needle;
+					auto m3 = load<Bytes>(data + i + 3 * Lanes) == needle;
+					if (movemask<Bytes>(m0 | m1 | m2 | m3) != 0) {
+						break;
+					}
+				}
+				for (; i + Lanes <= len; i += Lanes) {
+					auto bits = movemask<Bytes>(load<Bytes>(data + i) == needle);
+					if (bits != 0) {
+						return i + static_cast<usize>(std::countr_zero(bits)) / sizeof(Type);
+					}
+				}
+				return find_scalar(data, len, value, i);
+			}
+
+			template<typename Type>
+			static usize scalar(RawPtr<const Type> data, usize len, Type value) {
+				return find_scalar(data, len, value);
+			}
+		};
+
+		struct Count {
+			template<usize Bytes, typename Type>
+			RS_ALWAYS_INLINE static usize run(RawPtr<const Type> data, usize len, Type value) {
+				using Lane = LaneBits<Type>;
+				constexpr usize Lanes = Bytes / sizeof(Type);
+				// every lane counts up to the max of its type before it is flushed
+				constexpr usize Flush = static_cast<usize>(std::min<u64>(std::numeric_limits<Lane>::max(), std::numeric_limits<usize>::max()));
+				auto needle = Vector<Type, Bytes>{} + value;
+
+				usize count = 0;
+				usize i = 0;
+				while (i + Lanes <= len) {
+					auto counts = Vector<Lane, Bytes>{};
+					for (usize steps = 0; steps < Flush && i + Lanes <= len; steps++, i += Lanes) {
+						counts -= reinterpret_cast<Vector<Lane, Bytes>>(load<Bytes>(data + i) == needle);
+					}
+					for (usize lane = 0; lane < Lanes; lane++) {
+						count += counts[lane];
+					}
+				}
+				return count + count_scalar(data, len, value, i);
+			}
+
+			template<typename Type>
+			static usize scalar(RawPtr<const Type> data, usize len, Type value) {
+				return count_scalar(data, len, value);
+			}
+		};
+
+		struct Sum {
+			template<usize Bytes, typename Type>
+			RS_ALWAYS_INLINE static Type run(RawPtr<const Type> data, usize len) {
+				// integers are summed in unsigned lanes so that they wrap around
+				using Lane = std::conditional_t<std::is_integral_v<Type>, LaneBits<Type>, Type>;
+				constexpr usize Lanes = Bytes / sizeof(Type);
+
+				auto acc0 = Vector<Lane, Bytes>{};
+				auto acc1 = Vector<Lane, Bytes>{};
+				usize i = 0;
+				for (; i + 2 * Lanes <= len; i += 2 * Lanes) {
+					acc0 += reinterpret_cast<Vector<Lane, Bytes>>(load<Bytes>(data + i));
+					acc1 += reinterpret_cast<Vector<Lane, Bytes>>(load<Bytes>(data + i + Lanes));
+				}
+				acc0 += acc1;
+
+				auto sum = Lane();
+				for (usize lane = 0; lane < Lanes; lane++) {
+					sum += acc0[lane];
+				}
+				return sum_scalar(data, len, static_cast<Type>(sum), i);
+			}
+
+			template<typename Type>
+			static Type scalar(RawPtr<const Type> data, usize len) {
+				return sum_scalar(data, len);
+			}
+		};
+
+		template<bool Max>
+		struct Extremum {
+			template<usize Bytes, typename Type>
+			RS_ALWAYS_INLINE static Type run(RawPtr<const Type> data, usize len) {
+				constexpr usize Lanes = Bytes / sizeof(Type);
+
+				auto acc = Vector<Type, Bytes>{} + extremum_identity<Type, Max>();
+				usize i = 0;
+				for (; i + Lanes <= len; i += Lanes) {
+					auto value = load<Bytes>(data + i);
+					if constexpr (Max) {
+						acc = value > acc ? value : acc;
+					}
+					else {
+						acc = value < acc ? value : acc;
+					}
+				}
+
+				auto result = extremum_identity<Type, Max>();
+				for (usize lane = 0; lane < Lanes; lane++) {
+					if (Max ? acc[lane] > result : acc[lane] < result) {
+						result = acc[lane];
+					}
+				}
+				return extremum_scalar<Type, Max>(data, len, result, i);
+			}
+
+			template<typename Type>
+			static Type scalar(RawPtr<const Type> data, usize len) {
+				return extremum_scalar<Type, Max>(data, len, extremum_identity<Type, Max>());
+			}
+		};
+
+		// Only used for floating point, integers are compared with memcmp
+		struct Eq {
+			template<usize Bytes, typename Type>
+			RS_ALWAYS_INLINE static bool run(RawPtr<const Type> a, RawPtr<const Type> b, usize len) {
+				constexpr usize Lanes = Bytes / sizeof(Type);
+
+				usize i = 0;
+				for (; i + Lanes <= len; i += Lanes) {
+					if (movemask<Bytes>(load<Bytes>(a + i) != load<Bytes>(b + i)) != 0) {
+						return false;
+					}
+				}
+				return eq_scalar(a, b, len, i);
+			}
+
+			template<typename Type>
+			static bool scalar(RawPtr<const Type> a, RawPtr<const Type> b, usize len) {
+				return eq_scalar(a, b, len);
+			}
+		};
+
+#pragma GCC diagnostic pop
+
+		template<typename Op, typename... Args>
+		RS_TARGET("sse2") auto run_sse2(Args... args) {
+			return Op::template run<16>(args...);
+		}
+
+		template<typename Op, typename... Args>
+		RS_TARGET("avx2") auto run_avx2(Args... args) {
+			return Op::template run<32>(args...);
+		}
+
+		template<typename Op, typename... Args>
+		RS_TARGET("avx512f,avx512bw") auto run_avx512(Args... args) {
+			return Op::template run<64>(args...);
+		}
+
+		template<typename Op, typename... Args>
+		inline auto dispatch(Args... args) {
+			switch (s_Level) {
+			case Level::AVX512:
+				return run_avx512<Op>(args...);
+			case Level::AVX2:
+				return run_avx2<Op>(args...);
+			case Level::SSE2:
+				return run_sse2<Op>(args...);
+			default:
+				return Op::scalar(args...);
+			}
+		}
+
+		template<typename Type>
+		inline usize find(RawPtr<const Type> data, usize len, Type value) {
+			return dispatch<Find>(data, len, value);
+		}
+
+		template<typename Type>
+		inline usize count(RawPtr<const Type> data, usize len, Type value) {
+			return dispatch<Count>(data, len, value);
+		}
+
+		template<typename Type>
+		inline Type sum(RawPtr<const Type> data, usize len) {
+			return dispatch<Sum>(data, len);
+		}
+
+		template<typename Type, bool Max>
+		inline Type extremum(RawPtr<const Type> data, usize len) {
+			return dispatch<Extremum<Max>>(data, len);
+		}
+
+		template<typename Type>
+		inline bool eq(RawPtr<const Type> a, RawPtr<const Type> b, usize len) {
+			if constexpr (std::is_integral_v<Type>) {
+				return len == 0 || std::memcmp(a, b, len * sizeof(Type)) == 0;
+			}
+			else {
+				return dispatch<Eq>(a, b, len);
+			}
+		}
+#else
+		template<typename Type>
+		inline usize find(RawPtr<const Type> data, usize len, Type value) {
+			return find_scalar(data, len, value);
+		}
+
+		template<typename Type>
+		inline usize count(RawPtr<const Type> data, usize len, Type value) {
+			return count_scalar(data, len, value);
+		}
+
+		template<typename Type>
+		inline Type sum(RawPtr<const Type> data, usize len) {
+			return sum_scalar(data, len);
+		}
+
+		template<typename Type, bool Max>
+		inline Type extremum(RawPtr<const Type> data, usize len) {
+			return extremum_scalar<Type, Max>(data, len, extremum_identity<Type, Max>());
+		}
+
+		template<typename Type>
+		inline bool eq(RawPtr<const Type> a, RawPtr<const Type> b, usize len) {
+			if constexpr (std::is_integral_v<Type>) {
+				return len == 0 || std::memcmp(a, b, len * sizeof(Type)) == 0;
+			}
+			else {
+				return eq_scalar(a, b, len);
+			}
+		}
+#endif
+	}
+
+
+	// The operations behind the slice scans, these use the SIMD kernels for the primitive types
+	// and fall back to the standard algorithms for everything else
+	namespace internal {
+
+		template<typename Type>
+		inline usize slice_find(RawPtr<const Type> data, usize len, const Type& value) {
+			if constexpr (simd::IsSimdElement<Type>) {
+				return simd::find(data, len, value);
+			}
+			else {
+				return static_cast<usize>(std::find(data, data + len, value) - data);
+			}
+		}
+
+		template<typename Type>
+		inline usize slice_count(RawPtr<const Type> data, usize len, const Type& value) {
+			if constexpr (simd::IsSimdElement<Type>) {
+				return simd::count(data, len, value);
+			}
+			else {
+				return static_cast<usize>(std::count(data, data + len, value));
+			}
+		}
+
+		template<typename Type>
+		inline Type slice_sum(RawPtr<const Type> data, usize len) {
+			if constexpr (simd::IsSimdElement<Type>) {
+				return simd::sum(data, len);
+			}
+			else {
+				return std::accumulate(data, data + len, Type());
+			}
+		}
+
+		template<typename Type, bool Max>
+		inline auto slice_extremum(RawPtr<const Type> data, usize len) {
+			if (len == 0) {
+				return None<Type>();
+			}
+
+			if constexpr (simd::IsSimdElement<Type>) {
+				auto result = simd::extremum<Type, Max>(data, len);
+				if constexpr (std::is_floating_point_v<Type>) {
+					// NaNs are skipped, if the identity came back and is not in the slice all of them were NaN
+					if (result == simd::extremum_identity<Type, Max>() && simd::find(data, len, result) == len) {
+						return Some<Type>(std::numeric_limits<Type>::quiet_NaN());
+					}
+				}
+				return Some<Type>(std::move(result));
+			}
+			else {
+				auto it = Max ? std::max_element(data, data + len) : std::min_element(data, data + len);
+				return Some<Type>(Type(*it));
+			}
+		}
+
+		template<typename Type>
+		inline bool slice_eq(RawPtr<const Type> a, RawPtr<const Type> b, usize len) {
+			if constexpr (simd::IsSimdElement<Type>) {
+				return simd::eq(a, b, len);
+			}
+			else {
+				return std::equal(a, a + len, b);
+			}
+		}
+	}
+}
+
+// Vec and slices
+namespace rs {
+
+	// Growth policies for VecRaw, grow returns the new capacity given the
+	// current one and the length that has to fit
+	namespace growth {
+		struct Double {
+			static constexpr usize grow(usize capacity, usize required) {
+				return std::max<usize>(required, capacity == 0 ? 4 : capacity * 2);
+			}
+		};
+
+		struct OneAndHalf {
+			static constexpr usize grow(usize capacity, usize required) {
+				return std::max<usize>(required, capacity < 4 ? 4 : capacity + capacity / 2);
+			}
+		};
+
+		struct Exact {
+			static constexpr usize grow(usize, usize required) {
+				return required;
+			}
+		};
+	}
+
+	// Types that can be moved to a new address with a plain memcpy (and without running
+	// the destructor on the old one). Specialize it for your own types if they qualify.
+	template<typename Type>
+	struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<Type>> {};
+
+	template<typename Type>
+	struct is_trivially_relocatable<std::unique_ptr<Type>> : std::true_type {};
+
+	template<typename Type>
+	struct is_trivially_relocatable<std::shared_ptr<Type>> : std::true_type {};
+
+	template<typename Type>
+	concept IsTriviallyRelocatable = is_trivially_relocatable<Type>::value;
+
+	namespace internal {
+		template<typename Type, usize Capacity>
+		struct InlineStorage {
+			inline auto data() { return reinterpret_cast<RawPtr<Type>>(m_Bytes); }
+
+			alignas(Type) std::byte m_Bytes[Capacity * sizeof(Type)];
+		};
+
+		template<typename Type>
+		struct InlineStorage<Type, 0> {
+			inline RawPtr<Type> data() { return nullptr; }
+		};
+	}
+
+
+	template<typename Type, bool Mutability, bool Exact>
+	class ChunksRaw;
+
+	template<typename Type>
+	class WindowsRaw;
+
+	/*
+	* A view over contiguous memory, the equivalent of &[T] (and &mut [T] when Mutability is true).
+	*
+	* A slice obtained from an owner (Vec::as_slice, Val<std::vector<T>>::as_slice, ...) holds
+	* a borrow of it, the owner can not be modified while the slice is alive and the slice
+	* expires if the owner is dropped.
+	*
+	* The views derived from a slice (slice, split_at, chunks, windows, get, ...) count themselves
+	* in the borrow of the owner, so it stays borrowed until the last of them is dropped. The
+	* mutable ones consume the SliceMut they are made from (std::move(s).slice(0, 2)), like a
+	* &mut [T] moved into them, so no two of them can alias. Slices over raw memory do not hold
+	* a borrow, just like the references inside of them they must not outlive what they were
+	* made from.
+	*/
+	template<typename Type, bool Mutability>
+	class SliceRaw {
+	public:
+		using ElementType = std::conditional_t<Mutability, Type, const Type>;
+
+		inline SliceRaw(SliceRaw&& other) noexcept
+			: m_Ptr(other.m_Ptr),
+			m_Len(other.m_Len),
+			m_Loan(std::move(other.m_Loan))
+		{
+			other.m_Ptr = nullptr;
+			other.m_Len = 0;
+		}
+
+		inline SliceRaw(const SliceRaw& other) requires(!Mutability)
+			: m_Ptr(other.m_Ptr),
+			m_Len(other.m_Len),
+			m_Loan(other.m_Loan.m_DropCheck.is_null() ? RefRaw<void, false, false>() : other.m_Loan.share())
+		{
+		}
+
+		inline auto operator=(SliceRaw&& other) noexcept -> SliceRaw& {
+			if (this != &other) {
+				m_Ptr = other.m_Ptr;
+				m_Len = other.m_Len;
+				m_Loan = std::move(other.m_Loan);
+				other.m_Ptr = nullptr;
+				other.m_Len = 0;
+			}
+			return *this;
+		}
+
+		inline auto operator=(const SliceRaw& other) -> SliceRaw& requires(!Mutability) {
+			if (this != &other) {
+				m_Ptr = other.m_Ptr;
+				m_Len = other.m_Len;
+				m_Loan = other.m_Loan.m_DropCheck.is_null() ? RefRaw<void, false, false>() : other.m_Loan.share();
+			}
+			return *this;
+		}
+
+		inline ~SliceRaw() = default;
+
+		/*
+		* Forms a slice from a pointer and a length, nothing is borrowed or checked.
+		*/
+		static inline auto from_raw_parts(RawPtr<ElementType> ptr, usize len) {
+			return SliceRaw(ptr, len, RefRaw<void, Mutability, false>());
+		}
+
+		/*
+		* Returns false if the owner of the memory has been dropped.
+		*/
+		inline bool is_valid() const {
+			return m_Loan.m_DropCheck.is_null() || m_Loan.m_DropCheck.is_valid();
+		}
+
+		inline operator bool() const {
+			return is_valid();
+		}
+
+		/*
+		* Releases the borrow, the slice is empty after this.
+		*/
+		inline void drop() {
+			m_Loan.drop();
+			m_Ptr = nullptr;
+			m_Len = 0;
+		}
+
+		inline usize len() const { return m_Len; }
+
+		inline bool is_empty() const { return m_Len == 0; }
+
+		inline auto as_ptr() const { return m_Ptr; }
+
+		/*
+		* Returns the element at index, throws if it is out of bounds.
+		* The check is a plain comparison with len(), so the optimizer removes it
+		* inside of a `for (usize i = 0; i < s.len(); i++)` loop.
+		*/
+		inline auto& operator[](usize index) const {
+			check();
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			return m_Ptr[index];
+		}
+
+		/*
+		* Returns a reference to the element at index, or None if it is out of bounds.
+		*/
+		inline auto get(usize index) const {
+			check();
+			if (index >= m_Len) {
+				return None<RefRaw<Type, false, false>>();
+			}
+
+			return Some<RefRaw<Type, false, false>>(element(m_Ptr + index, loan<false>()));
+		}
+
+		/*
+		* Returns a mutable reference to the element at index, or None if it is out of bounds.
+		* The reference takes over the borrow of this slice.
+		*/
+		inline auto get_mut(usize index) && requires(Mutability) {
+			check();
+			if (index >= m_Len) {
+				return None<RefRaw<Type, true, false>>();
+			}
+
+			auto ptr = m_Ptr + index;
+			m_Ptr = nullptr;
+			m_Len = 0;
+			return Some<RefRaw<Type, true, false>>(element(ptr, std::move(m_Loan)));
+		}
+
+		/*
+		* Returns the element at index without any bounds checking.
+		*/
+		inline auto& get_unchecked(usize index) const {
+			check();
+			return m_Ptr[index];
+		}
+
+		inline auto begin() const {
+			check();
+			return m_Ptr;
+		}
+
+		inline auto end() const {
+			check();
+			return m_Ptr + m_Len;
+		}
+
+		/*
+		* Iterators over the elements, they keep the owner borrowed until they are dropped like
+		* the other views. iter_mut consumes the SliceMut, std::move(s).iter_mut().
+		*/
+		inline auto iter() const {
+			check();
+			using Source = internal::iter::Loaned<SliceIter<const Type>, false>;
+			return Iter<Source>(Source(SliceIter<const Type>(m_Ptr, m_Ptr + m_Len), loan<false>()));
+		}
+
+		inline auto iter_mut() && requires(Mutability) {
+			check();
+			using Source = internal::iter::Loaned<SliceIter<Type>, true>;
+			return Iter<Source>(Source(SliceIter<Type>(m_Ptr, m_Ptr + m_Len), std::move(m_Loan)));
+		}
+
+		/*
+		* Parallel iterators over the elements, they keep a reborrow of this slice until they are dropped.
+		*/
+		inline auto par_iter() const requires(Sync<Type>) {
+			check();
+			using Producer = internal::par::SliceProducer<Type, false>;
+			return ParIter<Producer>(Producer(derive<false>(0, m_Len)));
+		}
+
+		inline auto par_iter_mut() && requires(Mutability && Send<Type>) {
+			check();
+			using Producer = internal::par::SliceProducer<Type, true>;
+			return ParIter<Producer>(Producer(std::move(*this)));
+		}
+
+		/*
+		* A parallel iterator over chunks of size elements, the last one may be shorter.
+		*/
+		inline auto par_chunks_mut(usize size) && requires(Mutability && Send<Type>) {
+			check();
+			using Producer = internal::par::ChunksProducer<Type>;
+			return ParIter<Producer>(Producer(std::move(*this), size));
+		}
+
+		/*
+		* Reborrows a SliceMut as a Slice.
+		*/
+		inline auto as_slice() const {
+			check();
+			return derive<false>(0, m_Len);
+		}
+
+		/*
+		* Returns the subslice [start, end), a SliceMut gives a mutable one that takes over its borrow.
+		*/
+		inline auto slice(usize start, usize end) const& requires(!Mutability) {
+			check();
+			if (start > end || end > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			return derive<false>(start, end - start);
+		}
+
+		inline auto slice(usize start, usize end) && requires(Mutability) {
+			check();
+			if (start > end || end > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			auto view = SliceRaw(m_Ptr + start, end - start, std::move(m_Loan));
+			m_Ptr = nullptr;
+			m_Len = 0;
+			return view;
+		}
+
+		/*
+		* Divides one slice into two at an index, the first one holds [0, mid) and the second one [mid, len).
+		*/
+		inline auto split_at(usize mid) const {
+			check();
+			if (mid > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			return std::pair(derive<false>(0, mid), derive<false>(mid, m_Len - mid));
+		}
+
+		/*
+		* Divides one mutable slice into two disjoint mutable slices at an index and consumes it,
+		* both of them keep the owner borrowed.
+		*/
+		inline auto split_at_mut(usize mid) && requires(Mutability) {
+			check();
+			if (mid > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			auto second = derive<true>(mid, m_Len - mid);
+			auto first = SliceRaw(m_Ptr, mid, std::move(m_Loan));
+			m_Ptr = nullptr;
+			m_Len = 0;
+			return std::pair(std::move(first), std::move(second));
+		}
+
+		/*
+		* Iterates over chunks of size elements, the last one may be shorter.
+		*/
+		inline auto chunks(usize size) const {
+			check();
+			return ChunksRaw<Type, false, false>(derive<false>(0, m_Len), size);
+		}
+
+		inline auto chunks_mut(usize size) && requires(Mutability) {
+			check();
+			return ChunksRaw<Type, true, false>(std::move(*this), size);
+		}
+
+		/*
+		* Iterates over chunks of exactly size elements, the elements that do not
+		* fit in a chunk are available through remainder().
+		*/
+		inline auto chunks_exact(usize size) const {
+			check();
+			return ChunksRaw<Type, false, true>(derive<false>(0, m_Len), size);
+		}
+
+		inline auto chunks_exact_mut(usize size) && requires(Mutability) {
+			check();
+			return ChunksRaw<Type, true, true>(std::move(*this), size);
+		}
+
+		/*
+		* Iterates over all the overlapping windows of size elements.
+		*/
+		inline auto windows(usize size) const {
+			check();
+			return WindowsRaw<Type>(derive<false>(0, m_Len), size);
+		}
+
+		/*
+		* The scans below run on SIMD kernels for the primitive types.
+		*/
+		inline bool contains(const Type& value) const {
+			check();
+			return internal::slice_find<std::remove_const_t<Type>>(m_Ptr, m_Len, value) != m_Len;
+		}
+
+		/*
+		* Returns the index of the first element equal to value, or None.
+		*/
+		inline auto position(const Type& value) const {
+			check();
+			auto index = internal::slice_find<std::remove_const_t<Type>>(m_Ptr, m_Len, value);
+			if (index == m_Len) {
+				return None<usize>();
+			}
+
+			return Some<usize>(std::move(index));
+		}
+
+		inline usize count(const Type& value) const {
+			check();
+			return internal::slice_count<std::remove_const_t<Type>>(m_Ptr, m_Len, value);
+		}
+
+		/*
+		* Sums the elements, integers wrap around on overflow.
+		* Floats are added in several SIMD lanes that are summed at the end, this reassociates the
+		* additions, so the result can differ in the last bits from a loop adding them in order,
+		* and between CPUs that pick different vector widths.
+		*/
+		inline auto sum() const {
+			check();
+			return internal::slice_sum<std::remove_const_t<Type>>(m_Ptr, m_Len);
+		}
+
+		/*
+		* Returns the smallest element or None if the slice is empty, NaNs are ignored
+		* unless there is nothing else.
+		*/
+		inline auto min() const {
+			check();
+			return internal::slice_extremum<std::remove_const_t<Type>, false>(m_Ptr, m_Len);
+		}
+
+		inline auto max() const {
+			check();
+			return internal::slice_extremum<std::remove_const_t<Type>, true>(m_Ptr, m_Len);
+		}
+
+		template<bool M>
+		inline bool starts_with(const SliceRaw<Type, M>& needle) const {
+			check();
+			needle.check();
+			return needle.m_Len <= m_Len && internal::slice_eq<std::remove_const_t<Type>>(m_Ptr, needle.m_Ptr, needle.m_Len);
+		}
+
+		template<bool M>
+		inline bool ends_with(const SliceRaw<Type, M>& needle) const {
+			check();
+			needle.check();
+			return needle.m_Len <= m_Len && internal::slice_eq<std::remove_const_t<Type>>(m_Ptr + (m_Len - needle.m_Len), needle.m_Ptr, needle.m_Len);
+		}
+
+		template<bool M>
+		inline bool operator==(const SliceRaw<Type, M>& other) const {
+			check();
+			other.check();
+			return m_Len == other.m_Len && internal::slice_eq<std::remove_const_t<Type>>(m_Ptr, other.m_Ptr, m_Len);
+		}
+
+		/*
+		* Copies the elements into a new Vec.
+		*/
+		inline auto to_vec() const {
+			check();
+			auto vec = VecRaw<std::remove_const_t<Type>, 0, growth::Double>();
+			vec.extend(std::ranges::subrange(m_Ptr, m_Ptr + m_Len));
+			return vec;
+		}
+
+		inline constexpr bool is_ref_mutable() const {
+			return Mutability;
+		}
+
+	private:
+		// Another borrow of the owner for a view made from this slice, slices over raw memory have nothing to borrow
+		template<bool M>
+		inline auto loan() const {
+			static_assert(Mutability || !M, "A Slice can not be reborrowed mutably");
+
+			if (m_Loan.m_DropCheck.is_null()) {
+				return RefRaw<void, M, false>();
+			}
+			return m_Loan.template reborrow<M>();
+		}
+
+		// The slice [start, start + len) for one of the views made from this one
+		template<bool M>
+		inline auto derive(usize start, usize len) const {
+			return SliceRaw<Type, M>(m_Ptr + start, len, loan<M>());
+		}
+
+		// A reference to one element that takes over loan
+		template<bool M>
+		static inline auto element(RawPtr<ElementType> ptr, RefRaw<void, M, false>&& loan) {
+			auto ref = RefRaw<Type, M, false>(ptr, loan.m_ImmutableBorrowCount, loan.m_DropCheck);
+			loan.reset_values();
+			return ref;
+		}
+
+		// Reading through a slice of a dropped owner throws, it is a single branch that goes away without RS_CHECKED
+		inline void check() const {
+#if RS_CHECKED
+			if (!is_valid()) {
+				throw RefValueExpiredException();
+			}
+#endif
+		}
+
+		inline SliceRaw(RawPtr<ElementType> ptr, usize len, RefRaw<void, Mutability, false>&& loan)
+			: m_Ptr(ptr),
+			m_Len(len),
+			m_Loan(std::move(loan))
+		{
+		}
+
+	private:
+		RawPtr<ElementType> m_Ptr = nullptr;
+		usize m_Len = 0;
+		RefRaw<void, Mutability, false> m_Loan;
+
+		template<typename Ty, bool M>
+		friend class SliceRaw;
+
+		template<typename Ty, usize N, typename G>
+		friend class VecRaw;
+
+		template<typename Ty, bool Ts>
+		friend class ValRaw;
+
+		template<typename Ty, bool M, bool E>
+		friend class ChunksRaw;
+
+		template<typename Ty>
+		friend class WindowsRaw;
+	};
+
+	template<typename Type>
+	using Slice = SliceRaw<Type, false>;
+
+	template<typename Type>
+	using SliceMut = SliceRaw<Type, true>;
+
+	template<typename Type, usize N>
+	inline auto as_slice(Type(&array)[N]) {
+		return Slice<Type>::from_raw_parts(array, N);
+	}
+
+	template<typename Type, usize N>
+	inline auto as_mut_slice(Type(&array)[N]) {
+		return SliceMut<Type>::from_raw_parts(array, N);
+	}
+
+
+	/*
+	* The iterator returned by chunks, chunks_mut, chunks_exact and chunks_exact_mut, it keeps the
+	* slice it was made from and every chunk keeps the owner of the memory borrowed like that slice does.
+	*/
+	template<typename Type, bool Mutability, bool Exact>
+	class ChunksRaw {
+	public:
+		struct Sentinel {};
+
+		class Iterator {
+		public:
+			using value_type = SliceRaw<Type, Mutability>;
+			using difference_type = std::ptrdiff_t;
+
+			inline Iterator() = default;
+
+			inline Iterator(RawPtr<const ChunksRaw> chunks, usize start, usize len)
+				: m_Chunks(chunks),
+				m_Start(start),
+				m_Len(len)
+			{
+			}
+
+			inline auto operator*() const {
+				return m_Chunks->m_Slice.template derive<Mutability>(m_Start, std::min(m_Chunks->m_Size, m_Len));
+			}
+
+			inline auto operator++() -> Iterator& {
+				auto step = std::min(m_Chunks->m_Size, m_Len);
+				m_Start += step;
+				m_Len -= step;
+				return *this;
+			}
+
+			inline auto operator++(int) -> Iterator {
+				auto copy = *this;
+				++*this;
+				return copy;
+			}
+
+			inline bool operator==(Sentinel) const {
+				return Exact ? m_Len < m_Chunks->m_Size : m_Len == 0;
+			}
+
+		private:
+			RawPtr<const ChunksRaw> m_Chunks = nullptr;
+			usize m_Start = 0;
+			usize m_Len = 0;
+		};
+
+		inline ChunksRaw(SliceRaw<Type, Mutability>&& slice, usize size)
+			: m_Slice(std::move(slice)),
+			m_Size(size)
+		{
+			if (size == 0) {
+				throw std::invalid_argument("Chunk size must be non-zero");
+			}
+		}
+
+		inline auto begin() const { return Iterator(this, 0, m_Slice.len()); }
+
+		inline auto end() const { return Sentinel{}; }
+
+		/*
+		* The number of chunks.
+		*/
+		inline usize len() const {
+			return Exact ? m_Slice.len() / m_Size : (m_Slice.len() + m_Size - 1) / m_Size;
+		}
+
+		/*
+		* The elements left over by chunks_exact.
+		*/
+		inline auto remainder() const requires(Exact) {
+			auto tail = m_Slice.len() % m_Size;
+			return m_Slice.template derive<Mutability>(m_Slice.len() - tail, tail);
+		}
+
+	private:
+		SliceRaw<Type, Mutability> m_Slice;
+		usize m_Size;
+	};
+
+
+	/*
+	* The iterator returned by windows.
+	*/
+	template<typename Type>
+	class WindowsRaw {
+	public:
+		struct Sentinel {};
+
+		class Iterator {
+		public:
+			using value_type = SliceRaw<Type, false>;
+			using difference_type = std::ptrdiff_t;
+
+			inline Iterator() = default;
+
+			inline Iterator(RawPtr<const WindowsRaw> windows, usize start, usize len)
+				: m_Windows(windows),
+				m_Start(start),
+				m_Len(len)
+			{
+			}
+
+			inline auto operator*() const {
+				return m_Windows->m_Slice.template derive<false>(m_Start, m_Windows->m_Size);
+			}
+
+			inline auto operator++() -> Iterator& {
+				m_Start++;
+				m_Len--;
+				return *this;
+			}
+
+			inline auto operator++(int) -> Iterator {
+				auto copy = *this;
+				++*this;
+				return copy;
+			}
+
+			inline bool operator==(Sentinel) const {
+				return m_Len < m_Windows->m_Size;
+			}
+
+		private:
+			RawPtr<const WindowsRaw> m_Windows = nullptr;
+			usize m_Start = 0;
+			usize m_Len = 0;
+		};
+
+		inline WindowsRaw(SliceRaw<Type, false>&& slice, usize size)
+			: m_Slice(std::move(slice)),
+			m_Size(size)
+		{
+			if (size == 0) {
+				throw std::invalid_argument("Window size must be non-zero");
+			}
+		}
+
+		inline auto begin() const { return Iterator(this, 0, m_Slice.len()); }
+
+		inline auto end() const { return Sentinel{}; }
+
+		inline usize len() const {
+			return m_Slice.len() < m_Size ? 0 : m_Slice.len() - m_Size + 1;
+		}
+
+	private:
+		SliceRaw<Type, false> m_Slice;
+		usize m_Size;
+	};
+
+
+	/*
+	* A contiguous growable array type, the equivalent of Vec<T>.
+	*
+	* The first InlineCapacity elements are stored inside the object itself (see SmallVec),
+	* Growth decides how the capacity grows (see rs::growth). Types which are trivially
+	* relocatable are moved around with memcpy/realloc when the buffer grows.
+	*
+	* The Vec can be borrowed as a Slice or a SliceMut, while it is borrowed any attempt to
+	* modify it throws and once it is dropped all the slices borrowed from it expire.
+	*/
+	template<typename Type, usize InlineCapacity, typename Growth>
+	class VecRaw {
+	public:
+		inline VecRaw() noexcept
+			: m_Capacity(InlineCapacity),
+			m_Resource(internal::t_Resource)
+		{
+			m_Data = m_Inline.data();
+		}
+
+		inline VecRaw(std::initializer_list<Type> values)
+			: VecRaw()
+		{
+			extend(values);
+		}
+
+		/*
+		* Constructs a new, empty Vec with at least the specified capacity.
+		*/
+		static inline auto with_capacity(usize capacity) {
+			auto vec = VecRaw();
+			vec.reserve_exact(capacity);
+			return vec;
+		}
+
+		inline VecRaw(VecRaw&& other)
+			: VecRaw()
+		{
+			take_from(other);
+		}
+
+		inline VecRaw(VecRaw& other)
+			: VecRaw()
+		{
+			take_from(other);
+		}
+
+		inline VecRaw(const VecRaw& other) = delete;
+
+		inline auto operator=(VecRaw&& other) -> VecRaw& {
+			if (this != &other) {
+				other.check_not_borrowed();
+				drop();
+				take_from(other);
+			}
+			return *this;
+		}
+
+		inline auto operator=(VecRaw& other) -> VecRaw& {
+			return *this = std::move(other);
+		}
+
+		inline auto operator=(const VecRaw& other) = delete;
+
+		inline ~VecRaw() {
+			drop();
+		}
+
+		/*
+		* Drops all the elements and releases the buffer, the slices borrowed from
+		* this Vec expire. The Vec is left empty and can be used again.
+		*/
+		inline void drop() {
+			if (!m_DropCheck.is_null()) {
+				m_DropCheck.drop();
+				m_DropCheck = ValidityChecker<false>();
+			}
+
+			std::destroy_n(m_Data, m_Len);
+			if (!is_inline()) {
+				deallocate(m_Data, m_Capacity);
+			}
+
+			m_Data = m_Inline.data();
+			m_Len = 0;
+			m_Capacity = InlineCapacity;
+			m_ImmutableBorrowCount = 0;
+			m_IsMutableBorrowed = false;
+		}
+
+		inline usize len() const { return m_Len; }
+
+		inline usize capacity() const { return m_Capacity; }
+
+		inline bool is_empty() const { return m_Len == 0; }
+
+		/*
+		* Returns true if the elements no longer fit in the inline storage.
+		*/
+		inline bool spilled() const { return !is_inline(); }
+
+		inline auto as_ptr() const -> RawPtr<const Type> { return m_Data; }
+
+		inline auto as_mut_ptr() -> RawPtr<Type> {
+			check_writable();
+			return m_Data;
+		}
+
+		/*
+		* Sets the length without touching the elements, the first len elements must be initialized.
+		*/
+		inline void unsafe_set_len(usize len) { m_Len = len; }
+
+		inline u32 num_borrows() const {
+			return m_ImmutableBorrowCount;
+		}
+
+		inline bool is_mutable_borrowed() const {
+			return m_IsMutableBorrowed;
+		}
+
+		/*
+		* Appends an element to the back of the collection.
+		*/
+		inline void push(Type&& value) {
+			check_not_borrowed();
+
+			if (m_Len == m_Capacity) {
+				// the value might live inside of this Vec, so it is moved out before growing
+				auto temp = Type(std::move(value));
+				grow(m_Len + 1);
+				new (m_Data + m_Len) Type(std::move(temp));
+			}
+			else {
+				new (m_Data + m_Len) Type(std::move(value));
+			}
+
+			m_Len++;
+		}
+
+		inline void push(const Type& value) {
+			push(Type(value));
+		}
+
+		/*
+		* Removes the last element and returns it, or None if it is empty.
+		*/
+		inline auto pop() {
+			check_not_borrowed();
+
+			if (m_Len == 0) {
+				return None<Type>();
+			}
+
+			m_Len--;
+			auto value = Type(std::move(m_Data[m_Len]));
+			std::destroy_at(m_Data + m_Len);
+			return Some<Type>(std::move(value));
+		}
+
+		/*
+		* Inserts an element at position index, shifting all elements after it to the right.
+		*/
+		inline void insert(usize index, Type&& value) {
+			check_not_borrowed();
+
+			if (index > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			if (m_Len == m_Capacity) {
+				auto temp = Type(std::move(value));
+				grow(m_Len + 1);
+				insert_unchecked(index, std::move(temp));
+			}
+			else {
+				insert_unchecked(index, std::move(value));
+			}
+		}
+
+		inline void insert(usize index, const Type& value) {
+			insert(index, Type(value));
+		}
+
+		/*
+		* Removes and returns the element at position index, shifting all elements after it to the left.
+		*/
+		inline auto remove(usize index) {
+			check_not_borrowed();
+
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			auto value = Type(std::move(m_Data[index]));
+			if constexpr (IsTriviallyRelocatable<Type>) {
+				std::destroy_at(m_Data + index);
+				std::memmove(static_cast<void*>(m_Data + index), m_Data + index + 1, (m_Len - index - 1) * sizeof(Type));
+			}
+			else {
+				std::move(m_Data + index + 1, m_Data + m_Len, m_Data + index);
+				std::destroy_at(m_Data + m_Len - 1);
+			}
+			m_Len--;
+			return value;
+		}
+
+		/*
+		* Removes an element and returns it, replacing it with the last element.
+		* This does not preserve ordering, but is O(1).
+		*/
+		inline auto swap_remove(usize index) {
+			check_not_borrowed();
+
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			auto value = Type(std::move(m_Data[index]));
+			if (index != m_Len - 1) {
+				m_Data[index] = std::move(m_Data[m_Len - 1]);
+			}
+			std::destroy_at(m_Data + m_Len - 1);
+			m_Len--;
+			return value;
+		}
+
+		/*
+		* Shortens the vector, keeping the first len elements and dropping the rest.
+		*/
+		inline void truncate(usize len) {
+			check_not_borrowed();
+
+			if (len < m_Len) {
+				std::destroy(m_Data + len, m_Data + m_Len);
+				m_Len = len;
+			}
+		}
+
+		inline void clear() {
+			truncate(0);
+		}
+
+		/*
+		* Reserves capacity for at least additional more elements, following the growth policy.
+		*/
+		inline void reserve(usize additional) {
+			check_not_borrowed();
+
+			if (m_Capacity - m_Len < additional) {
+				grow(m_Len + additional);
+			}
+		}
+
+		/*
+		* Reserves capacity for exactly additional more elements.
+		*/
+		inline void reserve_exact(usize additional) {
+			check_not_borrowed();
+
+			if (m_Capacity - m_Len < additional) {
+				reallocate(checked_capacity(m_Len + additional));
+			}
+		}
+
+		/*
+		* Appends all the elements of a range, trivially copyable elements of
+		* a contiguous range are copied in one go.
+		*/
+		template<std::ranges::input_range Range>
+		inline void extend(Range&& range) {
+			check_not_borrowed();
+
+			if constexpr (std::ranges::sized_range<Range>) {
+				reserve(static_cast<usize>(std::ranges::size(range)));
+			}
+
+			if constexpr (std::ranges::contiguous_range<Range>
+				&& std::is_same_v<std::ranges::range_value_t<Range>, Type>
+				&& std::is_trivially_copyable_v<Type>) {
+				auto count = static_cast<usize>(std::ranges::size(range));
+				if (count > 0) {
+					std::memcpy(static_cast<void*>(m_Data + m_Len), std::ranges::data(range), count * sizeof(Type));
+					m_Len += count;
+				}
+			}
+			else {
+				for (auto&& value : range) {
+					push(Type(value));
+				}
+			}
+		}
+
+		inline void extend(std::initializer_list<Type> values) {
+			extend(std::views::all(values));
+		}
+
+		/*
+		* Removes the elements in [start, end) and returns them in a new Vec.
+		*/
+		inline auto drain(usize start, usize end) {
+			check_not_borrowed();
+
+			if (start > end || end > m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			auto drained = VecRaw<Type, 0, Growth>::with_capacity(end - start);
+			relocate(m_Data + start, end - start, drained.m_Data);
+			drained.m_Len = end - start;
+
+			if constexpr (IsTriviallyRelocatable<Type>) {
+				std::memmove(static_cast<void*>(m_Data + start), m_Data + end, (m_Len - end) * sizeof(Type));
+			}
+			else {
+				for (usize i = end; i < m_Len; i++) {
+					new (m_Data + start + i - end) Type(std::move(m_Data[i]));
+					std::destroy_at(m_Data + i);
+				}
+			}
+			m_Len -= end - start;
+			return drained;
+		}
+
+		/*
+		* Retains only the elements specified by the predicate, in place and preserving the order.
+		*/
+		template<typename Predicate>
+		inline void retain(Predicate&& predicate) {
+			check_not_borrowed();
+
+			usize kept = 0;
+			for (usize i = 0; i < m_Len; i++) {
+				if (predicate(std::as_const(m_Data[i]))) {
+					if (kept != i) {
+						m_Data[kept] = std::move(m_Data[i]);
+					}
+					kept++;
+				}
+			}
+
+			std::destroy(m_Data + kept, m_Data + m_Len);
+			m_Len = kept;
+		}
+
+		/*
+		* Borrows the contents as a Slice, the Vec can not be modified until all the slices are dropped.
+		*/
+		inline auto as_slice() {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			m_ImmutableBorrowCount++;
+			return Slice<Type>(m_Data, m_Len, RefRaw<void, false, false>(this, &m_ImmutableBorrowCount, drop_check()));
+		}
+
+		/*
+		* Borrows the contents as a SliceMut, the Vec can not be used until it is dropped.
+		*/
+		inline auto as_mut_slice() {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			m_IsMutableBorrowed = true;
+			return SliceMut<Type>(m_Data, m_Len, RefRaw<void, true, false>(this, &m_IsMutableBorrowed, drop_check()));
+		}
+
+		/*
+		* Indexing goes through the same borrow state as the slices, a Vec that lent out
+		* a SliceMut can not be read and one that lent out a Slice can not be written.
+		*/
+		inline auto& operator[](usize index) {
+			check_writable();
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			return m_Data[index];
+		}
+
+		inline const auto& operator[](usize index) const {
+			check_readable();
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+
+			return m_Data[index];
+		}
+
+		inline auto begin() {
+			check_writable();
+			return m_Data;
+		}
+
+		inline auto end() {
+			check_writable();
+			return m_Data + m_Len;
+		}
+
+		inline auto begin() const -> RawPtr<const Type> {
+			check_readable();
+			return m_Data;
+		}
+
+		inline auto end() const -> RawPtr<const Type> {
+			check_readable();
+			return m_Data + m_Len;
+		}
+
+		/*
+		* The iterators borrow the Vec just like the slices, until they are dropped.
+		*/
+		inline auto iter() const {
+			using Source = internal::iter::Loaned<SliceIter<const Type>, false>;
+			auto loan = borrow();
+			return Iter<Source>(Source(SliceIter<const Type>(m_Data, m_Data + m_Len), std::move(loan)));
+		}
+
+		inline auto iter_mut() {
+			using Source = internal::iter::Loaned<SliceIter<Type>, true>;
+			auto loan = borrow_mut();
+			return Iter<Source>(Source(SliceIter<Type>(m_Data, m_Data + m_Len), std::move(loan)));
+		}
+
+		/*
+		* Parallel iterators over the elements, the Vec is borrowed until they are dropped.
+		*/
+		inline auto par_iter() requires(Sync<Type>) {
+			using Producer = internal::par::SliceProducer<Type, false>;
+			return ParIter<Producer>(Producer(as_slice()));
+		}
+
+		inline auto par_iter_mut() requires(Send<Type>) {
+			using Producer = internal::par::SliceProducer<Type, true>;
+			return ParIter<Producer>(Producer(as_mut_slice()));
+		}
+
+		inline auto par_chunks_mut(usize size) requires(Send<Type>) {
+			using Producer = internal::par::ChunksProducer<Type>;
+			return ParIter<Producer>(Producer(as_mut_slice(), size));
+		}
+
+		inline auto clone() const {
+			auto vec = VecRaw();
+			vec.extend(std::ranges::subrange(begin(), end()));
+			return vec;
+		}
+
+	private:
+		inline bool is_inline() const {
+			if constexpr (InlineCapacity > 0) {
+				return m_Data == const_cast<VecRaw*>(this)->m_Inline.data();
+			}
+			else {
+				return false;
+			}
+		}
+
+		inline void check_not_borrowed() const {
+			if (m_ImmutableBorrowCount | static_cast<u32>(m_IsMutableBorrowed)) {
+				if (m_IsMutableBorrowed) {
+					throw StillBorrowedMutablyException();
+				}
+				throw StillBorrowedImmutablyException();
+			}
+		}
+
+		inline void check_readable() const {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+		}
+
+		inline void check_writable() const {
+			check_readable();
+			if (m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+		}
+
+		inline auto drop_check() const -> ValidityChecker<false>& {
+			if (m_DropCheck.is_null()) {
+				m_DropCheck = ValidityChecker<false>(true);
+			}
+			return m_DropCheck;
+		}
+
+		inline auto borrow() const {
+			check_readable();
+			m_ImmutableBorrowCount++;
+			return RefRaw<void, false, false>(this, &m_ImmutableBorrowCount, drop_check());
+		}
+
+		inline auto borrow_mut() {
+			check_writable();
+			m_IsMutableBorrowed = true;
+			return RefRaw<void, true, false>(this, &m_IsMutableBorrowed, drop_check());
+		}
+
+		inline void take_from(VecRaw& other) {
+			other.check_not_borrowed();
+
+			if (other.is_inline()) {
+				relocate(other.m_Data, other.m_Len, m_Data);
+			}
+			else {
+				// the buffer goes back to the resource it came from
+				m_Data = other.m_Data;
+				m_Capacity = other.m_Capacity;
+				m_Resource = other.m_Resource;
+			}
+			m_Len = other.m_Len;
+			m_DropCheck = std::move(other.m_DropCheck);
+
+			other.m_Data = other.m_Inline.data();
+			other.m_Len = 0;
+			other.m_Capacity = InlineCapacity;
+		}
+
+		inline void insert_unchecked(usize index, Type&& value) {
+			if (index == m_Len) {
+				new (m_Data + m_Len) Type(std::move(value));
+			}
+			else if constexpr (IsTriviallyRelocatable<Type>) {
+				std::memmove(static_cast<void*>(m_Data + index + 1), m_Data + index, (m_Len - index) * sizeof(Type));
+				new (m_Data + index) Type(std::move(value));
+			}
+			else {
+				new (m_Data + m_Len) Type(std::move(m_Data[m_Len - 1]));
+				std::move_backward(m_Data + index, m_Data + m_Len - 1, m_Data + m_Len);
+				m_Data[index] = std::move(value);
+			}
+			m_Len++;
+		}
+
+		inline void grow(usize required) {
+			reallocate(checked_capacity(Growth::grow(m_Capacity, required)));
+		}
+
+		static inline usize checked_capacity(usize capacity) {
+			if (capacity > std::numeric_limits<usize>::max() / sizeof(Type)) {
+				throw std::length_error("Vec capacity overflow");
+			}
+			return capacity;
+		}
+
+		inline void reallocate(usize capacity) {
+			if constexpr (IsTriviallyRelocatable<Type> && alignof(Type) <= alignof(std::max_align_t)) {
+				// realloc can often grow the block in place
+				if (!is_inline() && m_Resource == nullptr) {
+					auto data = std::realloc(static_cast<void*>(m_Data), capacity * sizeof(Type));
+					if (data == nullptr) {
+						throw std::bad_alloc();
+					}
+					m_Data = static_cast<RawPtr<Type>>(data);
+					m_Capacity = capacity;
+					return;
+				}
+			}
+
+			auto data = allocate(capacity);
+			relocate(m_Data, m_Len, data);
+			if (!is_inline()) {
+				deallocate(m_Data, m_Capacity);
+			}
+			m_Data = data;
+			m_Capacity = capacity;
+		}
+
+		static inline void relocate(RawPtr<Type> from, usize count, RawPtr<Type> to) {
+			if constexpr (IsTriviallyRelocatable<Type>) {
+				if (count > 0) {
+					std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(Type));
+				}
+			}
+			else {
+				for (usize i = 0; i < count; i++) {
+					new (to + i) Type(std::move(from[i]));
+					std::destroy_at(from + i);
+				}
+			}
+		}
+
+		inline auto allocate(usize capacity) -> RawPtr<Type> {
+			if (m_Resource != nullptr) {
+				return static_cast<RawPtr<Type>>(m_Resource->allocate(capacity * sizeof(Type), alignof(Type)));
+			}
+
+			if constexpr (alignof(Type) > alignof(std::max_align_t)) {
+				return static_cast<RawPtr<Type>>(::operator new(capacity * sizeof(Type), std::align_val_t(alignof(Type))));
+			}
+			else {
+				auto data = std::malloc(capacity * sizeof(Type));
+				if (data == nullptr) {
+					throw std::bad_alloc();
+				}
+				return static_cast<RawPtr<Type>>(data);
+			}
+		}
+
+		inline void deallocate(RawPtr<Type> data, usize capacity) {
+			if (m_Resource != nullptr) {
+				// an empty Vec without inline storage has no buffer at all
+				if (data != nullptr) {
+					m_Resource->deallocate(data, capacity * sizeof(Type), alignof(Type));
+				}
+				return;
+			}
+
+			if constexpr (alignof(Type) > alignof(std::max_align_t)) {
+				::operator delete(data, std::align_val_t(alignof(Type)));
+			}
+			else {
+				std::free(data);
+			}
+		}
+
+	private:
+		RawPtr<Type> m_Data = nullptr;
+		usize m_Len = 0;
+		usize m_Capacity = 0;
+		// mutable so that iter() can borrow a const Vec
+		mutable u32 m_ImmutableBorrowCount = 0;
+		mutable u32 m_IsMutableBorrowed = 0;
+		mutable ValidityChecker<false> m_DropCheck;
+		RawPtr<std::pmr::memory_resource> m_Resource;
+		[[no_unique_address]] internal::InlineStorage<Type, InlineCapacity> m_Inline;
+
+		template<typename Ty, usize N, typename G>
+		friend class VecRaw;
+	};
+
+	template<typename Type, typename Growth = growth::Double>
+	using Vec = VecRaw<Type, 0, Growth>;
+
+	template<typename Type, usize InlineCapacity, typename Growth = growth::Double>
+	using SmallVec = VecRaw<Type, InlineCapacity, Growth>;
+
+	template<typename Type, typename Growth = growth::Double>
+	inline auto MakeVec(std::initializer_list<Type> values) {
+		return Vec<Type, Growth>(values);
+	}
+}
+
+// Arena
+namespace rs {
+
+	namespace internal::arena {
+
+		// The header of a chunk, the bytes handed out follow it
+		struct Chunk {
+			inline auto begin() {
+				return reinterpret_cast<RawPtr<std::byte>>(this + 1);
+			}
+
+			inline auto end() {
+				return begin() + m_Size;
+			}
+
+			RawPtr<Chunk> m_Next;
+			usize m_Size;
+		};
+
+		// A value with a destructor, it is allocated next to the value so the list costs no allocation
+		struct DropEntry {
+			RawPtr<void> m_Value;
+			void (*m_Drop)(RawPtr<void>);
+			RawPtr<DropEntry> m_Next;
+		};
+
+		// What alloc places in the arena, the borrow counters of ValRaw live next to the value
+		template<typename Type>
+		struct Slot {
+			template<typename... Args>
+			inline explicit Slot(Args&&... args)
+				: m_Value(std::forward<Args>(args)...)
+			{
+			}
+
+			u32 m_ImmutableBorrowCount = 0;
+			u32 m_IsMutableBorrowed = 0;
+			Type m_Value;
+		};
+	}
+
+	/*
+	* A value living in an Arena, the handle alloc returns. It borrows like a Val, but the value
+	* belongs to the arena: dropping the handle leaves it alone, it is destroyed when the arena is
+	* reset or destroyed. The Refs made from it expire at that point, using it afterwards throws
+	* RefValueExpiredException instead of reading freed memory.
+	*/
+	template<typename Type>
+	class ArenaVal {
+	public:
+		inline ArenaVal(ArenaVal&& other) noexcept
+			: m_Slot(other.m_Slot),
+			m_Epoch(std::move(other.m_Epoch))
+		{
+			other.m_Slot = nullptr;
+		}
+
+		inline auto operator=(ArenaVal&& other) noexcept -> ArenaVal& {
+			if (this != &other) {
+				m_Slot = other.m_Slot;
+				m_Epoch = std::move(other.m_Epoch);
+				other.m_Slot = nullptr;
+			}
+			return *this;
+		}
+
+		inline ArenaVal(const ArenaVal&) = delete;
+		inline auto operator=(const ArenaVal&) -> ArenaVal& = delete;
+
+		inline ~ArenaVal() = default;
+
+		// Whether the handle was not moved from and the arena was not reset since
+		inline bool is_valid() const {
+			return m_Slot != nullptr && m_Epoch.is_valid();
+		}
+
+		inline operator bool() const {
+			return is_valid();
+		}
+
+		inline auto value() -> RawPtr<Type> {
+			return &slot()->m_Value;
+		}
+
+		inline auto value() const -> RawPtr<const Type> {
+			return &slot()->m_Value;
+		}
+
+		inline auto operator->() {
+			return value();
+		}
+
+		inline auto operator->() const {
+			return value();
+		}
+
+		inline auto& operator*() {
+			return *value();
+		}
+
+		inline const auto& operator*() const {
+			return *value();
+		}
+
+		inline u32 num_borrows() const {
+			return slot()->m_ImmutableBorrowCount;
+		}
+
+		inline bool is_mutable_borrowed() const {
+			return slot()->m_IsMutableBorrowed;
+		}
+
+		inline auto borrow() {
+			auto slot = this->slot();
+			if (slot->m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			slot->m_ImmutableBorrowCount++;
+			return Ref<Type>(&slot->m_Value, &slot->m_ImmutableBorrowCount, m_Epoch);
+		}
+
+		inline auto borrow_mut() {
+			auto slot = this->slot();
+			if (slot->m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (slot->m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			slot->m_IsMutableBorrowed = true;
+			return RefMut<Type>(&slot->m_Value, &slot->m_IsMutableBorrowed, m_Epoch);
+		}
+
+	private:
+		inline ArenaVal(RawPtr<internal::arena::Slot<Type>> slot, const ValidityChecker<false>& epoch)
+			: m_Slot(slot),
+			m_Epoch(epoch)
+		{
+		}
+
+		inline auto slot() const {
+			if (m_Slot == nullptr) {
+				throw ValValueMovedException();
+			}
+
+			if (!m_Epoch.is_valid()) {
+				throw RefValueExpiredException();
+			}
+
+			return m_Slot;
+		}
+
+	private:
+		RawPtr<internal::arena::Slot<Type>> m_Slot;
+		ValidityChecker<false> m_Epoch;
+
+		friend class Arena;
+	};
+
+	/*
+	* A region allocator: values are bump allocated from chunks that are chained as they fill up
+	* and everything is freed at once by reset() or when the arena is destroyed. No value is
+	* freed on its own, which makes an allocation a pointer increment and freeing a whole
+	* batch of values (the nodes of a parse tree, everything made while handling a request)
+	* a pointer reset. Only values with a destructor are remembered, to run it at the reset.
+	*
+	* The borrows of all values allocated between two resets share one ValidityChecker, it is
+	* the only thing not placed in the chunks (it has to outlive them to notice stale Refs) and
+	* it is created once per reset, on the first allocation.
+	*/
+	class Arena {
+	public:
+		static constexpr usize DefaultChunkSize = 4096;
+
+		inline Arena()
+			: Arena(DefaultChunkSize)
+		{
+		}
+
+		// The size of the first chunk, every chunk allocated after it doubles the size
+		inline explicit Arena(usize chunkSize)
+			: m_ChunkSize(std::max<usize>(chunkSize, sizeof(internal::arena::DropEntry)))
+		{
+		}
+
+		inline Arena(const Arena&) = delete;
+		inline auto operator=(const Arena&) -> Arena& = delete;
+
+		inline ~Arena() {
+			clear();
+
+			auto chunk = m_First;
+			while (chunk != nullptr) {
+				auto next = chunk->m_Next;
+				::operator delete(chunk);
+				chunk = next;
+			}
+		}
+
+		/*
+		* Constructs a Type in the arena from args. The value lives until the next reset.
+		*/
+		template<typename Type, typename... Args>
+		inline auto alloc(Args&&... args) {
+			using Slot = internal::arena::Slot<Type>;
+
+			auto memory = alloc_raw(sizeof(Slot), alignof(Slot));
+			if constexpr (std::is_trivially_destructible_v<Type>) {
+				auto slot = new (memory) Slot(std::forward<Args>(args)...);
+				return ArenaVal<Type>(slot, epoch());
+			}
+			else {
+				// The entry is reserved before the value is constructed, a value that exists is always destroyed
+				auto entry = alloc_raw(sizeof(internal::arena::DropEntry), alignof(internal::arena::DropEntry));
+				auto slot = new (memory) Slot(std::forward<Args>(args)...);
+				m_Drops = new (entry) internal::arena::DropEntry{
+					slot,
+					[](RawPtr<void> value) { static_cast<RawPtr<Slot>>(value)->~Slot(); },
+					m_Drops
+				};
+				return ArenaVal<Type>(slot, epoch());
+			}
+		}
+
+		/*
+		* Uninitialized memory from the arena, it is reclaimed by the next reset as well.
+		*/
+		inline auto alloc_raw(usize size, usize align) -> RawPtr<void> {
+			auto ptr = align_up(m_Ptr, align);
+			if (ptr == nullptr || ptr + size > m_End) {
+				ptr = align_up(next_chunk(size + align), align);
+			}
+
+			m_Ptr = ptr + size;
+			m_Allocated += size;
+			return ptr;
+		}
+
+		/*
+		* Destroys all the values and makes all the memory available again, all the handles and
+		* Refs of the values expire. The chunks are kept, so an arena that is reset in a loop
+		* stops allocating once it has grown to what one iteration needs.
+		*/
+		inline void reset() {
+			clear();
+
+			m_Current = m_First;
+			if (m_Current != nullptr) {
+				m_Ptr = m_Current->begin();
+				m_End = m_Current->end();
+			}
+		}
+
+		// The bytes handed out since the last reset
+		inline usize allocated_bytes() const {
+			return m_Allocated;
+		}
+
+		// The bytes held in chunks
+		inline usize capacity() const {
+			auto capacity = usize(0);
+			for (auto chunk = m_First; chunk != nullptr; chunk = chunk->m_Next) {
+				capacity += chunk->m_Size;
+			}
+			return capacity;
+		}
+
+	private:
+		static inline auto align_up(RawPtr<std::byte> ptr, usize align) -> RawPtr<std::byte> {
+			auto address = reinterpret_cast<std::uintptr_t>(ptr);
+			return reinterpret_cast<RawPtr<std::byte>>((address + align - 1) & ~(align - 1));
+		}
+
+		// Moves to the next chunk that fits size, a new one is linked in after the current one if none does
+		inline auto next_chunk(usize size) -> RawPtr<std::byte> {
+			auto next = m_Current != nullptr ? m_Current->m_Next : m_First;
+			if (next == nullptr || next->m_Size < size) {
+				auto bytes = std::max(m_ChunkSize, size);
+				next = new (::operator new(sizeof(internal::arena::Chunk) + bytes)) internal::arena::Chunk{ next, bytes };
+				m_ChunkSize *= 2;
+
+				if (m_Current != nullptr) {
+					m_Current->m_Next = next;
+				}
+				else {
+					m_First = next;
+				}
+			}
+
+			m_Current = next;
+			m_Ptr = next->begin();
+			m_End = next->end();
+			return m_Ptr;
+		}
+
+		inline auto epoch() -> ValidityChecker<false>& {
+			if (m_Epoch.is_null()) {
+				m_Epoch = ValidityChecker<false>(true);
+			}
+			return m_Epoch;
+		}
+
+		// Runs the destructors, newest value first, and expires the handles and Refs
+		inline void clear() {
+			while (m_Drops != nullptr) {
+				auto entry = m_Drops;
+				m_Drops = entry->m_Next;
+				entry->m_Drop(entry->m_Value);
+			}
+
+			if (!m_Epoch.is_null()) {
+				m_Epoch.drop();
+				m_Epoch = ValidityChecker<false>();
+			}
+			m_Allocated = 0;
+		}
+
+	private:
+		RawPtr<internal::arena::Chunk> m_First = nullptr;
+		RawPtr<internal::arena::Chunk> m_Current = nullptr;
+		RawPtr<std::byte> m_Ptr = nullptr;
+		RawPtr<std::byte> m_End = nullptr;
+		RawPtr<internal::arena::DropEntry> m_Drops = nullptr;
+		ValidityChecker<false> m_Epoch;
+		usize m_ChunkSize;
+		usize m_Allocated = 0;
+	};
+
+	template<>
+	struct IsSend<Arena> : std::false_type {};
+
+	template<>
+	struct IsSync<Arena> : std::false_type {};
+
+	template<typename Type>
+	struct IsSend<ArenaVal<Type>> : std::false_type {};
+
+	template<typename Type>
+	struct IsSync<ArenaVal<Type>> : std::false_type {};
+}
+
+// Object pools
+namespace rs {
+
+	template<typename Type>
+	class Pool;
+
+	namespace internal::object_pool {
+
+		template<typename Type>
+		struct Cache;
+
+		// What a pool shares with the caches of the threads using it, it lives as long as one of them
+		template<typename Type>
+		struct Shared {
+			std::mutex m_Mutex;
+			std::vector<RawPtr<Type>> m_Free;
+			std::vector<RawPtr<Cache<Type>>> m_Caches;
+			std::atomic_bool m_IsDead = false;
+			std::atomic<usize> m_Idle = 0;
+			std::atomic<usize> m_Live = 0;
+			std::atomic<usize> m_HighWaterMark = 0;
+			std::atomic<usize> m_Created = 0;
+		};
+
+		// The objects one thread gave back to a pool, only that thread touches them while the pool is alive
+		template<typename Type>
+		struct Cache {
+			inline explicit Cache(std::shared_ptr<Shared<Type>> shared)
+				: m_Shared(std::move(shared))
+			{
+			}
+
+			inline Cache(const Cache&) = delete;
+			inline auto operator=(const Cache&) -> Cache& = delete;
+
+			// The thread exits, what it cached goes to the shared list if the pool is still there
+			inline ~Cache() {
+				auto lock = std::lock_guard<std::mutex>(m_Shared->m_Mutex);
+				if (!m_Shared->m_IsDead.load(std::memory_order_relaxed)) {
+					m_Shared->m_Free.insert(m_Shared->m_Free.end(), m_Free.begin(), m_Free.end());
+					std::erase(m_Shared->m_Caches, this);
+				}
+			}
+
+			std::vector<RawPtr<Type>> m_Free;
+			std::shared_ptr<Shared<Type>> m_Shared;
+		};
+	}
+
+	/*
+	* An object taken from a Pool, it owns the object like a Val does. Dropping it, through drop()
+	* or the destructor, hands the object back to the pool instead of destroying it.
+	* The pool must outlive the objects taken from it.
+	*/
+	template<typename Type>
+	class PooledVal {
+	public:
+		inline PooledVal(PooledVal&& other) noexcept
+			: m_Pool(other.m_Pool),
+			m_Value(other.m_Value)
+		{
+			other.m_Value = nullptr;
+		}
+
+		inline auto operator=(PooledVal&& other) -> PooledVal& {
+			if (this != &other) {
+				drop();
+				m_Pool = other.m_Pool;
+				m_Value = other.m_Value;
+				other.m_Value = nullptr;
+			}
+			return *this;
+		}
+
+		inline PooledVal(const PooledVal&) = delete;
+		inline auto operator=(const PooledVal&) -> PooledVal& = delete;
+
+		inline ~PooledVal() {
+			drop();
+		}
+
+		inline void drop() {
+			if (m_Value != nullptr) {
+				auto value = m_Value;
+				m_Value = nullptr;
+				m_Pool->release(value);
+			}
+		}
+
+		inline bool is_valid() const {
+			return m_Value != nullptr;
+		}
+
+		inline operator bool() const {
+			return is_valid();
+		}
+
+		inline auto value() -> RawPtr<Type> {
+			if (!is_valid()) {
+				throw ValValueMovedException();
+			}
+			return m_Value;
+		}
+
+		inline auto value() const -> RawPtr<const Type> {
+			if (!is_valid()) {
+				throw ValValueMovedException();
+			}
+			return m_Value;
+		}
+
+		inline auto operator->() {
+			return value();
+		}
+
+		inline auto operator->() const {
+			return value();
+		}
+
+		inline auto& operator*() {
+			return *value();
+		}
+
+		inline const auto& operator*() const {
+			return *value();
+		}
+
+	private:
+		inline PooledVal(RawPtr<Pool<Type>> pool, RawPtr<Type> value)
+			: m_Pool(pool),
+			m_Value(value)
+		{
+		}
+
+	private:
+		RawPtr<Pool<Type>> m_Pool;
+		RawPtr<Type> m_Value;
+
+		friend class Pool<Type>;
+	};
+
+	/*
+	* Keeps objects that are expensive to make (big buffers, connections, ...) around for reuse.
+	*
+	* acquire() hands out an idle object or makes a new one, dropping the PooledVal gives it back,
+	* after running the reset hook on it if there is one. Every thread keeps the objects it gives
+	* back in a small cache of its own, so taking and returning objects on the same thread takes no
+	* lock, a full cache moves half of its objects to a shared list that an empty one refills from.
+	* At most maxIdle objects are kept, the ones given back beyond that are destroyed.
+	*
+	* A pool can be used from any number of threads but must not be destroyed while in use.
+	* The reset hook must not throw when the PooledVal is dropped by its destructor.
+	*/
+	template<typename Type>
+	class Pool {
+	public:
+		static constexpr usize CacheSize = 32;
+		static constexpr usize DefaultMaxIdle = 1024;
+
+		inline Pool() requires(std::default_initializable<Type>)
+			: Pool([] { return Type(); })
+		{
+		}
+
+		inline explicit Pool(std::function<Type()> create, std::function<void(Type&)> reset = nullptr, usize maxIdle = DefaultMaxIdle)
+			: m_Create(std::move(create)),
+			m_Reset(std::move(reset)),
+			m_MaxIdle(maxIdle),
+			m_Shared(std::make_shared<internal::object_pool::Shared<Type>>()),
+			m_Id(s_NextId.fetch_add(1, std::memory_order_relaxed))
+		{
+		}
+
+		inline Pool(const Pool&) = delete;
+		inline auto operator=(const Pool&) -> Pool& = delete;
+
+		// Destroys the idle objects, including the ones in the caches of other threads
+		inline ~Pool() {
+			auto lock = std::lock_guard<std::mutex>(m_Shared->m_Mutex);
+			for (auto cache : m_Shared->m_Caches) {
+				destroy(cache->m_Free);
+			}
+			destroy(m_Shared->m_Free);
+			m_Shared->m_Caches.clear();
+			m_Shared->m_IsDead.store(true, std::memory_order_relaxed);
+		}
+
+		/*
+		* Takes an idle object, or makes a new one if there is none.
+		*/
+		inline auto acquire() {
+			auto& cache = this->cache();
+			if (cache.m_Free.empty()) {
+				refill(cache);
+			}
+
+			auto value = RawPtr<Type>(nullptr);
+			if (!cache.m_Free.empty()) {
+				value = cache.m_Free.back();
+				cache.m_Free.pop_back();
+				m_Shared->m_Idle.fetch_sub(1, std::memory_order_relaxed);
+			}
+			else {
+				value = new Type(m_Create());
+				m_Shared->m_Created.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			auto live = m_Shared->m_Live.fetch_add(1, std::memory_order_relaxed) + 1;
+			auto highWaterMark = m_Shared->m_HighWaterMark.load(std::memory_order_relaxed);
+			while (live > highWaterMark && !m_Shared->m_HighWaterMark.compare_exchange_weak(highWaterMark, live, std::memory_order_relaxed)) {}
+
+			return PooledVal<Type>(this, value);
+		}
+
+		// The objects taken and not given back yet
+		inline usize live() const {
+			return m_Shared->m_Live.load(std::memory_order_relaxed);
+		}
+
+		// The objects kept for reuse
+		inline usize idle() const {
+			return m_Shared->m_Idle.load(std::memory_order_relaxed);
+		}
+
+		// The most objects that were taken at the same time
+		inline usize high_water_mark() const {
+			return m_Shared->m_HighWaterMark.load(std::memory_order_relaxed);
+		}
+
+		// The objects made by the pool so far
+		inline usize created() const {
+			return m_Shared->m_Created.load(std::memory_order_relaxed);
+		}
+
+		inline usize max_idle() const {
+			return m_MaxIdle;
+		}
+
+	private:
+		using Cache = internal::object_pool::Cache<Type>;
+
+		inline void release(RawPtr<Type> value) {
+			m_Shared->m_Live.fetch_sub(1, std::memory_order_relaxed);
+			if (m_Reset) {
+				try {
+					m_Reset(*value);
+				}
+				catch (...) {
+					delete value;
+					throw;
+				}
+			}
+
+			if (m_Shared->m_Idle.fetch_add(1, std::memory_order_relaxed) >= m_MaxIdle) {
+				m_Shared->m_Idle.fetch_sub(1, std::memory_order_relaxed);
+				delete value;
+				return;
+			}
+
+			auto& cache = this->cache();
+			if (cache.m_Free.size() >= CacheSize) {
+				auto lock = std::lock_guard<std::mutex>(m_Shared->m_Mutex);
+				auto half = cache.m_Free.begin() + CacheSize / 2;
+				m_Shared->m_Free.insert(m_Shared->m_Free.end(), half, cache.m_Free.end());
+				cache.m_Free.erase(half, cache.m_Free.end());
+			}
+			cache.m_Free.push_back(value);
+		}
+
+		inline void refill(Cache& cache) {
+			auto lock = std::lock_guard<std::mutex>(m_Shared->m_Mutex);
+			auto count = std::min(CacheSize / 2, m_Shared->m_Free.size());
+			auto first = m_Shared->m_Free.end() - count;
+			cache.m_Free.insert(cache.m_Free.end(), first, m_Shared->m_Free.end());
+			m_Shared->m_Free.erase(first, m_Shared->m_Free.end());
+		}
+
+		// The cache of this thread for this pool, the ones of destroyed pools are dropped on the way
+		inline auto cache() -> Cache& {
+			for (auto& [id, cache] : t_Caches) {
+				if (id == m_Id) {
+					return *cache;
+				}
+			}
+
+			std::erase_if(t_Caches, [](const auto& entry) {
+				return entry.second->m_Shared->m_IsDead.load(std::memory_order_relaxed);
+			});
+
+			auto cache = std::make_unique<Cache>(m_Shared);
+			{
+				auto lock = std::lock_guard<std::mutex>(m_Shared->m_Mutex);
+				m_Shared->m_Caches.push_back(cache.get());
+			}
+			return *t_Caches.emplace_back(m_Id, std::move(cache)).second;
+		}
+
+		static inline void destroy(std::vector<RawPtr<Type>>& values) {
+			for (auto value : values) {
+				delete value;
+			}
+			values.clear();
+		}
+
+	private:
+		std::function<Type()> m_Create;
+		std::function<void(Type&)> m_Reset;
+		usize m_MaxIdle;
+		std::shared_ptr<internal::object_pool::Shared<Type>> m_Shared;
+		u64 m_Id;
+
+		static inline std::atomic<u64> s_NextId = 0;
+		static inline thread_local std::vector<std::pair<u64, std::unique_ptr<Cache>>> t_Caches;
+
+		friend class PooledVal<Type>;
+	};
+
+	template<typename Type>
+	struct IsSend<PooledVal<Type>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type>
+	struct IsSync<PooledVal<Type>> : std::bool_constant<Sync<Type>> {};
+
+	// Objects taken on one thread can be given back on another
+	template<typename Type>
+	struct IsSync<Pool<Type>> : std::bool_constant<Send<Type>> {};
+}
+
+// Iterators
+namespace rs {
+
+	namespace internal::iter {
+
+		/*
+		* What next() returns, an optional which can also hold a reference.
+		*/
+		template<typename Item>
+		class Next {
+		public:
+			inline Next() = default;
+
+			inline Next(Item value)
+				: m_Value(std::move(value))
+			{
+			}
+
+			inline Next(Next&& other) = default;
+
+			// Items can be pairs of references, so assigning one Next to another must rebind and not assign through them
+			inline auto operator=(Next&& other) -> Next& {
+				m_Value.reset();
+				if (other.m_Value.has_value()) {
+					m_Value.emplace(std::move(*other.m_Value));
+				}
+				return *this;
+			}
+
+			inline explicit operator bool() const { return m_Value.has_value(); }
+
+			inline auto& operator*() { return *m_Value; }
+
+			inline Item get() { return std::move(*m_Value); }
+
+		private:
+			std::optional<Item> m_Value;
+		};
+
+		template<typename Item>
+		class Next<Item&> {
+		public:
+			inline Next() = default;
+
+			inline Next(Item& value)
+				: m_Ptr(&value)
+			{
+			}
+
+			inline explicit operator bool() const { return m_Ptr != nullptr; }
+
+			inline Item& operator*() { return *m_Ptr; }
+
+			inline Item& get() { return *m_Ptr; }
+
+		private:
+			RawPtr<Item> m_Ptr = nullptr;
+		};
+
+		/*
+		* The bounds on the number of items left, upper is empty if there is no known bound.
+		*/
+		struct SizeHint {
+			usize lower = 0;
+			std::optional<usize> upper;
+		};
+
+		inline usize saturating_add(usize a, usize b) {
+			return a + b < a ? std::numeric_limits<usize>::max() : a + b;
+		}
+
+		template<typename Type>
+		struct is_iter : std::false_type {};
+
+		template<typename Source>
+		struct is_iter<Iter<Source>> : std::true_type {};
+
+		template<typename Type>
+		struct is_slice_iter : std::false_type {};
+
+		template<typename ElementType>
+		struct is_slice_iter<SliceIter<ElementType>> : std::true_type {};
+
+		template<typename Type>
+		struct option_traits;
+
+		template<typename Type>
+		struct option_traits<std::optional<Type>> {
+			using ValueType = Type;
+
+			static inline bool is_some(const std::optional<Type>& option) { return option.has_value(); }
+
+			static inline Type take(std::optional<Type>& option) { return std::move(*option); }
+		};
+
+		template<typename Type, bool ThreadSafe>
+		struct option_traits<OptionRaw<Type, ThreadSafe>> {
+			using ValueType = Type;
+
+			static inline bool is_some(const OptionRaw<Type, ThreadSafe>& option) { return option.is_some(); }
+
+			static inline Type take(OptionRaw<Type, ThreadSafe>& option) { return option.take_some(); }
+		};
+
+		// Moves the values out of a Result without the clones and checks of unwrap()
+		template<typename Type>
+		struct result_traits;
+
+		template<typename Type, typename Err, bool ThreadSafe>
+		struct result_traits<ResultRaw<Type, Err, ThreadSafe>> {
+			using ValueType = Type;
+			using ErrorType = Err;
+			static constexpr bool IsThreadSafe = ThreadSafe;
+
+			static inline bool is_ok(const ResultRaw<Type, Err, ThreadSafe>& result) { return result.m_Value.is_valid(); }
+
+			static inline bool is_err(const ResultRaw<Type, Err, ThreadSafe>& result) { return result.m_Error.is_valid(); }
+
+			static inline Type take_ok(ResultRaw<Type, Err, ThreadSafe>& result) { return result.take_ok(); }
+
+			static inline Err take_err(ResultRaw<Type, Err, ThreadSafe>& result) { return result.take_err(); }
+		};
+
+		template<typename Container, typename Value>
+		inline void push_back(Container& container, Value&& value) {
+			if constexpr (requires { container.push(std::forward<Value>(value)); }) {
+				container.push(std::forward<Value>(value));
+			}
+			else if constexpr (requires { container.push_back(std::forward<Value>(value)); }) {
+				container.push_back(std::forward<Value>(value));
+			}
+			else {
+				container.insert(std::forward<Value>(value));
+			}
+		}
+
+		/*
+		* Every source and adapter below provides the same three things, which is all Iter needs:
+		*  - next() which pulls the next item
+		*  - for_each_while(f) which pushes the items into f until it returns false, it returns
+		*    false only if f did. Everything built on top of it inlines into a single loop.
+		*  - size_hint()
+		*/
+
+		template<typename View>
+		class Range {
+		public:
+			using Item = std::ranges::range_reference_t<View>;
+
+			inline explicit Range(View view)
+				: m_View(std::move(view))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				auto& it = current();
+				if (it == std::ranges::end(m_View)) {
+					return {};
+				}
+
+				auto item = Next<Item>(*it);
+				++it;
+				return item;
+			}
+
+			template<typename F>
+			inline bool for_each_while(F& f) {
+				auto& it = current();
+				auto end = std::ranges::end(m_View);
+				for (; it != end; ++it) {
+					if (!f(*it)) {
+						++it;
+						return false;
+					}
+				}
+				return true;
+			}
+
+			inline auto size_hint() -> SizeHint {
+				if constexpr (std::sized_sentinel_for<std::ranges::sentinel_t<View>, std::ranges::iterator_t<View>>) {
+					auto len = static_cast<usize>(std::ranges::end(m_View) - current());
+					return { len, len };
+				}
+				else {
+					return {};
+				}
+			}
+
+		private:
+			// The position is only taken once iterating starts, so the source can be moved into adapters before that
+			inline auto current() -> std::ranges::iterator_t<View>& {
+				if (!m_Current.has_value()) {
+					m_Current.emplace(std::ranges::begin(m_View));
+				}
+				return *m_Current;
+			}
+
+		private:
+			View m_View;
+			std::optional<std::ranges::iterator_t<View>> m_Current;
+		};
+
+		/*
+		* A source that holds a borrow of the collection it walks over until it is dropped,
+		* the iterators of the maps are made of one so they take part in the borrow checks.
+		*/
+		template<typename Source, bool Mutability>
+		class Loaned : public Source {
+		public:
+			inline Loaned(Source&& source, RefRaw<void, Mutability, false>&& loan)
+				: Source(std::move(source)),
+				m_Loan(std::move(loan))
+			{
+			}
+
+		private:
+			RefRaw<void, Mutability, false> m_Loan;
+		};
+
+		template<typename ElementType, bool Mutability>
+		struct is_slice_iter<Loaned<SliceIter<ElementType>, Mutability>> : std::true_type {};
+
+		template<typename Type>
+		class Once {
+		public:
+			using Item = Type&;
+
+			inline explicit Once(RawPtr<Type> value)
+				: m_Value(value)
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				if (m_Value == nullptr) {
+					return {};
+				}
+
+				return Next<Item>(*std::exchange(m_Value, nullptr));
+			}
+
+			template<typename F>
+			inline bool for_each_while(F& f) {
+				if (m_Value == nullptr) {
+					return true;
+				}
+
+				return f(*std::exchange(m_Value, nullptr));
+			}
+
+			inline auto size_hint() -> SizeHint {
+				auto len = static_cast<usize>(m_Value != nullptr);
+				return { len, len };
+			}
+
+		private:
+			RawPtr<Type> m_Value;
+		};
+
+		template<typename Source, typename F>
+		class Map {
+		public:
+			using Item = std::invoke_result_t<F&, typename Source::Item>;
+
+			inline Map(Source&& source, F&& f)
+				: m_Source(std::move(source)),
+				m_F(std::move(f))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				auto item = m_Source.next();
+				if (!item) {
+					return {};
+				}
+
+				return Next<Item>(std::invoke(m_F, item.get()));
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					return g(std::invoke(m_F, std::forward<decltype(item)>(item)));
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				return m_Source.size_hint();
+			}
+
+		private:
+			Source m_Source;
+			F m_F;
+		};
+
+		template<typename Source, typename P>
+		class Filter {
+		public:
+			using Item = typename Source::Item;
+
+			inline Filter(Source&& source, P&& predicate)
+				: m_Source(std::move(source)),
+				m_Predicate(std::move(predicate))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				while (true) {
+					auto item = m_Source.next();
+					if (!item || std::invoke(m_Predicate, std::as_const(*item))) {
+						return item;
+					}
+				}
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					if (!std::invoke(m_Predicate, std::as_const(item))) {
+						return true;
+					}
+					return g(std::forward<decltype(item)>(item));
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				return { 0, m_Source.size_hint().upper };
+			}
+
+		private:
+			Source m_Source;
+			P m_Predicate;
+		};
+
+		template<typename Source, typename F>
+		class FilterMap {
+		public:
+			using OptionType = std::remove_cvref_t<std::invoke_result_t<F&, typename Source::Item>>;
+			using Item = typename option_traits<OptionType>::ValueType;
+
+			inline FilterMap(Source&& source, F&& f)
+				: m_Source(std::move(source)),
+				m_F(std::move(f))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				while (true) {
+					auto item = m_Source.next();
+					if (!item) {
+						return {};
+					}
+
+					auto option = std::invoke(m_F, item.get());
+					if (option_traits<OptionType>::is_some(option)) {
+						return Next<Item>(option_traits<OptionType>::take(option));
+					}
+				}
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					auto option = std::invoke(m_F, std::forward<decltype(item)>(item));
+					if (!option_traits<OptionType>::is_some(option)) {
+						return true;
+					}
+					return g(option_traits<OptionType>::take(option));
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				return { 0, m_Source.size_hint().upper };
+			}
+
+		private:
+			Source m_Source;
+			F m_F;
+		};
+
+		template<typename Source>
+		class Enumerate {
+		public:
+			using Item = std::pair<usize, typename Source::Item>;
+
+			inline explicit Enumerate(Source&& source)
+				: m_Source(std::move(source))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				auto item = m_Source.next();
+				if (!item) {
+					return {};
+				}
+
+				return Next<Item>(Item(m_Index++, item.get()));
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					return g(Item(m_Index++, std::forward<decltype(item)>(item)));
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				return m_Source.size_hint();
+			}
+
+		private:
+			Source m_Source;
+			usize m_Index = 0;
+		};
+
+		template<typename A, typename B>
+		class Zip {
+		public:
+			using Item = std::pair<typename A::Item, typename B::Item>;
+
+			inline Zip(A&& a, B&& b)
+				: m_A(std::move(a)),
+				m_B(std::move(b))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				auto a = m_A.next();
+				if (!a) {
+					return {};
+				}
+
+				auto b = m_B.next();
+				if (!b) {
+					return {};
+				}
+
+				return Next<Item>(Item(a.get(), b.get()));
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				bool stopped = false;
+				auto step = [&](auto&& a) {
+					auto b = m_B.next();
+					if (!b) {
+						return false;
+					}
+
+					if (!g(Item(std::forward<decltype(a)>(a), b.get()))) {
+						stopped = true;
+						return false;
+					}
+					return true;
+				};
+				m_A.for_each_while(step);
+				return !stopped;
+			}
+
+			inline auto size_hint() -> SizeHint {
+				auto a = m_A.size_hint();
+				auto b = m_B.size_hint();
+
+				auto upper = a.upper.has_value() ? a.upper : b.upper;
+				if (a.upper.has_value() && b.upper.has_value()) {
+					upper = std::min(*a.upper, *b.upper);
+				}
+				return { std::min(a.lower, b.lower), upper };
+			}
+
+		private:
+			A m_A;
+			B m_B;
+		};
+
+		template<typename A, typename B>
+		class Chain {
+		public:
+			using Item = std::common_reference_t<typename A::Item, typename B::Item>;
+
+			inline Chain(A&& a, B&& b)
+				: m_A(std::move(a)),
+				m_B(std::move(b))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				if (!m_IsFirstDone) {
+					auto item = m_A.next();
+					if (item) {
+						return Next<Item>(item.get());
+					}
+					m_IsFirstDone = true;
+				}
+
+				auto item = m_B.next();
+				if (!item) {
+					return {};
+				}
+				return Next<Item>(item.get());
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					return g(static_cast<Item>(std::forward<decltype(item)>(item)));
+				};
+
+				if (!m_IsFirstDone) {
+					if (!m_A.for_each_while(step)) {
+						return false;
+					}
+					m_IsFirstDone = true;
+				}
+				return m_B.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				auto a = m_IsFirstDone ? SizeHint{ 0, 0 } : m_A.size_hint();
+				auto b = m_B.size_hint();
+
+				auto upper = std::optional<usize>();
+				if (a.upper.has_value() && b.upper.has_value() && *a.upper + *b.upper >= *a.upper) {
+					upper = *a.upper + *b.upper;
+				}
+				return { saturating_add(a.lower, b.lower), upper };
+			}
+
+		private:
+			A m_A;
+			B m_B;
+			bool m_IsFirstDone = false;
+		};
+
+		template<typename Source>
+		class Take {
+		public:
+			using Item = typename Source::Item;
+
+			inline Take(Source&& source, usize count)
+				: m_Source(std::move(source)),
+				m_Remaining(count)
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				if (m_Remaining == 0) {
+					return {};
+				}
+
+				m_Remaining--;
+				return m_Source.next();
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				if (m_Remaining == 0) {
+					return true;
+				}
+
+				bool stopped = false;
+				auto step = [&](auto&& item) {
+					m_Remaining--;
+					if (!g(std::forward<decltype(item)>(item))) {
+						stopped = true;
+						return false;
+					}
+					return m_Remaining != 0;
+				};
+				m_Source.for_each_while(step);
+				return !stopped;
+			}
+
+			inline auto size_hint() -> SizeHint {
+				auto hint = m_Source.size_hint();
+				return { std::min(hint.lower, m_Remaining), std::min(hint.upper.value_or(m_Remaining), m_Remaining) };
+			}
+
+		private:
+			Source m_Source;
+			usize m_Remaining;
+		};
+
+		template<typename Source>
+		class Skip {
+		public:
+			using Item = typename Source::Item;
+
+			inline Skip(Source&& source, usize count)
+				: m_Source(std::move(source)),
+				m_Remaining(count)
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				skip();
+				return m_Source.next();
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				skip();
+				return m_Source.for_each_while(g);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				auto hint = m_Source.size_hint();
+				auto lower = hint.lower > m_Remaining ? hint.lower - m_Remaining : 0;
+				if (hint.upper.has_value()) {
+					hint.upper = *hint.upper > m_Remaining ? *hint.upper - m_Remaining : 0;
+				}
+				return { lower, hint.upper };
+			}
+
+		private:
+			inline void skip() {
+				while (m_Remaining > 0) {
+					m_Remaining--;
+					if (!m_Source.next()) {
+						m_Remaining = 0;
+					}
+				}
+			}
+
+		private:
+			Source m_Source;
+			usize m_Remaining;
+		};
+
+		template<typename Source>
+		class StepBy {
+		public:
+			using Item = typename Source::Item;
+
+			inline StepBy(Source&& source, usize step)
+				: m_Source(std::move(source)),
+				m_Step(step)
+			{
+				if (step == 0) {
+					throw std::invalid_argument("Step must be non-zero");
+				}
+			}
+
+			inline auto next() -> Next<Item> {
+				while (true) {
+					auto item = m_Source.next();
+					if (!item || m_Skip == 0) {
+						m_Skip = m_Step - 1;
+						return item;
+					}
+					m_Skip--;
+				}
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				auto step = [&](auto&& item) {
+					if (m_Skip != 0) {
+						m_Skip--;
+						return true;
+					}
+
+					m_Skip = m_Step - 1;
+					return g(std::forward<decltype(item)>(item));
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				// the first item left is the one after m_Skip items, then every m_Step-th one
+				auto count = [this](usize len) -> usize {
+					return len > m_Skip ? 1 + (len - m_Skip - 1) / m_Step : 0;
+				};
+
+				auto hint = m_Source.size_hint();
+				if (hint.upper.has_value()) {
+					hint.upper = count(*hint.upper);
+				}
+				return { count(hint.lower), hint.upper };
+			}
+
+		private:
+			Source m_Source;
+			usize m_Step;
+			usize m_Skip = 0;
+		};
+
+		template<typename Source, typename F>
+		class FlatMap {
+		public:
+			using Inner = decltype(rs::iter(std::declval<std::invoke_result_t<F&, typename Source::Item>>()));
+			using Item = typename Inner::Item;
+
+			inline FlatMap(Source&& source, F&& f)
+				: m_Source(std::move(source)),
+				m_F(std::move(f))
+			{
+			}
+
+			inline auto next() -> Next<Item> {
+				while (true) {
+					if (m_Front.has_value()) {
+						auto item = m_Front->next();
+						if (item) {
+							return item;
+						}
+						m_Front.reset();
+					}
+
+					auto outer = m_Source.next();
+					if (!outer) {
+						return {};
+					}
+					m_Front.emplace(rs::iter(std::invoke(m_F, outer.get())));
+				}
+			}
+
+			template<typename G>
+			inline bool for_each_while(G& g) {
+				if (m_Front.has_value()) {
+					if (!m_Front->for_each_while(g)) {
+						return false;
+					}
+					m_Front.reset();
+				}
+
+				auto step = [&](auto&& item) {
+					auto inner = rs::iter(std::invoke(m_F, std::forward<decltype(item)>(item)));
+					if (!inner.for_each_while(g)) {
+						// keep the rest of it for the next call
+						m_Front.emplace(std::move(inner));
+						return false;
+					}
+					return true;
+				};
+				return m_Source.for_each_while(step);
+			}
+
+			inline auto size_hint() -> SizeHint {
+				return { m_Front.has_value() ? m_Front->size_hint().lower : 0, std::nullopt };
+			}
+
+		private:
+			Source m_Source;
+			F m_F;
+			std::optional<Inner> m_Front;
+		};
+
+		struct Sentinel {};
+
+		/*
+		* Lets any Iter be used in a range based for loop.
+		*/
+		template<typename Iterator>
+		class Cursor {
+		public:
+			using value_type = typename Iterator::ValueType;
+			using difference_type = std::ptrdiff_t;
+
+			inline explicit Cursor(RawPtr<Iterator> iter)
+				: m_Iter(iter),
+				m_Item(iter->next())
+			{
+			}
+
+			inline decltype(auto) operator*() { return *m_Item; }
+
+			inline auto operator++() -> Cursor& {
+				m_Item = m_Iter->next();
+				return *this;
+			}
+
+			inline void operator++(int) { ++*this; }
+
+			inline bool operator==(Sentinel) const { return !m_Item; }
+
+		private:
+			RawPtr<Iterator> m_Iter;
+			Next<typename Iterator::Item> m_Item;
+		};
+	}
+
+
+	/*
+	* Iterates over the elements of a slice. It walks a pointer range, so there are no
+	* bounds checks in a `for (auto& x : slice.iter())` loop.
+	*/
+	template<typename ElementType>
+	class SliceIter {
+	public:
+		using Item = ElementType&;
+
+		inline SliceIter(RawPtr<ElementType> begin, RawPtr<ElementType> end)
+			: m_Begin(begin),
+			m_End(end)
+		{
+		}
+
+		inline auto begin() const { return m_Begin; }
+
+		inline auto end() const { return m_End; }
+
+		inline usize len() const { return static_cast<usize>(m_End - m_Begin); }
+
+		inline auto next() -> internal::iter::Next<Item> {
+			if (m_Begin == m_End) {
+				return {};
+			}
+
+			return internal::iter::Next<Item>(*m_Begin++);
+		}
+
+		template<typename F>
+		inline bool for_each_while(F& f) {
+			// a local cursor so the loop does not go through memory that f might write to
+			auto it = m_Begin;
+			while (it != m_End) {
+				auto& item = *it++;
+				if (!f(item)) {
+					m_Begin = it;
+					return false;
+				}
+			}
+			m_Begin = it;
+			return true;
+		}
+
+		inline auto size_hint() -> internal::iter::SizeHint {
+			return { len(), len() };
+		}
+
+	private:
+		RawPtr<ElementType> m_Begin;
+		RawPtr<ElementType> m_End;
+	};
+
+
+	/*
+	* A lazy iterator, the equivalent of Rust's Iterator trait. The adapters (map, filter, ...)
+	* are templates over the closures they were given and nothing is type erased or allocated,
+	* so a chain like `v.iter().map(f).filter(p).sum()` compiles into a single loop.
+	*
+	* The adapters consume the iterator they are called on, just like in Rust.
+	* Items are references into the collection for Vec, Slice and Option, or whatever the
+	* range yields for standard ranges.
+	*/
+	template<typename Source>
+	class Iter {
+	public:
+		using Item = typename Source::Item;
+		using ValueType = std::remove_cvref_t<Item>;
+
+		inline explicit Iter(Source&& source)
+			: m_Source(std::move(source))
+		{
+		}
+
+		/*
+		* Advances the iterator and returns the next item, or an empty one when it is done.
+		*/
+		inline auto next() {
+			return m_Source.next();
+		}
+
+		/*
+		* Returns the bounds on the number of items left, collect uses the lower one to preallocate.
+		*/
+		inline auto size_hint() -> internal::iter::SizeHint {
+			return m_Source.size_hint();
+		}
+
+		inline usize len() requires requires(Source source) { source.len(); } {
+			return m_Source.len();
+		}
+
+		/*
+		* Calls f with every item until it returns false, returns false if it did.
+		* This is the loop every consumer below is built on.
+		*/
+		template<typename F>
+		inline bool for_each_while(F&& f) {
+			return m_Source.for_each_while(f);
+		}
+
+		template<typename F>
+		inline void for_each(F f) {
+			for_each_while([&](auto&& item) {
+				std::invoke(f, std::forward<decltype(item)>(item));
+				return true;
+			});
+		}
+
+		// Adapters
+
+		template<typename F>
+		inline auto map(F f) {
+			return make<internal::iter::Map<Source, F>>(std::move(m_Source), std::move(f));
+		}
+
+		template<typename P>
+		inline auto filter(P predicate) {
+			return make<internal::iter::Filter<Source, P>>(std::move(m_Source), std::move(predicate));
+		}
+
+		/*
+		* Maps and filters at once, f returns an Option (or std::optional) and only the Some values are kept.
+		*/
+		template<typename F>
+		inline auto filter_map(F f) {
+			return make<internal::iter::FilterMap<Source, F>>(std::move(m_Source), std::move(f));
+		}
+
+		/*
+		* Yields pairs of the index and the item.
+		*/
+		inline auto enumerate() {
+			return make<internal::iter::Enumerate<Source>>(std::move(m_Source));
+		}
+
+		/*
+		* Yields pairs of items from both iterators, it stops when either of them does.
+		*/
+		template<typename Other>
+		inline auto zip(Other&& other) {
+			using OtherIter = decltype(rs::iter(std::forward<Other>(other)));
+			return make<internal::iter::Zip<Source, OtherIter>>(std::move(m_Source), rs::iter(std::forward<Other>(other)));
+		}
+
+		/*
+		* Yields the items of this iterator followed by the ones of other.
+		*/
+		template<typename Other>
+		inline auto chain(Other&& other) {
+			using OtherIter = decltype(rs::iter(std::forward<Other>(other)));
+			return make<internal::iter::Chain<Source, OtherIter>>(std::move(m_Source), rs::iter(std::forward<Other>(other)));
+		}
+
+		inline auto take(usize count) {
+			return make<internal::iter::Take<Source>>(std::move(m_Source), count);
+		}
+
+		inline auto skip(usize count) {
+			return make<internal::iter::Skip<Source>>(std::move(m_Source), count);
+		}
+
+		/*
+		* Yields the first item and then every step-th one, throws if step is zero.
+		*/
+		inline auto step_by(usize step) {
+			return make<internal::iter::StepBy<Source>>(std::move(m_Source), step);
+		}
+
+		/*
+		* Maps every item to something iterable and yields all of their items.
+		*/
+		template<typename F>
+		inline auto flat_map(F f) {
+			return make<internal::iter::FlatMap<Source, F>>(std::move(m_Source), std::move(f));
+		}
+
+		// Consumers
+
+		template<typename Acc, typename F>
+		inline auto fold(Acc init, F f) -> Acc {
+			auto acc = std::move(init);
+			for_each_while([&](auto&& item) {
+				acc = std::invoke(f, std::move(acc), std::forward<decltype(item)>(item));
+				return true;
+			});
+			return acc;
+		}
+
+		inline usize count() {
+			usize count = 0;
+			for_each_while([&](auto&&) {
+				count++;
+				return true;
+			});
+			return count;
+		}
+
+		/*
+		* Sums the items, integers wrap around on overflow.
+		* Iterators straight over a slice use the SIMD kernels, which reassociate float additions
+		* like Slice::sum. The other ones add the items in order.
+		*/
+		inline auto sum() -> ValueType {
+			if constexpr (internal::iter::is_slice_iter<Source>::value) {
+				return internal::slice_sum<ValueType>(m_Source.begin(), m_Source.len());
+			}
+			else if constexpr (std::is_integral_v<ValueType> && !std::is_same_v<ValueType, bool>) {
+				using Bits = std::make_unsigned_t<ValueType>;
+				return fold(ValueType(), [](ValueType acc, const ValueType& item) {
+					return static_cast<ValueType>(static_cast<Bits>(acc) + static_cast<Bits>(item));
+				});
+			}
+			else {
+				return fold(ValueType(), [](ValueType acc, const ValueType& item) { return acc + item; });
+			}
+		}
+
+		/*
+		* Returns the smallest item or None if there are none, NaNs are ignored unless there is nothing else.
+		*/
+		inline auto min() {
+			return extremum<false>();
+		}
+
+		inline auto max() {
+			return extremum<true>();
+		}
+
+		template<typename P>
+		inline bool any(P predicate) {
+			return !for_each_while([&](auto&& item) {
+				return !std::invoke(predicate, std::as_const(item));
+			});
+		}
+
+		template<typename P>
+		inline bool all(P predicate) {
+			return for_each_while([&](auto&& item) {
+				return static_cast<bool>(std::invoke(predicate, std::as_const(item)));
+			});
+		}
+
+		/*
+		* Returns the first item matching the predicate, or None.
+		* When the items are references this is an Option of a Ref (or RefMut) to it. That Ref is
+		* unchecked: it does not borrow the collection, so it must not outlive it or be used after
+		* the collection was modified, like a plain reference.
+		*/
+		template<typename P>
+		inline auto find(P predicate) {
+			if constexpr (std::is_reference_v<Item>) {
+				using RefType = RefRaw<ValueType, !std::is_const_v<std::remove_reference_t<Item>>, false>;
+
+				auto found = RawPtr<std::remove_reference_t<Item>>(nullptr);
+				for_each_while([&](auto&& item) {
+					if (std::invoke(predicate, std::as_const(item))) {
+						found = &item;
+						return false;
+					}
+					return true;
+				});
+
+				if (found == nullptr) {
+					return None<RefType>();
+				}
+				return Some<RefType>(RefType(found, nullptr, ValidityChecker<false>()));
+			}
+			else {
+				auto found = std::optional<ValueType>();
+				for_each_while([&](auto&& item) {
+					if (std::invoke(predicate, std::as_const(item))) {
+						found.emplace(std::forward<decltype(item)>(item));
+						return false;
+					}
+					return true;
+				});
+
+				if (!found.has_value()) {
+					return None<ValueType>();
+				}
+				return Some<ValueType>(std::move(*found));
+			}
+		}
+
+		/*
+		* Collects the items into a container, the lower bound of size_hint is reserved up front.
+		* collect() and collect<Vec>() make a Vec, collect<std::vector>() or collect<std::set<T>>() work too.
+		*/
+		template<typename Container>
+		inline auto collect() -> Container {
+			auto container = Container();
+			if constexpr (requires { container.reserve(usize()); }) {
+				container.reserve(size_hint().lower);
+			}
+
+			for_each_while([&](auto&& item) {
+				internal::iter::push_back(container, std::forward<decltype(item)>(item));
+				return true;
+			});
+			return container;
+		}
+
+		template<template<typename...> typename Container = Vec>
+		inline auto collect() {
+			return collect<Container<ValueType>>();
+		}
+
+		/*
+		* Collects an iterator of Results into a Result of a Vec, it stops at the first Err and returns it,
+		* otherwise it returns all of the Ok values. The Results are consumed, so the items have to be
+		* values or mutable references (iter_mut, rs::iter(std::move(v)), ...). An Err is returned and never thrown.
+		*/
+		inline auto collect_result() {
+			using Traits = internal::iter::result_traits<ValueType>;
+			using Type = typename Traits::ValueType;
+			using Error = typename Traits::ErrorType;
+
+			auto values = Vec<Type>();
+			values.reserve(size_hint().lower);
+
+			auto error = std::optional<Error>();
+			for_each_while([&](auto&& result) {
+				if (Traits::is_ok(result)) {
+					values.push(Traits::take_ok(result));
+					return true;
+				}
+				if (Traits::is_err(result)) {
+					error.emplace(Traits::take_err(result));
+					return false;
+				}
+				return true;
+			});
+
+			if (error.has_value()) {
+				return Err<Vec<Type>, Error>(std::move(*error));
+			}
+			return Ok<Vec<Type>, Error>(std::move(values));
+		}
+
+		/*
+		* Collects an iterator of Options (or std::optionals) into an Option of a Vec, it is None if any of them was.
+		*/
+		inline auto collect_option() {
+			using Traits = internal::iter::option_traits<ValueType>;
+			using Type = typename Traits::ValueType;
+
+			auto values = Vec<Type>();
+			values.reserve(size_hint().lower);
+
+			bool complete = for_each_while([&](auto&& option) {
+				if (!Traits::is_some(option)) {
+					return false;
+				}
+				values.push(Traits::take(option));
+				return true;
+			});
+
+			if (!complete) {
+				return None<Vec<Type>>();
+			}
+			return Some<Vec<Type>>(std::move(values));
+		}
+
+		/*
+		* Splits an iterator of Results into a Vec of the Ok values and a Vec of the Err values.
+		*/
+		inline auto partition_results() {
+			using Traits = internal::iter::result_traits<ValueType>;
+
+			auto values = Vec<typename Traits::ValueType>();
+			auto errors = Vec<typename Traits::ErrorType>();
+			values.reserve(size_hint().lower);
+
+			for_each_while([&](auto&& result) {
+				if (Traits::is_ok(result)) {
+					values.push(Traits::take_ok(result));
+				}
+				else if (Traits::is_err(result)) {
+					errors.push(Traits::take_err(result));
+				}
+				return true;
+			});
+			return std::pair(std::move(values), std::move(errors));
+		}
+
+		inline auto begin() {
+			if constexpr (internal::iter::is_slice_iter<Source>::value) {
+				return m_Source.begin();
+			}
+			else {
+				return internal::iter::Cursor<Iter>(this);
+			}
+		}
+
+		inline auto end() {
+			if constexpr (internal::iter::is_slice_iter<Source>::value) {
+				return m_Source.end();
+			}
+			else {
+				return internal::iter::Sentinel();
+			}
+		}
+
+	private:
+		template<typename Adapter, typename... Args>
+		static inline auto make(Args&&... args) {
+			return Iter<Adapter>(Adapter(std::forward<Args>(args)...));
+		}
+
+		template<bool Max>
+		inline auto extremum() {
+			if constexpr (internal::iter::is_slice_iter<Source>::value) {
+				return internal::slice_extremum<ValueType, Max>(m_Source.begin(), m_Source.len());
+			}
+			else {
+				auto best = std::optional<ValueType>();
+				for_each_while([&](auto&& item) {
+					if (!best.has_value() || (Max ? item > *best : item < *best)) {
+						best.emplace(std::forward<decltype(item)>(item));
+					}
+					else if constexpr (std::is_floating_point_v<ValueType>) {
+						// a NaN is only kept until there is something else
+						if (*best != *best) {
+							best.emplace(std::forward<decltype(item)>(item));
+						}
+					}
+					return true;
+				});
+
+				if (!best.has_value()) {
+					return None<ValueType>();
+				}
+				return Some<ValueType>(std::move(*best));
+			}
+		}
+
+	private:
+		Source m_Source;
+	};
+
+	/*
+	* Makes an Iter out of anything iterable: an Iter is passed through, Vec, Slice and Option
+	* use their iter() and everything else is treated as a standard range. Ranges passed as
+	* rvalues are moved into the iterator. An Iter passed as an lvalue is copied and left as it
+	* was, one that borrows its collection can not be copied and has to be moved in.
+	*/
+	template<typename Iterable>
+	inline auto iter(Iterable&& iterable) {
+		using Plain = std::remove_cvref_t<Iterable>;
+
+		if constexpr (internal::iter::is_iter<Plain>::value) {
+			if constexpr (std::is_lvalue_reference_v<Iterable>) {
+				static_assert(std::is_copy_constructible_v<Plain>, "This Iter borrows its collection and can not be copied, pass it with std::move");
+				return Plain(iterable);
+			}
+			else {
+				return Plain(std::move(iterable));
+			}
+		}
+		else if constexpr (std::is_lvalue_reference_v<Iterable> && requires { iterable.iter(); }) {
+			return iterable.iter();
+		}
+		else {
+			using View = std::views::all_t<Iterable>;
+			return Iter<internal::iter::Range<View>>(internal::iter::Range<View>(std::views::all(std::forward<Iterable>(iterable))));
+		}
+	}
+}
+
+// Slot maps
+namespace rs {
+
+	/*
+	* The key of a value in a SlotMap. The generation tells apart the values that
+	* used the same slot, a key of a removed value never finds the one that replaced it.
+	*/
+	struct SlotKey {
+		u32 index;
+		u32 generation;
+
+		inline bool operator==(const SlotKey& other) const = default;
+	};
+
+	namespace internal::slot_map {
+		// The generation is odd while the slot is occupied, index is then where the value is
+		// in the packed values and otherwise the next free slot
+		struct Slot {
+			u32 m_Index;
+			u32 m_Generation;
+		};
+
+		constexpr u32 NoSlot = std::numeric_limits<u32>::max();
+	}
+
+	/*
+	* Values addressed by generational keys, the equivalent of the slotmap crate's DenseSlotMap.
+	*
+	* The values are packed in one array, so iterating them is a linear scan, removing one moves
+	* the last value into its place. The slots map keys to positions in that array and the
+	* vacant ones are chained in a free list. A stale key is detected by its generation, not by a
+	* ValidityCheckBlock per value.
+	*
+	* get, get_mut and the iterators borrow the whole map, like a Vec it can not be modified while
+	* one of the references is alive and they expire once the map is dropped.
+	*/
+	template<typename Type>
+	class SlotMap {
+	public:
+		using Key = SlotKey;
+
+		inline SlotMap() = default;
+
+		static inline auto with_capacity(usize capacity) {
+			auto map = SlotMap();
+			map.m_Values.reserve_exact(capacity);
+			map.m_Keys.reserve_exact(capacity);
+			map.m_Slots.reserve_exact(capacity);
+			return map;
+		}
+
+		inline SlotMap(SlotMap&& other) {
+			take_from(other);
+		}
+
+		inline SlotMap(const SlotMap&) = delete;
+
+		inline auto operator=(SlotMap&& other) -> SlotMap& {
+			if (this != &other) {
+				other.check_not_borrowed();
+				drop();
+				take_from(other);
+			}
+			return *this;
+		}
+
+		inline auto operator=(const SlotMap&) -> SlotMap& = delete;
+
+		inline ~SlotMap() {
+			drop();
+		}
+
+		/*
+		* Drops all the values and the slots, the references borrowed from this map expire.
+		*/
+		inline void drop() {
+			if (!m_DropCheck.is_null()) {
+				m_DropCheck.drop();
+				m_DropCheck = ValidityChecker<false>();
+			}
+
+			m_Values.drop();
+			m_Keys.drop();
+			m_Slots.drop();
+			m_FreeHead = internal::slot_map::NoSlot;
+			m_ImmutableBorrowCount = 0;
+			m_IsMutableBorrowed = false;
+		}
+
+		inline usize len() const { return m_Values.len(); }
+		inline bool is_empty() const { return m_Values.is_empty(); }
+		inline usize capacity() const { return m_Values.capacity(); }
+
+		inline u32 num_borrows() const {
+			return m_ImmutableBorrowCount;
+		}
+
+		inline bool is_mutable_borrowed() const {
+			return m_IsMutableBorrowed;
+		}
+
+		/*
+		* Inserts a value and returns its key, a vacant slot is reused if there is one.
+		*/
+		inline auto insert(Type&& value) -> Key {
+			check_not_borrowed();
+
+			if (m_Values.len() >= internal::slot_map::NoSlot) {
+				throw std::length_error("SlotMap is full");
+			}
+
+			// nothing can fail after the value is in
+			m_Values.reserve(1);
+			m_Keys.reserve(1);
+			if (m_FreeHead == internal::slot_map::NoSlot) {
+				m_Slots.reserve(1);
+			}
+			m_Values.push(std::move(value));
+
+			auto index = m_FreeHead;
+			if (index != internal::slot_map::NoSlot) {
+				m_FreeHead = m_Slots.as_ptr()[index].m_Index;
+			}
+			else {
+				index = static_cast<u32>(m_Slots.len());
+				m_Slots.push(internal::slot_map::Slot{ 0, 0 });
+			}
+
+			auto& slot = m_Slots.as_mut_ptr()[index];
+			slot.m_Index = static_cast<u32>(m_Keys.len());
+			slot.m_Generation++;
+			m_Keys.push(index);
+			return Key{ index, slot.m_Generation };
+		}
+
+		inline auto insert(const Type& value) -> Key {
+			return insert(Type(value));
+		}
+
+		/*
+		* Removes the value of key and returns it, None if the key is stale.
+		*/
+		inline auto remove(Key key) {
+			check_not_borrowed();
+
+			if (!contains(key)) {
+				return None<Type>();
+			}
+
+			auto& slot = m_Slots.as_mut_ptr()[key.index];
+			auto position = slot.m_Index;
+			auto value = m_Values.swap_remove(position);
+			m_Keys.swap_remove(position);
+			if (position < m_Keys.len()) {
+				m_Slots.as_mut_ptr()[m_Keys.as_ptr()[position]].m_Index = position;
+			}
+
+			slot.m_Generation++;
+			slot.m_Index = m_FreeHead;
+			m_FreeHead = key.index;
+			return Some<Type>(std::move(value));
+		}
+
+		/*
+		* Removes all the values, the keys handed out so far all become stale.
+		*/
+		inline void clear() {
+			check_not_borrowed();
+
+			for (auto index : m_Keys) {
+				auto& slot = m_Slots.as_mut_ptr()[index];
+				slot.m_Generation++;
+				slot.m_Index = m_FreeHead;
+				m_FreeHead = index;
+			}
+			m_Values.clear();
+			m_Keys.clear();
+		}
+
+		inline bool contains(Key key) const {
+			if (key.index >= m_Slots.len()) {
+				return false;
+			}
+			return m_Slots.as_ptr()[key.index].m_Generation == key.generation && (key.generation & 1) != 0;
+		}
+
+		/*
+		* Borrows the value of key immutably, None if the key is stale.
+		*/
+		inline auto get(Key key) {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (!contains(key)) {
+				return None<Ref<Type>>();
+			}
+
+			m_ImmutableBorrowCount++;
+			return Some<Ref<Type>>(Ref<Type>(m_Values.as_mut_ptr() + m_Slots.as_ptr()[key.index].m_Index, &m_ImmutableBorrowCount, drop_check()));
+		}
+
+		/*
+		* Borrows the value of key mutably, None if the key is stale.
+		*/
+		inline auto get_mut(Key key) {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			if (!contains(key)) {
+				return None<RefMut<Type>>();
+			}
+
+			m_IsMutableBorrowed = true;
+			return Some<RefMut<Type>>(RefMut<Type>(m_Values.as_mut_ptr() + m_Slots.as_ptr()[key.index].m_Index, &m_IsMutableBorrowed, drop_check()));
+		}
+
+		/*
+		* The values in their packed order, which changes when values are removed. The iterators
+		* borrow the map just like get and get_mut, until they are dropped.
+		*/
+		inline auto iter() const {
+			using Source = internal::iter::Loaned<SliceIter<const Type>, false>;
+			auto loan = borrow();
+			return Iter<Source>(Source(SliceIter<const Type>(m_Values.as_ptr(), m_Values.as_ptr() + len()), std::move(loan)));
+		}
+
+		inline auto iter_mut() {
+			using Source = internal::iter::Loaned<SliceIter<Type>, true>;
+			auto loan = borrow_mut();
+			return Iter<Source>(Source(SliceIter<Type>(m_Values.as_mut_ptr(), m_Values.as_mut_ptr() + len()), std::move(loan)));
+		}
+
+		/*
+		* The keys in the same order as iter(), keys().zip(iter()) gives the pairs.
+		*/
+		inline auto keys() const {
+			using Source = internal::iter::Loaned<SliceIter<const u32>, false>;
+			auto loan = borrow();
+			return Iter<Source>(Source(SliceIter<const u32>(m_Keys.as_ptr(), m_Keys.as_ptr() + len()), std::move(loan))).map([slots = m_Slots.as_ptr()](const u32& index) {
+				return Key{ index, slots[index].m_Generation };
+			});
+		}
+
+	private:
+		inline void check_not_borrowed() const {
+			if (m_ImmutableBorrowCount | static_cast<u32>(m_IsMutableBorrowed)) {
+				if (m_IsMutableBorrowed) {
+					throw StillBorrowedMutablyException();
+				}
+				throw StillBorrowedImmutablyException();
+			}
+		}
+
+		inline auto drop_check() const -> ValidityChecker<false>& {
+			if (m_DropCheck.is_null()) {
+				m_DropCheck = ValidityChecker<false>(true);
+			}
+			return m_DropCheck;
+		}
+
+		inline auto borrow() const {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			m_ImmutableBorrowCount++;
+			return RefRaw<void, false, false>(this, &m_ImmutableBorrowCount, drop_check());
+		}
+
+		inline auto borrow_mut() {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			m_IsMutableBorrowed = true;
+			return RefRaw<void, true, false>(this, &m_IsMutableBorrowed, drop_check());
+		}
+
+		inline void take_from(SlotMap& other) {
+			other.check_not_borrowed();
+
+			m_Values = std::move(other.m_Values);
+			m_Keys = std::move(other.m_Keys);
+			m_Slots = std::move(other.m_Slots);
+			m_FreeHead = std::exchange(other.m_FreeHead, internal::slot_map::NoSlot);
+			m_DropCheck = std::move(other.m_DropCheck);
+		}
+
+	private:
+		Vec<Type> m_Values;
+		Vec<u32> m_Keys;
+		Vec<internal::slot_map::Slot> m_Slots;
+		u32 m_FreeHead = internal::slot_map::NoSlot;
+		// mutable so that the iterators can borrow a const map
+		mutable u32 m_ImmutableBorrowCount = 0;
+		mutable u32 m_IsMutableBorrowed = 0;
+		mutable ValidityChecker<false> m_DropCheck;
+	};
+
+	template<typename Type>
+	struct IsSend<SlotMap<Type>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type>
+	struct IsSync<SlotMap<Type>> : std::bool_constant<Sync<Type>> {};
+}
+
+// Hash maps
+namespace rs {
+
+	namespace internal::hash {
+		constexpr u64 Secret0 = 0xa0761d6478bd642full;
+		constexpr u64 Secret1 = 0xe7037ed1a0b428dbull;
+		constexpr u64 Secret2 = 0x8ebc6af09c88c6e3ull;
+
+		// Multiplies into 128 bits and folds the halves, the mixing step of wyhash
+		inline u64 mum(u64 a, u64 b) {
+#if defined(__SIZEOF_INT128__)
+			// __extension__ keeps -Wpedantic quiet about the non standard type
+			__extension__ using u128 = unsigned __int128;
+			auto product = static_cast<u128>(a) * b;
+			return static_cast<u64>(product) ^ static_cast<u64>(product >> 64);
+#else
+			auto aLow = a & 0xffffffff, aHigh = a >> 32;
+			auto bLow = b & 0xffffffff, bHigh = b >> 32;
+			auto low = aLow * bLow;
+			auto middle0 = aHigh * bLow;
+			auto middle1 = aLow * bHigh;
+			auto cross = (low >> 32) + (middle0 & 0xffffffff) + middle1;
+			auto high = aHigh * bHigh + (middle0 >> 32) + (cross >> 32);
+			return ((cross << 32) | (low & 0xffffffff)) ^ high;
+#endif
+		}
+
+		inline u64 read64(const u8* ptr) {
+			u64 value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline u64 read32(const u8* ptr) {
+			u32 value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline u64 hash_u64(u64 value) {
+			return mum(value ^ Secret0, Secret1);
+		}
+
+		// wyhash over the bytes, 16 bytes per step and overlapping reads for the tail
+		inline u64 hash_bytes(const void* data, usize len) {
+			auto ptr = static_cast<const u8*>(data);
+			auto seed = Secret0 ^ len;
+			u64 a = 0;
+			u64 b = 0;
+
+			if (len <= 16) {
+				if (len >= 4) {
+					auto middle = (len >> 3) << 2;
+					a = (read32(ptr) << 32) | read32(ptr + middle);
+					b = (read32(ptr + len - 4) << 32) | read32(ptr + len - 4 - middle);
+				}
+				else if (len > 0) {
+					a = (u64(ptr[0]) << 16) | (u64(ptr[len >> 1]) << 8) | ptr[len - 1];
+				}
+			}
+			else {
+				auto left = len;
+				while (left > 16) {
+					seed = mum(read64(ptr) ^ Secret1, read64(ptr + 8) ^ seed);
+					ptr += 16;
+					left -= 16;
+				}
+				a = read64(ptr + left - 16);
+				b = read64(ptr + left - 8);
+			}
+
+			return mum(Secret1 ^ len, mum(a ^ Secret1, b ^ seed));
+		}
+	}
+
+	/*
+	* The hasher of HashMap and HashSet. Integers, pointers and enums go through one multiply,
+	* strings through wyhash, anything else is what std::hash gives mixed the same way.
+	* It is fast but not keyed, like FxHash it is no defense against keys chosen to collide.
+	*/
+	template<typename Type>
+	struct DefaultHasher {
+		inline u64 operator()(const Type& value) const {
+			if constexpr (std::is_convertible_v<const Type&, std::string_view>) {
+				auto view = std::string_view(value);
+				return internal::hash::hash_bytes(view.data(), view.size());
+			}
+			else if constexpr (std::is_integral_v<Type>) {
+				return internal::hash::hash_u64(static_cast<u64>(value));
+			}
+			else if constexpr (std::is_enum_v<Type>) {
+				return internal::hash::hash_u64(static_cast<u64>(static_cast<std::underlying_type_t<Type>>(value)));
+			}
+			else if constexpr (std::is_pointer_v<Type>) {
+				return internal::hash::hash_u64(static_cast<u64>(reinterpret_cast<std::uintptr_t>(value)));
+			}
+			else if constexpr (std::is_floating_point_v<Type>) {
+				// -0.0 == 0.0, so they have to hash the same
+				return internal::hash::hash_u64(value == Type(0) ? 0 : static_cast<u64>(std::bit_cast<std::conditional_t<sizeof(Type) == 4, u32, u64>>(value)));
+			}
+			else {
+				return internal::hash::hash_u64(static_cast<u64>(std::hash<Type>()(value)));
+			}
+		}
+	};
+
+	template<>
+	struct DefaultHasher<SlotKey> {
+		inline u64 operator()(const SlotKey& key) const {
+			return internal::hash::hash_u64((u64(key.index) << 32) | key.generation);
+		}
+	};
+
+	namespace internal::hash_table {
+
+		// The control byte of every bucket, a full one holds the top 7 bits of the hash
+		constexpr u8 Empty = 0xFF;
+		constexpr u8 Deleted = 0x80;
+
+		inline bool is_full(u8 ctrl) {
+			return (ctrl & 0x80) == 0;
+		}
+
+		inline u8 h2(u64 hash) {
+			return static_cast<u8>(hash >> 57);
+		}
+
+		// The positions of a group that matched, every position takes Stride bits
+		template<usize Stride, usize Width>
+		class BitMask {
+		public:
+			inline explicit BitMask(u64 bits)
+				: m_Bits(bits)
+			{
+			}
+
+			inline bool any() const {
+				return m_Bits != 0;
+			}
+
+			inline usize lowest() const {
+				return static_cast<usize>(std::countr_zero(m_Bits)) / Stride;
+			}
+
+			inline void remove_lowest() {
+				m_Bits &= m_Bits - 1;
+			}
+
+			// The positions before the first match, Width if there is none
+			inline usize trailing_zeros() const {
+				return m_Bits == 0 ? Width : lowest();
+			}
+
+			// The positions after the last match, Width if there is none
+			inline usize leading_zeros() const {
+				return m_Bits == 0 ? Width : (static_cast<usize>(std::countl_zero(m_Bits)) - (64 - Width * Stride)) / Stride;
+			}
+
+		private:
+			u64 m_Bits;
+		};
+
+#if RS_SIMD_X86 && defined(__SSE2__)
+		// 16 control bytes compared at once with SSE2
+		class Group {
+		public:
+			static constexpr usize Width = 16;
+
+			using Mask = BitMask<1, Width>;
+
+			static inline auto load(const u8* ctrl) {
+				return Group(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)));
+			}
+
+			inline auto match(u8 byte) const {
+				return Mask(static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(m_Ctrl, _mm_set1_epi8(static_cast<char>(byte))))));
+			}
+
+			inline auto match_empty() const {
+				return match(Empty);
+			}
+
+			inline auto match_empty_or_deleted() const {
+				return Mask(static_cast<u32>(_mm_movemask_epi8(m_Ctrl)));
+			}
+
+		private:
+			inline explicit Group(__m128i ctrl)
+				: m_Ctrl(ctrl)
+			{
+			}
+
+		private:
+			__m128i m_Ctrl;
+		};
+#else
+		// 8 control bytes compared at once inside of a u64, match can give false positives
+		// which are sorted out by comparing the keys
+		class Group {
+		public:
+			static constexpr usize Width = 8;
+
+			using Mask = BitMask<8, Width>;
+
+			static inline auto load(const u8* ctrl) {
+				u64 value = 0;
+				for (usize i = 0; i < Width; i++) {
+					value |= u64(ctrl[i]) << (i * 8);
+				}
+				return Group(value);
+			}
+
+			inline auto match(u8 byte) const {
+				auto cmp = m_Ctrl ^ (Lsb * byte);
+				return Mask((cmp - Lsb) & ~cmp & Msb);
+			}
+
+			inline auto match_empty() const {
+				return Mask(m_Ctrl & (m_Ctrl << 1) & Msb);
+			}
+
+			inline auto match_empty_or_deleted() const {
+				return Mask(m_Ctrl & Msb);
+			}
+
+		private:
+			static constexpr u64 Lsb = 0x0101010101010101ull;
+			static constexpr u64 Msb = 0x8080808080808080ull;
+
+			inline explicit Group(u64 ctrl)
+				: m_Ctrl(ctrl)
+			{
+			}
+
+		private:
+			u64 m_Ctrl;
+		};
+#endif
+
+		/*
+		* The open addressing table under HashMap and HashSet, SwissTable's layout: a power of two
+		* number of buckets and one control byte per bucket, probed a group of bytes at a time.
+		* The first group of control bytes is repeated after the last one so a group can be loaded
+		* from any position. The table never hashes by itself, whoever uses it passes the hashes.
+		*/
+		template<typename Bucket>
+		class RawTable {
+		public:
+			inline RawTable() noexcept
+				: m_Ctrl(const_cast<RawPtr<u8>>(s_EmptyGroup)),
+				m_Resource(internal::t_Resource)
+			{
+			}
+
+			inline RawTable(RawTable&& other) noexcept
+				: RawTable()
+			{
+				swap(other);
+			}
+
+			inline auto operator=(RawTable&& other) noexcept -> RawTable& {
+				if (this != &other) {
+					free();
+					swap(other);
+				}
+				return *this;
+			}
+
+			inline RawTable(const RawTable&) = delete;
+			inline auto operator=(const RawTable&) -> RawTable& = delete;
+
+			inline ~RawTable() {
+				free();
+			}
+
+			inline usize len() const { return m_Items; }
+			inline usize buckets() const { return m_Slots == nullptr ? 0 : m_BucketMask + 1; }
+			inline usize capacity() const { return m_Items + m_GrowthLeft; }
+			inline auto ctrl() const -> const u8* { return m_Ctrl; }
+			inline auto slots() const { return m_Slots; }
+
+			template<typename Eq>
+			inline auto find(u64 hash, Eq&& eq) const -> RawPtr<Bucket> {
+				auto h2 = hash_table::h2(hash);
+				auto pos = static_cast<usize>(hash) & m_BucketMask;
+				for (usize stride = 0; ; ) {
+					auto group = Group::load(m_Ctrl + pos);
+					for (auto matches = group.match(h2); matches.any(); matches.remove_lowest()) {
+						auto index = (pos + matches.lowest()) & m_BucketMask;
+						if (eq(m_Slots[index])) {
+							return m_Slots + index;
+						}
+					}
+
+					if (group.match_empty().any()) {
+						return nullptr;
+					}
+
+					stride += Group::Width;
+					pos = (pos + stride) & m_BucketMask;
+				}
+			}
+
+			/*
+			* Constructs a bucket from args for a key that is not in the table, growing it first if it
+			* is full. hashOf gives the hashes of the buckets that are moved when it grows.
+			*/
+			template<typename HashOf, typename... Args>
+			inline auto insert_new(u64 hash, const HashOf& hashOf, Args&&... args) -> RawPtr<Bucket> {
+				auto index = find_insert_slot(hash);
+				if (m_GrowthLeft == 0 && m_Ctrl[index] == Empty) {
+					resize(m_Items + 1, hashOf);
+					index = find_insert_slot(hash);
+				}
+
+				new (m_Slots + index) Bucket(std::forward<Args>(args)...);
+				m_GrowthLeft -= static_cast<usize>(m_Ctrl[index] == Empty);
+				set_ctrl(index, h2(hash));
+				m_Items++;
+				return m_Slots + index;
+			}
+
+			inline void erase(RawPtr<Bucket> bucket) {
+				auto index = static_cast<usize>(bucket - m_Slots);
+				std::destroy_at(bucket);
+
+				// If there was never a full group around the bucket no probe went past it,
+				// so it can go back to empty instead of leaving a tombstone
+				auto before = Group::load(m_Ctrl + ((index - Group::Width) & m_BucketMask)).match_empty();
+				auto after = Group::load(m_Ctrl + index).match_empty();
+				if (before.leading_zeros() + after.trailing_zeros() < Group::Width) {
+					set_ctrl(index, Empty);
+					m_GrowthLeft++;
+				}
+				else {
+					set_ctrl(index, Deleted);
+				}
+				m_Items--;
+			}
+
+			template<typename HashOf>
+			inline void reserve(usize additional, const HashOf& hashOf) {
+				if (additional > m_GrowthLeft) {
+					if (additional > std::numeric_limits<usize>::max() - m_Items) {
+						throw std::length_error("HashMap capacity overflow");
+					}
+					resize(m_Items + additional, hashOf);
+				}
+			}
+
+			inline void clear() {
+				if (m_Slots == nullptr) {
+					return;
+				}
+
+				destroy_buckets();
+				std::memset(m_Ctrl, Empty, m_BucketMask + 1 + Group::Width);
+				m_Items = 0;
+				m_GrowthLeft = capacity_of(m_BucketMask + 1);
+			}
+
+			inline void swap(RawTable& other) noexcept {
+				std::swap(m_Ctrl, other.m_Ctrl);
+				std::swap(m_Slots, other.m_Slots);
+				std::swap(m_BucketMask, other.m_BucketMask);
+				std::swap(m_Items, other.m_Items);
+				std::swap(m_GrowthLeft, other.m_GrowthLeft);
+				std::swap(m_Resource, other.m_Resource);
+			}
+
+		private:
+			// Up to 7/8 of the buckets are used, all but one in the smallest tables
+			static inline usize capacity_of(usize buckets) {
+				return buckets < 8 ? buckets - 1 : buckets / 8 * 7;
+			}
+
+			static inline usize buckets_for(usize capacity) {
+				if (capacity > std::numeric_limits<usize>::max() / 16) {
+					throw std::length_error("HashMap capacity overflow");
+				}
+
+				auto buckets = std::max<usize>(Group::Width, std::bit_ceil(capacity * 8 / 7 + 1));
+				while (capacity_of(buckets) < capacity) {
+					buckets *= 2;
+				}
+				return buckets;
+			}
+
+			inline usize find_insert_slot(u64 hash) const {
+				auto pos = static_cast<usize>(hash) & m_BucketMask;
+				for (usize stride = 0; ; ) {
+					auto free = Group::load(m_Ctrl + pos).match_empty_or_deleted();
+					if (free.any()) {
+						return (pos + free.lowest()) & m_BucketMask;
+					}
+
+					stride += Group::Width;
+					pos = (pos + stride) & m_BucketMask;
+				}
+			}
+
+			inline void set_ctrl(usize index, u8 ctrl) {
+				m_Ctrl[index] = ctrl;
+				m_Ctrl[((index - Group::Width) & m_BucketMask) + Group::Width] = ctrl;
+			}
+
+			// Moves every bucket into a new table that fits capacity, which also drops the tombstones
+			template<typename HashOf>
+			inline void resize(usize capacity, const HashOf& hashOf) {
+				auto table = RawTable();
+				table.m_Resource = m_Resource;
+				table.allocate(buckets_for(std::max(capacity, m_Items)));
+
+				for (usize i = 0; i <= m_BucketMask && m_Slots != nullptr; i++) {
+					if (is_full(m_Ctrl[i])) {
+						auto hash = hashOf(m_Slots[i]);
+						auto index = table.find_insert_slot(hash);
+						new (table.m_Slots + index) Bucket(std::move(m_Slots[i]));
+						table.set_ctrl(index, h2(hash));
+					}
+				}
+				table.m_Items = m_Items;
+				table.m_GrowthLeft -= m_Items;
+
+				swap(table);
+			}
+
+			inline void allocate(usize buckets) {
+				auto bytes = bytes_for(buckets);
+				auto memory = m_Resource != nullptr
+					? m_Resource->allocate(bytes, alignof(Bucket))
+					: ::operator new(bytes, std::align_val_t(alignof(Bucket)));
+
+				m_Slots = static_cast<RawPtr<Bucket>>(memory);
+				m_Ctrl = reinterpret_cast<RawPtr<u8>>(m_Slots + buckets);
+				std::memset(m_Ctrl, Empty, buckets + Group::Width);
+				m_BucketMask = buckets - 1;
+				m_GrowthLeft = capacity_of(buckets);
+			}
+
+			inline void destroy_buckets() {
+				if constexpr (!std::is_trivially_destructible_v<Bucket>) {
+					for (usize i = 0; i <= m_BucketMask; i++) {
+						if (is_full(m_Ctrl[i])) {
+							std::destroy_at(m_Slots + i);
+						}
+					}
+				}
+			}
+
+			inline void free() {
+				if (m_Slots == nullptr) {
+					return;
+				}
+
+				destroy_buckets();
+				auto bytes = bytes_for(m_BucketMask + 1);
+				if (m_Resource != nullptr) {
+					m_Resource->deallocate(m_Slots, bytes, alignof(Bucket));
+				}
+				else {
+					::operator delete(m_Slots, bytes, std::align_val_t(alignof(Bucket)));
+				}
+
+				m_Ctrl = const_cast<RawPtr<u8>>(s_EmptyGroup);
+				m_Slots = nullptr;
+				m_BucketMask = 0;
+				m_Items = 0;
+				m_GrowthLeft = 0;
+			}
+
+			static inline usize bytes_for(usize buckets) {
+				return buckets * sizeof(Bucket) + buckets + Group::Width;
+			}
+
+		private:
+			RawPtr<u8> m_Ctrl;
+			RawPtr<Bucket> m_Slots = nullptr;
+			usize m_BucketMask = 0;
+			usize m_Items = 0;
+			usize m_GrowthLeft = 0;
+			RawPtr<std::pmr::memory_resource> m_Resource;
+
+			// What a table without buckets probes, a group that is all empty
+			alignas(16) static inline const u8 s_EmptyGroup[16] = {
+				Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty,
+				Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty
+			};
+		};
+
+		// Walks the full buckets of a table, Project turns a bucket into the item
+		template<typename Bucket, typename Project>
+		class TableIter {
+		public:
+			using Item = std::invoke_result_t<Project, Bucket&>;
+
+			inline TableIter(const u8* ctrl, RawPtr<Bucket> slots, usize buckets, usize items)
+				: m_Ctrl(ctrl),
+				m_Slots(slots),
+				m_Buckets(buckets),
+				m_Items(items)
+			{
+			}
+
+			inline auto next() -> iter::Next<Item> {
+				while (m_Index < m_Buckets) {
+					auto index = m_Index++;
+					if (is_full(m_Ctrl[index])) {
+						m_Items--;
+						return iter::Next<Item>(Project()(m_Slots[index]));
+					}
+				}
+				return {};
+			}
+
+			template<typename F>
+			inline bool for_each_while(F& f) {
+				while (m_Index < m_Buckets) {
+					auto index = m_Index++;
+					if (is_full(m_Ctrl[index])) {
+						m_Items--;
+						if (!f(Project()(m_Slots[index]))) {
+							return false;
+						}
+					}
+				}
+				return true;
+			}
+
+			inline auto size_hint() -> iter::SizeHint {
+				return { m_Items, m_Items };
+			}
+
+		private:
+			const u8* m_Ctrl;
+			RawPtr<Bucket> m_Slots;
+			usize m_Buckets;
+			usize m_Items;
+			usize m_Index = 0;
+		};
+	}
+
+	/*
+	* A hash map, the equivalent of Rust's HashMap (which is hashbrown, a port of SwissTable).
+	*
+	* The buckets live in one open addressing table probed with SSE2 on x86 (8 bytes at a time
+	* in a u64 elsewhere). get, get_mut and the iterators borrow the whole map like a Vec, it can
+	* not be modified while one of them is alive, so the values never move under a Ref.
+	* entry() hashes the key once for the lookup and the insertion.
+	*/
+	template<typename Key, typename Value, typename Hasher = DefaultHasher<Key>>
+	class HashMap {
+	private:
+		struct Bucket {
+			Key m_Key;
+			Value m_Value;
+		};
+
+		struct Project {
+			inline auto operator()(Bucket& bucket) const {
+				return std::pair<const Key&, Value&>(bucket.m_Key, bucket.m_Value);
+			}
+		};
+
+		struct ProjectConst {
+			inline auto operator()(Bucket& bucket) const {
+				return std::pair<const Key&, const Value&>(bucket.m_Key, bucket.m_Value);
+			}
+		};
+
+	public:
+		/*
+		* A place in the map for one key, taken by entry(). It borrows the map mutably until it is
+		* dropped or turned into a reference to the value by one of the or_insert functions.
+		*/
+		class Entry {
+		public:
+			inline Entry(Entry&& other) noexcept
+				: m_Map(std::exchange(other.m_Map, nullptr)),
+				m_Key(std::move(other.m_Key)),
+				m_Hash(other.m_Hash),
+				m_Bucket(other.m_Bucket)
+			{
+			}
+
+			inline Entry(const Entry&) = delete;
+			inline auto operator=(const Entry&) -> Entry& = delete;
+			inline auto operator=(Entry&&) -> Entry& = delete;
+
+			inline ~Entry() {
+				if (m_Map != nullptr) {
+					m_Map->m_IsMutableBorrowed = false;
+				}
+			}
+
+			inline bool is_occupied() const {
+				return m_Bucket != nullptr;
+			}
+
+			inline auto key() const -> const Key& {
+				return m_Bucket != nullptr ? m_Bucket->m_Key : m_Key;
+			}
+
+			/*
+			* Calls f with the value if the key is in the map.
+			*/
+			template<typename F>
+			inline auto and_modify(F f) -> Entry&& {
+				if (m_Bucket != nullptr) {
+					f(m_Bucket->m_Value);
+				}
+				return std::move(*this);
+			}
+
+			inline auto or_insert(Value value) {
+				return or_insert_with([&] { return std::move(value); });
+			}
+
+			/*
+			* The value of the key, f makes it first if the key is not in the map.
+			*/
+			template<typename F>
+			inline auto or_insert_with(F f) {
+				if (m_Bucket == nullptr) {
+					m_Bucket = m_Map->m_Table.insert_new(m_Hash, m_Map->hash_of(), std::move(m_Key), f());
+				}
+				// the borrow of the entry becomes the one of the reference
+				return std::exchange(m_Map, nullptr)->borrow_mut(m_Bucket);
+			}
+
+			inline auto or_default() requires(std::default_initializable<Value>) {
+				return or_insert_with([] { return Value(); });
+			}
+
+		private:
+			inline Entry(RawPtr<HashMap> map, Key&& key, u64 hash, RawPtr<Bucket> bucket)
+				: m_Map(map),
+				m_Key(std::move(key)),
+				m_Hash(hash),
+				m_Bucket(bucket)
+			{
+			}
+
+		private:
+			RawPtr<HashMap> m_Map;
+			Key m_Key;
+			u64 m_Hash;
+			RawPtr<Bucket> m_Bucket;
+
+			friend class HashMap;
+		};
+
+		inline HashMap() = default;
+
+		inline explicit HashMap(Hasher hasher)
+			: m_Hasher(std::move(hasher))
+		{
+		}
+
+		inline HashMap(std::initializer_list<std::pair<Key, Value>> values)
+		{
+			reserve(values.size());
+			for (const auto& [key, value] : values) {
+				insert(key, value);
+			}
+		}
+
+		static inline auto with_capacity(usize capacity) {
+			auto map = HashMap();
+			map.reserve(capacity);
+			return map;
+		}
+
+		inline HashMap(HashMap&& other) {
+			take_from(other);
+		}
+
+		inline HashMap(const HashMap&) = delete;
+
+		inline auto operator=(HashMap&& other) -> HashMap& {
+			if (this != &other) {
+				other.check_not_borrowed();
+				drop();
+				take_from(other);
+			}
+			return *this;
+		}
+
+		inline auto operator=(const HashMap&) -> HashMap& = delete;
+
+		inline ~HashMap() {
+			drop();
+		}
+
+		/*
+		* Drops all the entries and the table, the references borrowed from this map expire.
+		*/
+		inline void drop() {
+			if (!m_DropCheck.is_null()) {
+				m_DropCheck.drop();
+				m_DropCheck = ValidityChecker<false>();
+			}
+
+			m_Table = internal::hash_table::RawTable<Bucket>();
+			m_ImmutableBorrowCount = 0;
+			m_IsMutableBorrowed = false;
+		}
+
+		inline usize len() const { return m_Table.len(); }
+		inline bool is_empty() const { return m_Table.len() == 0; }
+		inline usize capacity() const { return m_Table.capacity(); }
+
+		inline u32 num_borrows() const {
+			return m_ImmutableBorrowCount;
+		}
+
+		inline bool is_mutable_borrowed() const {
+			return m_IsMutableBorrowed;
+		}
+
+		/*
+		* Inserts a key and value, the value that was there for the key is returned.
+		*/
+		inline auto insert(Key key, Value value) {
+			check_not_borrowed();
+
+			auto hash = m_Hasher(key);
+			if (auto bucket = find(hash, key)) {
+				return Some<Value>(std::exchange(bucket->m_Value, std::move(value)));
+			}
+
+			m_Table.insert_new(hash, hash_of(), std::move(key), std::move(value));
+			return None<Value>();
+		}
+
+		inline bool contains_key(const Key& key) const {
+			return find(m_Hasher(key), key) != nullptr;
+		}
+
+		/*
+		* Borrows the value of key immutably, None if it is not in the map.
+		*/
+		inline auto get(const Key& key) {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			auto bucket = find(m_Hasher(key), key);
+			if (bucket == nullptr) {
+				return None<Ref<Value>>();
+			}
+
+			m_ImmutableBorrowCount++;
+			return Some<Ref<Value>>(Ref<Value>(&bucket->m_Value, &m_ImmutableBorrowCount, drop_check()));
+		}
+
+		/*
+		* Borrows the value of key mutably, None if it is not in the map.
+		*/
+		inline auto get_mut(const Key& key) {
+			check_not_borrowed_mut();
+
+			auto bucket = find(m_Hasher(key), key);
+			if (bucket == nullptr) {
+				return None<RefMut<Value>>();
+			}
+
+			m_IsMutableBorrowed = true;
+			return Some<RefMut<Value>>(borrow_mut(bucket));
+		}
+
+		inline auto entry(Key key) {
+			check_not_borrowed_mut();
+
+			auto hash = m_Hasher(key);
+			auto bucket = find(hash, key);
+			m_IsMutableBorrowed = true;
+			return Entry(this, std::move(key), hash, bucket);
+		}
+
+		/*
+		* Removes key and returns its value, None if it was not in the map.
+		*/
+		inline auto remove(const Key& key) {
+			check_not_borrowed();
+
+			auto bucket = find(m_Hasher(key), key);
+			if (bucket == nullptr) {
+				return None<Value>();
+			}
+
+			auto value = Value(std::move(bucket->m_Value));
+			m_Table.erase(bucket);
+			return Some<Value>(std::move(value));
+		}
+
+		/*
+		* Keeps only the entries for which predicate(key, value) returns true.
+		*/
+		template<typename Predicate>
+		inline void retain(Predicate&& predicate) {
+			check_not_borrowed();
+
+			auto ctrl = m_Table.ctrl();
+			auto slots = m_Table.slots();
+			for (usize i = 0; i < m_Table.buckets(); i++) {
+				if (internal::hash_table::is_full(ctrl[i]) && !predicate(std::as_const(slots[i].m_Key), slots[i].m_Value)) {
+					m_Table.erase(slots + i);
+				}
+			}
+		}
+
+		/*
+		* Makes room for at least additional more entries, the table grows now if it has to so that
+		* the next inserts do not.
+		*/
+		inline void reserve(usize additional) {
+			check_not_borrowed();
+			m_Table.reserve(additional, hash_of());
+		}
+
+		/*
+		* Drops all the entries and keeps the table.
+		*/
+		inline void clear() {
+			check_not_borrowed();
+			m_Table.clear();
+		}
+
+		/*
+		* The (key, value) pairs in no particular order.
+		*/
+		inline auto iter() const {
+			using Table = internal::hash_table::TableIter<Bucket, ProjectConst>;
+			using Source = internal::iter::Loaned<Table, false>;
+			auto loan = borrow();
+			return Iter<Source>(Source(Table(m_Table.ctrl(), m_Table.slots(), m_Table.buckets(), m_Table.len()), std::move(loan)));
+		}
+
+		inline auto iter_mut() {
+			using Table = internal::hash_table::TableIter<Bucket, Project>;
+			using Source = internal::iter::Loaned<Table, true>;
+			auto loan = borrow_mut();
+			return Iter<Source>(Source(Table(m_Table.ctrl(), m_Table.slots(), m_Table.buckets(), m_Table.len()), std::move(loan)));
+		}
+
+		inline auto keys() const {
+			return iter().map([](std::pair<const Key&, const Value&> pair) -> const Key& { return pair.first; });
+		}
+
+		inline auto values() const {
+			return iter().map([](std::pair<const Key&, const Value&> pair) -> const Value& { return pair.second; });
+		}
+
+	private:
+		inline auto find(u64 hash, const Key& key) const {
+			return m_Table.find(hash, [&](const Bucket& bucket) { return bucket.m_Key == key; });
+		}
+
+		inline auto hash_of() const {
+			return [this](const Bucket& bucket) { return m_Hasher(bucket.m_Key); };
+		}
+
+		// Must only be called with the mutable borrow flag already set
+		inline auto borrow_mut(RawPtr<Bucket> bucket) {
+			return RefMut<Value>(&bucket->m_Value, &m_IsMutableBorrowed, drop_check());
+		}
+
+		// The borrows of the whole map held by its iterators
+		inline auto borrow() const {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			m_ImmutableBorrowCount++;
+			return RefRaw<void, false, false>(this, &m_ImmutableBorrowCount, drop_check());
+		}
+
+		inline auto borrow_mut() {
+			check_not_borrowed_mut();
+
+			m_IsMutableBorrowed = true;
+			return RefRaw<void, true, false>(this, &m_IsMutableBorrowed, drop_check());
+		}
+
+		inline void check_not_borrowed() const {
+			if (m_ImmutableBorrowCount | static_cast<u32>(m_IsMutableBorrowed)) {
+				if (m_IsMutableBorrowed) {
+					throw StillBorrowedMutablyException();
+				}
+				throw StillBorrowedImmutablyException();
+			}
+		}
+
+		inline void check_not_borrowed_mut() const {
+			if (m_IsMutableBorrowed) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (m_ImmutableBorrowCount > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+		}
+
+		inline auto drop_check() const -> ValidityChecker<false>& {
+			if (m_DropCheck.is_null()) {
+				m_DropCheck = ValidityChecker<false>(true);
+			}
+			return m_DropCheck;
+		}
+
+		inline void take_from(HashMap& other) {
+			other.check_not_borrowed();
+
+			m_Table = std::move(other.m_Table);
+			m_Hasher = other.m_Hasher;
+			m_DropCheck = std::move(other.m_DropCheck);
+		}
+
+	private:
+		internal::hash_table::RawTable<Bucket> m_Table;
+		[[no_unique_address]] Hasher m_Hasher;
+		// mutable so that the iterators can borrow a const map
+		mutable u32 m_ImmutableBorrowCount = 0;
+		mutable u32 m_IsMutableBorrowed = 0;
+		mutable ValidityChecker<false> m_DropCheck;
+	};
+
+	/*
+	* A hash set, a HashMap without values. The keys can not be modified in place, so the set is
+	* only ever borrowed immutably, by its iterators.
+	*/
+	template<typename Key, typename Hasher = DefaultHasher<Key>>
+	class HashSet {
+	private:
+		struct Bucket {
+			Key m_Key;
+		};
+
+		struct Project {
+			inline auto operator()(Bucket& bucket) const -> const Key& {
+				return bucket.m_Key;
+			}
+		};
+
+	public:
+		inline HashSet() = default;
+
+		inline explicit HashSet(Hasher hasher)
+			: m_Hasher(std::move(hasher))
+		{
+		}
+
+		inline HashSet(std::initializer_list<Key> keys)
+		{
+			reserve(keys.size());
+			for (const auto& key : keys) {
+				insert(key);
+			}
+		}
+
+		static inline auto with_capacity(usize capacity) {
+			auto set = HashSet();
+			set.reserve(capacity);
+			return set;
+		}
+
+		inline HashSet(HashSet&& other) {
+			take_from(other);
+		}
+
+		inline HashSet(const HashSet&) = delete;
+
+		inline auto operator=(HashSet&& other) -> HashSet& {
+			if (this != &other) {
+				other.check_not_borrowed();
+				drop();
+				take_from(other);
+			}
+			return *this;
+		}
+
+		inline auto operator=(const HashSet&) -> HashSet& = delete;
+
+		inline ~HashSet() {
+			drop();
+		}
+
+		/*
+		* Drops all the keys and the table, the iterators borrowed from this set expire.
+		*/
+		inline void drop() {
+			if (!m_DropCheck.is_null()) {
+				m_DropCheck.drop();
+				m_DropCheck = ValidityChecker<false>();
+			}
+
+			m_Table = internal::hash_table::RawTable<Bucket>();
+			m_ImmutableBorrowCount = 0;
+		}
+
+		inline usize len() const { return m_Table.len(); }
+		inline bool is_empty() const { return m_Table.len() == 0; }
+		inline usize capacity() const { return m_Table.capacity(); }
+
+		/*
+		* Adds key, returns false if it was already there.
+		*/
+		inline bool insert(Key key) {
+			check_not_borrowed();
+			auto hash = m_Hasher(key);
+			if (find(hash, key) != nullptr) {
+				return false;
+			}
+
+			m_Table.insert_new(hash, hash_of(), std::move(key));
+			return true;
+		}
+
+		inline bool contains(const Key& key) const {
+			return find(m_Hasher(key), key) != nullptr;
+		}
+
+		/*
+		* Removes key, returns false if it was not there.
+		*/
+		inline bool remove(const Key& key) {
+			check_not_borrowed();
+			auto bucket = find(m_Hasher(key), key);
+			if (bucket == nullptr) {
+				return false;
+			}
+
+			m_Table.erase(bucket);
+			return true;
+		}
+
+		/*
+		* Removes key and returns it, None if it was not there.
+		*/
+		inline auto take(const Key& key) {
+			check_not_borrowed();
+			auto bucket = find(m_Hasher(key), key);
+			if (bucket == nullptr) {
+				return None<Key>();
+			}
+
+			auto taken = Key(std::move(bucket->m_Key));
+			m_Table.erase(bucket);
+			return Some<Key>(std::move(taken));
+		}
+
+		template<typename Predicate>
+		inline void retain(Predicate&& predicate) {
+			check_not_borrowed();
+			auto ctrl = m_Table.ctrl();
+			auto slots = m_Table.slots();
+			for (usize i = 0; i < m_Table.buckets(); i++) {
+				if (internal::hash_table::is_full(ctrl[i]) && !predicate(std::as_const(slots[i].m_Key))) {
+					m_Table.erase(slots + i);
+				}
+			}
+		}
+
+		inline void reserve(usize additional) {
+			check_not_borrowed();
+			m_Table.reserve(additional, hash_of());
+		}
+
+		inline void clear() {
+			check_not_borrowed();
+			m_Table.clear();
+		}
+
+		/*
+		* The keys in no particular order, the set can not be modified until the iterator is dropped.
+		*/
+		inline auto iter() const {
+			using Table = internal::hash_table::TableIter<Bucket, Project>;
+			using Source = internal::iter::Loaned<Table, false>;
+			auto loan = borrow();
+			return Iter<Source>(Source(Table(m_Table.ctrl(), m_Table.slots(), m_Table.buckets(), m_Table.len()), std::move(loan)));
+		}
+
+	private:
+		inline auto find(u64 hash, const Key& key) const {
+			return m_Table.find(hash, [&](const Bucket& bucket) { return bucket.m_Key == key; });
+		}
+
+		inline auto hash_of() const {
+			return [this](const Bucket& bucket) { return m_Hasher(bucket.m_Key); };
+		}
+
+		inline auto borrow() const {
+			m_ImmutableBorrowCount++;
+			return RefRaw<void, false, false>(this, &m_ImmutableBorrowCount, drop_check());
+		}
+
+		inline void check_not_borrowed() const {
+			if (m_ImmutableBorrowCount > 0) {
+				throw StillBorrowedImmutablyException();
+			}
+		}
+
+		inline auto drop_check() const -> ValidityChecker<false>& {
+			if (m_DropCheck.is_null()) {
+				m_DropCheck = ValidityChecker<false>(true);
+			}
+			return m_DropCheck;
+		}
+
+		inline void take_from(HashSet& other) {
+			other.check_not_borrowed();
+
+			m_Table = std::move(other.m_Table);
+			m_Hasher = other.m_Hasher;
+			m_DropCheck = std::move(other.m_DropCheck);
+		}
+
+	private:
+		internal::hash_table::RawTable<Bucket> m_Table;
+		[[no_unique_address]] Hasher m_Hasher;
+		// mutable so that the iterators can borrow a const set
+		mutable u32 m_ImmutableBorrowCount = 0;
+		mutable ValidityChecker<false> m_DropCheck;
+	};
+
+	template<typename Key, typename Value, typename Hasher>
+	struct IsSend<HashMap<Key, Value, Hasher>> : std::bool_constant<Send<Key> && Send<Value>> {};
+
+	template<typename Key, typename Value, typename Hasher>
+	struct IsSync<HashMap<Key, Value, Hasher>> : std::bool_constant<Sync<Key> && Sync<Value>> {};
+
+	template<typename Key, typename Hasher>
+	struct IsSend<HashSet<Key, Hasher>> : std::bool_constant<Send<Key>> {};
+
+	template<typename Key, typename Hasher>
+	struct IsSync<HashSet<Key, Hasher>> : std::bool_constant<Sync<Key>> {};
+}
+
+// Concurrent maps
+namespace rs {
+
+	namespace internal::concurrent_map {
+
+		/*
+		* A reader writer lock in one u32: the readers are counted in the low bits, the top bit is
+		* the writer and the next one is set by a writer that waits, which keeps new readers out so
+		* a stream of them can not starve it. Taking it spins for a bit and then sleeps on the word.
+		*/
+		class RwWord {
+		public:
+			inline void lock_shared() {
+				for (usize spin = 0; ; spin++) {
+					auto state = m_State.load(std::memory_order_relaxed);
+					if ((state & (Writer | WriterWaiting)) == 0) {
+						if (m_State.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+							return;
+						}
+						continue;
+					}
+					pause(spin, state);
+				}
+			}
+
+			inline void unlock_shared() {
+				auto previous = m_State.fetch_sub(1, std::memory_order_release);
+				if ((previous & Readers) == 1 && (previous & WriterWaiting) != 0) {
+					m_State.notify_all();
+				}
+			}
+
+			inline void lock() {
+				for (usize spin = 0; ; spin++) {
+					auto state = m_State.load(std::memory_order_relaxed);
+					if ((state & ~WriterWaiting) == 0) {
+						if (m_State.compare_exchange_weak(state, Writer, std::memory_order_acquire, std::memory_order_relaxed)) {
+							return;
+						}
+						continue;
+					}
+
+					if ((state & WriterWaiting) == 0) {
+						m_State.compare_exchange_weak(state, state | WriterWaiting, std::memory_order_relaxed);
+						continue;
+					}
+					pause(spin, state);
+				}
+			}
+
+			inline void unlock() {
+				m_State.store(0, std::memory_order_release);
+				m_State.notify_all();
+			}
+
+		private:
+			static constexpr u32 Writer = 1u << 31;
+			static constexpr u32 WriterWaiting = 1u << 30;
+			static constexpr u32 Readers = WriterWaiting - 1;
+
+			inline void pause(usize spin, u32 state) {
+				if (spin < 64) {
+					std::this_thread::yield();
+				}
+				else {
+					m_State.wait(state, std::memory_order_relaxed);
+				}
+			}
+
+		private:
+			std::atomic<u32> m_State = 0;
+		};
+
+		template<typename Key, typename Value>
+		struct Bucket {
+			Key m_Key;
+			Value m_Value;
+		};
+
+		// Every shard on its own cache line, so taking one lock does not slow down the others
+		template<typename Key, typename Value>
+		struct alignas(64) Shard {
+			RwWord m_Lock;
+			hash_table::RawTable<Bucket<Key, Value>> m_Table;
+		};
+	}
+
+	namespace sync {
+
+		/*
+		* A shared borrow of a value in a ConcurrentMap, its shard stays read locked until it is dropped.
+		*/
+		template<typename Key, typename Value>
+		class ReadGuard {
+		public:
+			inline ReadGuard(ReadGuard&& other) noexcept
+				: m_Lock(std::exchange(other.m_Lock, nullptr)),
+				m_Bucket(other.m_Bucket)
+			{
+			}
+
+			inline auto operator=(ReadGuard&& other) noexcept -> ReadGuard& {
+				if (this != &other) {
+					if (m_Lock != nullptr) {
+						m_Lock->unlock_shared();
+					}
+					m_Lock = std::exchange(other.m_Lock, nullptr);
+					m_Bucket = other.m_Bucket;
+				}
+				return *this;
+			}
+
+			inline ReadGuard(const ReadGuard&) = delete;
+			inline auto operator=(const ReadGuard&) -> ReadGuard& = delete;
+
+			inline ~ReadGuard() {
+				if (m_Lock != nullptr) {
+					m_Lock->unlock_shared();
+				}
+			}
+
+			inline auto key() const -> const Key& { return m_Bucket->m_Key; }
+			inline auto value() const -> const Value& { return m_Bucket->m_Value; }
+
+			inline auto operator*() const -> const Value& { return m_Bucket->m_Value; }
+			inline auto operator->() const -> const Value* { return &m_Bucket->m_Value; }
+
+		private:
+			inline ReadGuard(RawPtr<internal::concurrent_map::RwWord> lock, RawPtr<internal::concurrent_map::Bucket<Key, Value>> bucket)
+				: m_Lock(lock),
+				m_Bucket(bucket)
+			{
+			}
+
+		private:
+			RawPtr<internal::concurrent_map::RwWord> m_Lock;
+			RawPtr<internal::concurrent_map::Bucket<Key, Value>> m_Bucket;
+
+			template<typename K, typename V, typename H>
+			friend class ConcurrentMap;
+		};
+
+		/*
+		* An exclusive borrow of a value in a ConcurrentMap, its shard stays write locked until it is dropped.
+		*/
+		template<typename Key, typename Value>
+		class WriteGuard {
+		public:
+			inline WriteGuard(WriteGuard&& other) noexcept
+				: m_Lock(std::exchange(other.m_Lock, nullptr)),
+				m_Bucket(other.m_Bucket)
+			{
+			}
+
+			inline auto operator=(WriteGuard&& other) noexcept -> WriteGuard& {
+				if (this != &other) {
+					if (m_Lock != nullptr) {
+						m_Lock->unlock();
+					}
+					m_Lock = std::exchange(other.m_Lock, nullptr);
+					m_Bucket = other.m_Bucket;
+				}
+				return *this;
+			}
+
+			inline WriteGuard(const WriteGuard&) = delete;
+			inline auto operator=(const WriteGuard&) -> WriteGuard& = delete;
+
+			inline ~WriteGuard() {
+				if (m_Lock != nullptr) {
+					m_Lock->unlock();
+				}
+			}
+
+			inline auto key() const -> const Key& { return m_Bucket->m_Key; }
+			inline auto value() const -> Value& { return m_Bucket->m_Value; }
+
+			inline auto operator*() const -> Value& { return m_Bucket->m_Value; }
+			inline auto operator->() const -> RawPtr<Value> { return &m_Bucket->m_Value; }
+
+		private:
+			inline WriteGuard(RawPtr<internal::concurrent_map::RwWord> lock, RawPtr<internal::concurrent_map::Bucket<Key, Value>> bucket)
+				: m_Lock(lock),
+				m_Bucket(bucket)
+			{
+			}
+
+		private:
+			RawPtr<internal::concurrent_map::RwWord> m_Lock;
+			RawPtr<internal::concurrent_map::Bucket<Key, Value>> m_Bucket;
+
+			template<typename K, typename V, typename H>
+			friend class ConcurrentMap;
+		};
+
+		/*
+		* A hash map shared between threads, the equivalent of the dashmap crate. The keys are split
+		* over shards by their hash and every shard has its own reader writer lock, so threads only
+		* wait for each other when they touch the same shard at the same time, instead of all of
+		* them queueing on the one lock of a SafeVal<std::unordered_map>.
+		*
+		* get, get_mut and entry hand out guards that keep the shard of the key locked. Calling into
+		* the map for a key of the same shard while holding a guard deadlocks, like it would in Rust.
+		*/
+		template<typename Key, typename Value, typename Hasher = DefaultHasher<Key>>
+		class ConcurrentMap {
+		private:
+			using Bucket = internal::concurrent_map::Bucket<Key, Value>;
+			using Shard = internal::concurrent_map::Shard<Key, Value>;
+
+		public:
+			/*
+			* A place in the map for one key, taken by entry(). The shard of the key is write locked
+			* until the entry is dropped or turned into a WriteGuard by one of the or_insert functions.
+			*/
+			class Entry {
+			public:
+				inline Entry(Entry&& other) noexcept
+					: m_Map(other.m_Map),
+					m_Shard(std::exchange(other.m_Shard, nullptr)),
+					m_Key(std::move(other.m_Key)),
+					m_Hash(other.m_Hash),
+					m_Bucket(other.m_Bucket)
+				{
+				}
+
+				inline Entry(const Entry&) = delete;
+				inline auto operator=(const Entry&) -> Entry& = delete;
+				inline auto operator=(Entry&&) -> Entry& = delete;
+
+				inline ~Entry() {
+					if (m_Shard != nullptr) {
+						m_Shard->m_Lock.unlock();
+					}
+				}
+
+				inline bool is_occupied() const {
+					return m_Bucket != nullptr;
+				}
+
+				inline auto key() const -> const Key& {
+					return m_Bucket != nullptr ? m_Bucket->m_Key : m_Key;
+				}
+
+				/*
+				* Calls f with the value if the key is in the map.
+				*/
+				template<typename F>
+				inline auto and_modify(F f) -> Entry&& {
+					if (m_Bucket != nullptr) {
+						f(m_Bucket->m_Value);
+					}
+					return std::move(*this);
+				}
+
+				inline auto or_insert(Value value) {
+					return or_insert_with([&] { return std::move(value); });
+				}
+
+				/*
+				* The value of the key, f makes it first if the key is not in the map.
+				*/
+				template<typename F>
+				inline auto or_insert_with(F f) {
+					if (m_Bucket == nullptr) {
+						m_Bucket = m_Shard->m_Table.insert_new(m_Hash, m_Map->hash_of(), std::move(m_Key), f());
+					}
+					// the lock of the entry becomes the one of the guard
+					return WriteGuard<Key, Value>(&std::exchange(m_Shard, nullptr)->m_Lock, m_Bucket);
+				}
+
+				inline auto or_default() requires(std::default_initializable<Value>) {
+					return or_insert_with([] { return Value(); });
+				}
+
+			private:
+				inline Entry(RawPtr<const ConcurrentMap> map, RawPtr<Shard> shard, Key&& key, u64 hash, RawPtr<Bucket> bucket)
+					: m_Map(map),
+					m_Shard(shard),
+					m_Key(std::move(key)),
+					m_Hash(hash),
+					m_Bucket(bucket)
+				{
+				}
+
+			private:
+				RawPtr<const ConcurrentMap> m_Map;
+				RawPtr<Shard> m_Shard;
+				Key m_Key;
+				u64 m_Hash;
+				RawPtr<Bucket> m_Bucket;
+
+				friend class ConcurrentMap;
+			};
+
+			/*
+			* 4 shards per hardware thread, rounded up to a power of two.
+			*/
+			inline ConcurrentMap()
+				: ConcurrentMap(default_shard_count())
+			{
+			}
+
+			inline explicit ConcurrentMap(usize shards, Hasher hasher = Hasher())
+				: m_Shards(std::make_unique<Shard[]>(std::bit_ceil(std::max<usize>(shards, 1)))),
+				m_ShardMask(std::bit_ceil(std::max<usize>(shards, 1)) - 1),
+				m_Hasher(std::move(hasher))
+			{
+			}
+
+			inline ConcurrentMap(const ConcurrentMap&) = delete;
+			inline auto operator=(const ConcurrentMap&) -> ConcurrentMap& = delete;
+
+			inline usize shard_count() const {
+				return m_ShardMask + 1;
+			}
+
+			/*
+			* Inserts a key and value, the value that was there for the key is returned.
+			*/
+			inline auto insert(Key key, Value value) {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				auto lock = std::lock_guard(shard.m_Lock);
+
+				if (auto bucket = find(shard, hash, key)) {
+					return Some<Value>(std::exchange(bucket->m_Value, std::move(value)));
+				}
+
+				shard.m_Table.insert_new(hash, hash_of(), std::move(key), std::move(value));
+				return None<Value>();
+			}
+
+			inline bool contains_key(const Key& key) const {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				auto lock = std::shared_lock(shard.m_Lock);
+				return find(shard, hash, key) != nullptr;
+			}
+
+			/*
+			* Read locks the shard of key and gives a guard for its value, None if it is not in the map.
+			*/
+			inline auto get(const Key& key) const {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				shard.m_Lock.lock_shared();
+
+				auto bucket = find(shard, hash, key);
+				if (bucket == nullptr) {
+					shard.m_Lock.unlock_shared();
+					return None<ReadGuard<Key, Value>>();
+				}
+				return Some<ReadGuard<Key, Value>>(ReadGuard<Key, Value>(&shard.m_Lock, bucket));
+			}
+
+			/*
+			* Write locks the shard of key and gives a guard for its value, None if it is not in the map.
+			*/
+			inline auto get_mut(const Key& key) {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				shard.m_Lock.lock();
+
+				auto bucket = find(shard, hash, key);
+				if (bucket == nullptr) {
+					shard.m_Lock.unlock();
+					return None<WriteGuard<Key, Value>>();
+				}
+				return Some<WriteGuard<Key, Value>>(WriteGuard<Key, Value>(&shard.m_Lock, bucket));
+			}
+
+			/*
+			* Write locks the shard of key, which makes looking it up and inserting it one atomic step.
+			*/
+			inline auto entry(Key key) {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				shard.m_Lock.lock();
+
+				auto bucket = find(shard, hash, key);
+				return Entry(this, &shard, std::move(key), hash, bucket);
+			}
+
+			/*
+			* Removes key and returns its value, None if it was not in the map.
+			*/
+			inline auto remove(const Key& key) {
+				return remove_if(key, [](const Key&, const Value&) { return true; });
+			}
+
+			/*
+			* Removes key if predicate(key, value) returns true, both under the same lock.
+			*/
+			template<typename Predicate>
+			inline auto remove_if(const Key& key, Predicate&& predicate) {
+				auto hash = m_Hasher(key);
+				auto& shard = shard_of(hash);
+				auto lock = std::lock_guard(shard.m_Lock);
+
+				auto bucket = find(shard, hash, key);
+				if (bucket == nullptr || !predicate(std::as_const(bucket->m_Key), std::as_const(bucket->m_Value))) {
+					return None<Value>();
+				}
+
+				auto value = Value(std::move(bucket->m_Value));
+				shard.m_Table.erase(bucket);
+				return Some<Value>(std::move(value));
+			}
+
+			/*
+			* Keeps only the entries for which predicate(key, value) returns true. The shards are
+			* locked one after the other, so this is not a snapshot of the whole map.
+			*/
+			template<typename Predicate>
+			inline void retain(Predicate&& predicate) {
+				for (usize i = 0; i <= m_ShardMask; i++) {
+					auto& shard = m_Shards[i];
+					auto lock = std::lock_guard(shard.m_Lock);
+
+					auto ctrl = shard.m_Table.ctrl();
+					auto slots = shard.m_Table.slots();
+					for (usize j = 0; j < shard.m_Table.buckets(); j++) {
+						if (internal::hash_table::is_full(ctrl[j]) && !predicate(std::as_const(slots[j].m_Key), slots[j].m_Value)) {
+							shard.m_Table.erase(slots + j);
+						}
+					}
+				}
+			}
+
+			/*
+			* Calls f(key, value) for every entry, every shard is read locked while it is visited.
+			*/
+			template<typename F>
+			inline void for_each(F&& f) const {
+				for (usize i = 0; i <= m_ShardMask; i++) {
+					auto& shard = m_Shards[i];
+					auto lock = std::shared_lock(shard.m_Lock);
+
+					auto ctrl = shard.m_Table.ctrl();
+					auto slots = shard.m_Table.slots();
+					for (usize j = 0; j < shard.m_Table.buckets(); j++) {
+						if (internal::hash_table::is_full(ctrl[j])) {
+							f(std::as_const(slots[j].m_Key), std::as_const(slots[j].m_Value));
+						}
+					}
+				}
+			}
+
+			/*
+			* The number of entries, it can be out of date by the time it returns.
+			*/
+			inline usize len() const {
+				usize len = 0;
+				for (usize i = 0; i <= m_ShardMask; i++) {
+					auto lock = std::shared_lock(m_Shards[i].m_Lock);
+					len += m_Shards[i].m_Table.len();
+				}
+				return len;
+			}
+
+			inline bool is_empty() const {
+				return len() == 0;
+			}
+
+			inline void clear() {
+				for (usize i = 0; i <= m_ShardMask; i++) {
+					auto lock = std::lock_guard(m_Shards[i].m_Lock);
+					m_Shards[i].m_Table.clear();
+				}
+			}
+
+		private:
+			static inline usize default_shard_count() {
+				return std::bit_ceil(std::max<usize>(std::thread::hardware_concurrency(), 1) * 4);
+			}
+
+			// The table takes the low bits of the hash and its control bytes the top 7, the shard is picked from the middle
+			inline auto shard_of(u64 hash) const -> Shard& {
+				return m_Shards[static_cast<usize>(hash >> 32) & m_ShardMask];
+			}
+
+			static inline auto find(const Shard& shard, u64 hash, const Key& key) {
+				return shard.m_Table.find(hash, [&](const Bucket& bucket) { return bucket.m_Key == key; });
+			}
+
+			inline auto hash_of() const {
+				return [this](const Bucket& bucket) { return m_Hasher(bucket.m_Key); };
+			}
+
+		private:
+			std::unique_ptr<Shard[]> m_Shards;
+			usize m_ShardMask;
+			[[no_unique_address]] Hasher m_Hasher;
+		};
+	}
+
+	template<typename Key, typename Value, typename Hasher>
+	struct IsSend<sync::ConcurrentMap<Key, Value, Hasher>> : std::bool_constant<Send<Key> && Send<Value>> {};
+
+	template<typename Key, typename Value, typename Hasher>
+	struct IsSync<sync::ConcurrentMap<Key, Value, Hasher>> : std::bool_constant<Send<Key> && Send<Value> && Sync<Key> && Sync<Value>> {};
+
+	template<typename Key, typename Value>
+	struct IsSend<sync::ReadGuard<Key, Value>> : std::bool_constant<Sync<Key> && Sync<Value>> {};
+
+	template<typename Key, typename Value>
+	struct IsSend<sync::WriteGuard<Key, Value>> : std::bool_constant<Sync<Key> && Send<Value>> {};
+}
+
+// Atomically swappable values
+namespace rs {
+
+	namespace internal::hazard {
+
+		/*
+		* A hazard pointer, what one reader is looking at. Each one is on its own cache line and only
+		* written by the thread that owns it, the writers only read them. They are never freed, a
+		* thread that exits gives its records back for the next threads to reuse.
+		*/
+		struct alignas(64) Record {
+			std::atomic<RawPtr<void>> m_Ptr = nullptr;
+			std::atomic_bool m_IsActive = true;
+			RawPtr<Record> m_Next = nullptr;
+		};
+
+		struct Retired {
+			RawPtr<void> m_Ptr;
+			void (*m_Delete)(RawPtr<void>);
+		};
+
+		class Domain {
+		public:
+			static inline auto global() -> Domain& {
+				static auto domain = new Domain();
+				return *domain;
+			}
+
+			inline auto acquire() -> RawPtr<Record> {
+				for (auto record = m_Head.load(std::memory_order_acquire); record != nullptr; record = record->m_Next) {
+					auto isActive = false;
+					if (!record->m_IsActive.load(std::memory_order_relaxed) && record->m_IsActive.compare_exchange_strong(isActive, true, std::memory_order_acquire)) {
+						return record;
+					}
+				}
+
+				auto record = new Record();
+				auto head = m_Head.load(std::memory_order_relaxed);
+				do {
+					record->m_Next = head;
+				} while (!m_Head.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+				return record;
+			}
+
+			inline void release(RawPtr<Record> record) {
+				record->m_Ptr.store(nullptr, std::memory_order_release);
+				record->m_IsActive.store(false, std::memory_order_release);
+			}
+
+			/*
+			* Frees ptr once no hazard pointer points to it anymore. Everything retired so far is
+			* checked against the hazard pointers right away, so a swap frees what it can at once.
+			*/
+			inline void retire(RawPtr<void> ptr, void (*drop)(RawPtr<void>)) {
+				auto freed = std::vector<Retired>();
+				{
+					auto lock = std::lock_guard<std::mutex>(m_Mutex);
+					m_Retired.push_back(Retired{ ptr, drop });
+
+					auto hazards = std::vector<RawPtr<void>>();
+					for (auto record = m_Head.load(std::memory_order_acquire); record != nullptr; record = record->m_Next) {
+						if (auto hazard = record->m_Ptr.load(std::memory_order_seq_cst)) {
+							hazards.push_back(hazard);
+						}
+					}
+					std::sort(hazards.begin(), hazards.end());
+
+					auto kept = std::partition(m_Retired.begin(), m_Retired.end(), [&](const Retired& retired) {
+						return std::binary_search(hazards.begin(), hazards.end(), retired.m_Ptr);
+					});
+					freed.assign(kept, m_Retired.end());
+					m_Retired.erase(kept, m_Retired.end());
+				}
+
+				// Outside of the lock, the destructors might retire values themselves
+				for (auto& retired : freed) {
+					retired.m_Delete(retired.m_Ptr);
+				}
+			}
+
+		private:
+			std::atomic<RawPtr<Record>> m_Head = nullptr;
+			std::mutex m_Mutex;
+			std::vector<Retired> m_Retired;
+		};
+
+		// The records a thread holds on to, so loading a value does not touch the shared list
+		class LocalRecords {
+		public:
+			inline ~LocalRecords() {
+				for (auto record : m_Free) {
+					Domain::global().release(record);
+				}
+			}
+
+			inline auto acquire() -> RawPtr<Record> {
+				if (m_Free.empty()) {
+					return Domain::global().acquire();
+				}
+
+				auto record = m_Free.back();
+				m_Free.pop_back();
+				return record;
+			}
+
+			inline void release(RawPtr<Record> record) {
+				record->m_Ptr.store(nullptr, std::memory_order_release);
+				m_Free.push_back(record);
+			}
+
+			static inline auto current() -> LocalRecords& {
+				static thread_local LocalRecords t_Records;
+				return t_Records;
+			}
+
+		private:
+			std::vector<RawPtr<Record>> m_Free;
+		};
+	}
+
+	namespace sync {
+
+		template<typename Type>
+		class ArcSwap;
+
+		/*
+		* What an ArcSwap held when it was loaded. The value stays alive while the snapshot does,
+		* even if a new one is stored in the meantime. It pins one hazard pointer of the thread that
+		* loaded it, so it must be dropped on that thread.
+		*/
+		template<typename Type>
+		class Snapshot {
+		public:
+			inline Snapshot(Snapshot&& other) noexcept
+				: m_Record(std::exchange(other.m_Record, nullptr)),
+				m_Value(other.m_Value)
+			{
+			}
+
+			inline auto operator=(Snapshot&& other) noexcept -> Snapshot& {
+				if (this != &other) {
+					drop();
+					m_Record = std::exchange(other.m_Record, nullptr);
+					m_Value = other.m_Value;
+				}
+				return *this;
+			}
+
+			inline Snapshot(const Snapshot&) = delete;
+			inline auto operator=(const Snapshot&) -> Snapshot& = delete;
+
+			inline ~Snapshot() {
+				drop();
+			}
+
+			inline auto value() const -> const Type& { return *m_Value; }
+
+			inline auto operator*() const -> const Type& { return *m_Value; }
+			inline auto operator->() const -> const Type* { return m_Value; }
+
+		private:
+			inline Snapshot(RawPtr<internal::hazard::Record> record, const Type* value)
+				: m_Record(record),
+				m_Value(value)
+			{
+			}
+
+			inline void drop() {
+				if (m_Record != nullptr) {
+					internal::hazard::LocalRecords::current().release(std::exchange(m_Record, nullptr));
+				}
+			}
+
+		private:
+			RawPtr<internal::hazard::Record> m_Record;
+			const Type* m_Value;
+
+			friend class ArcSwap<Type>;
+		};
+
+		/*
+		* A value that is read a lot and replaced now and then, the equivalent of the arc-swap crate.
+		*
+		* Loading only writes to a hazard pointer owned by the reading thread, unlike borrowing a
+		* SafeVal there is no shared counter that every reader bumps, so reads scale with the number
+		* of threads. store and rcu publish a new value, the old one is freed once no snapshot
+		* points to it anymore.
+		*/
+		template<typename Type>
+		class ArcSwap {
+		public:
+			inline explicit ArcSwap(Type value)
+				: m_Current(new Type(std::move(value)))
+			{
+			}
+
+			inline ArcSwap(const ArcSwap&) = delete;
+			inline auto operator=(const ArcSwap&) -> ArcSwap& = delete;
+
+			// The value is retired instead of deleted, snapshots can outlive the ArcSwap
+			inline ~ArcSwap() {
+				retire(m_Current.load(std::memory_order_relaxed));
+			}
+
+			/*
+			* A snapshot of the current value.
+			*/
+			inline auto load() const {
+				auto record = internal::hazard::LocalRecords::current().acquire();
+				auto value = m_Current.load(std::memory_order_relaxed);
+				while (true) {
+					record->m_Ptr.store(value, std::memory_order_seq_cst);
+
+					// Published before the writer could have read the hazard pointers, so it is not freed
+					auto current = m_Current.load(std::memory_order_seq_cst);
+					if (current == value) {
+						return Snapshot<Type>(record, value);
+					}
+					value = current;
+				}
+			}
+
+			/*
+			* Replaces the value, the loads that come after see the new one.
+			*/
+			inline void store(Type value) {
+				retire(m_Current.exchange(new Type(std::move(value)), std::memory_order_seq_cst));
+			}
+
+			/*
+			* Replaces the value with f(current), f is called again with the newer value if another
+			* writer stored one in between, so it should not have side effects.
+			*/
+			template<typename F>
+			inline void rcu(F f) {
+				auto current = load();
+				while (true) {
+					auto next = new Type(f(*current));
+					auto expected = const_cast<RawPtr<Type>>(current.m_Value);
+					if (m_Current.compare_exchange_strong(expected, next, std::memory_order_seq_cst)) {
+						current = Snapshot<Type>(nullptr, nullptr);
+						retire(expected);
+						return;
+					}
+
+					delete next;
+					current = load();
+				}
+			}
+
+		private:
+			static inline void retire(RawPtr<Type> value) {
+				internal::hazard::Domain::global().retire(value, [](RawPtr<void> ptr) {
+					delete static_cast<RawPtr<Type>>(ptr);
+				});
+			}
+
+		private:
+			std::atomic<RawPtr<Type>> m_Current;
+		};
+	}
+
+	template<typename Type>
+	struct IsSend<sync::ArcSwap<Type>> : std::bool_constant<Send<Type> && Sync<Type>> {};
+
+	template<typename Type>
+	struct IsSync<sync::ArcSwap<Type>> : std::bool_constant<Send<Type> && Sync<Type>> {};
+
+	template<typename Type>
+	struct IsSend<sync::Snapshot<Type>> : std::false_type {};
+}
+
+// Once cells
+namespace rs {
+
+	namespace internal::once {
+		// Running becomes Queued once another thread sleeps on the state, only then is it woken
+		constexpr u32 Incomplete = 0;
+		constexpr u32 Running = 1;
+		constexpr u32 Queued = 2;
+		constexpr u32 Complete = 3;
+	}
+
+	/*
+	* A value that is initialized once and then only read, the equivalent of Rust's OnceLock.
+	*
+	* Once it is initialized reading it is a single acquire load, there is no guard variable and
+	* no call into the runtime like for a function local static. Threads that race to initialize it
+	* sleep on the state word (a futex on Linux) until the one that won is done. If the initializer
+	* throws the cell stays empty and the next caller tries again.
+	*/
+	template<typename Type>
+	class OnceCell {
+	public:
+		inline OnceCell() noexcept
+		{
+		}
+
+		inline OnceCell(const OnceCell&) = delete;
+		inline auto operator=(const OnceCell&) -> OnceCell& = delete;
+
+		inline ~OnceCell() {
+			if (m_State.load(std::memory_order_relaxed) == internal::once::Complete) {
+				std::destroy_at(&m_Value);
+			}
+		}
+
+		inline bool is_initialized() const {
+			return m_State.load(std::memory_order_acquire) == internal::once::Complete;
+		}
+
+		/*
+		* Borrows the value if it is initialized, None otherwise. It never changes again,
+		* so the reference is not counted.
+		*/
+		inline auto get() const {
+			if (!is_initialized()) {
+				return None<Ref<Type>>();
+			}
+			return Some<Ref<Type>>(Ref<Type>(&m_Value, nullptr, ValidityChecker<false>()));
+		}
+
+		/*
+		* The value, f initializes it first if no one did yet.
+		*/
+		template<typename F>
+		inline auto get_or_init(F&& f) const -> const Type& {
+			if (m_State.load(std::memory_order_acquire) == internal::once::Complete) [[likely]] {
+				return m_Value;
+			}
+
+			initialize([&] { return Type(f()); });
+			return m_Value;
+		}
+
+		/*
+		* Like get_or_init for an f that returns a Result, its Err is returned and the cell
+		* stays empty.
+		*/
+		template<typename F>
+		inline auto get_or_try_init(F&& f) const {
+			using Traits = internal::iter::result_traits<std::invoke_result_t<F&>>;
+			using Error = typename Traits::ErrorType;
+
+			if (!is_initialized()) {
+				auto error = std::optional<Error>();
+				initialize([&]() -> std::optional<Type> {
+					auto result = f();
+					if (Traits::is_err(result)) {
+						error.emplace(Traits::take_err(result));
+						return std::nullopt;
+					}
+					return Traits::take_ok(result);
+				});
+
+				if (error) {
+					return Err<Ref<Type>, Error>(std::move(*error));
+				}
+			}
+			return Ok<Ref<Type>, Error>(Ref<Type>(&m_Value, nullptr, ValidityChecker<false>()));
+		}
+
+		/*
+		* Stores value if the cell is empty, returns false if it was already initialized.
+		*/
+		inline bool set(Type value) {
+			auto isSet = false;
+			initialize([&] {
+				isSet = true;
+				return std::move(value);
+			});
+			return isSet;
+		}
+
+	private:
+		// make gives the value, or an empty optional to leave the cell empty without throwing
+		template<typename F>
+		inline void initialize(F&& make) const {
+			auto state = m_State.load(std::memory_order_acquire);
+			while (state != internal::once::Complete) {
+				if (state == internal::once::Incomplete) {
+					if (!m_State.compare_exchange_weak(state, internal::once::Running, std::memory_order_acquire, std::memory_order_acquire)) {
+						continue;
+					}
+
+					auto isComplete = false;
+					try {
+						isComplete = construct(make());
+					}
+					catch (...) {
+						finish(internal::once::Incomplete);
+						throw;
+					}
+
+					finish(isComplete ? internal::once::Complete : internal::once::Incomplete);
+					return;
+				}
+
+				if (state == internal::once::Running && !m_State.compare_exchange_weak(state, internal::once::Queued, std::memory_order_acquire, std::memory_order_acquire)) {
+					continue;
+				}
+
+				m_State.wait(internal::once::Queued, std::memory_order_acquire);
+				state = m_State.load(std::memory_order_acquire);
+			}
+		}
+
+		inline bool construct(Type&& value) const {
+			std::construct_at(&m_Value, std::move(value));
+			return true;
+		}
+
+		inline bool construct(std::optional<Type>&& value) const {
+			if (!value) {
+				return false;
+			}
+			std::construct_at(&m_Value, std::move(*value));
+			return true;
+		}
+
+		inline void finish(u32 state) const {
+			if (m_State.exchange(state, std::memory_order_release) == internal::once::Queued) {
+				m_State.notify_all();
+			}
+		}
+
+	private:
+		mutable std::atomic<u32> m_State = internal::once::Incomplete;
+		union {
+			mutable Type m_Value;
+		};
+	};
+
+	/*
+	* A value that is initialized by F the first time it is used, the equivalent of Rust's LazyLock.
+	* A global one replaces a function local static without its guard check on every call.
+	*/
+	template<typename Type, typename F = std::function<Type()>>
+	class LazyLock {
+	public:
+		inline explicit LazyLock(F f)
+			: m_Init(std::move(f))
+		{
+		}
+
+		inline LazyLock(const LazyLock&) = delete;
+		inline auto operator=(const LazyLock&) -> LazyLock& = delete;
+
+		/*
+		* The value, it is initialized first if this is the first use.
+		*/
+		inline auto force() const -> const Type& {
+			return m_Cell.get_or_init(m_Init);
+		}
+
+		inline auto operator*() const -> const Type& { return force(); }
+		inline auto operator->() const -> const Type* { return &force(); }
+
+		inline bool is_initialized() const {
+			return m_Cell.is_initialized();
+		}
+
+	private:
+		OnceCell<Type> m_Cell;
+		F m_Init;
+	};
+
+	template<typename Type>
+	struct IsSend<OnceCell<Type>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type>
+	struct IsSync<OnceCell<Type>> : std::bool_constant<Send<Type> && Sync<Type>> {};
+
+	template<typename Type, typename F>
+	struct IsSend<LazyLock<Type, F>> : std::bool_constant<Send<Type> && Send<F>> {};
+
+	template<typename Type, typename F>
+	struct IsSync<LazyLock<Type, F>> : std::bool_constant<Send<Type> && Sync<Type> && Send<F>> {};
+}
+
+// Cells
+namespace rs {
+
+	/*
+	* A value that can be changed through a const reference, the equivalent of Rust's Cell.
+	* The value is only ever copied in and out, nothing borrows it, so there is nothing to check
+	* and it takes exactly the space of the value.
+	*/
+	template<typename Type>
+	class Cell {
+	public:
+		static_assert(std::is_trivially_copyable_v<Type>, "A Cell can only hold trivially copyable types, use a RefCell");
+
+		inline Cell() requires(std::default_initializable<Type>)
+			: m_Value()
+		{
+		}
+
+		inline explicit Cell(Type value)
+			: m_Value(value)
+		{
+		}
+
+		inline Cell(const Cell& other)
+			: m_Value(other.get())
+		{
+		}
+
+		inline auto operator=(const Cell& other) -> Cell& {
+			set(other.get());
+			return *this;
+		}
+
+		inline auto get() const -> Type {
+			return m_Value;
+		}
+
+		inline void set(Type value) const {
+			m_Value = value;
+		}
+
+		/*
+		* Stores value and returns the one that was there.
+		*/
+		inline auto replace(Type value) const -> Type {
+			return std::exchange(m_Value, value);
+		}
+
+		/*
+		* Returns the value and leaves the default one in its place.
+		*/
+		inline auto take() const -> Type requires(std::default_initializable<Type>) {
+			return replace(Type());
+		}
+
+		inline void swap(const Cell& other) const {
+			std::swap(m_Value, other.m_Value);
+		}
+
+	private:
+		mutable Type m_Value;
+	};
+
+	/*
+	* A value that is borrowed through a const reference with the rules checked at runtime,
+	* the equivalent of Rust's RefCell.
+	*
+	* This is the borrow checking of Val without the ownership: the counters sit right next to the
+	* value instead of in a heap allocated ValidityCheckBlock, so a RefCell takes the space of the
+	* value and a u32 and is meant to be a member of whatever needs interior mutability.
+	* Nothing checks that the cell outlives the Ref and RefMut it hands out, it must not be
+	* destroyed or moved while they are alive.
+	*/
+	template<typename Type>
+	class RefCell {
+	public:
+		inline RefCell() requires(std::default_initializable<Type>)
+			: m_Value()
+		{
+		}
+
+		inline explicit RefCell(Type value)
+			: m_Value(std::move(value))
+		{
+		}
+
+		inline RefCell(RefCell&& other)
+			: m_Value((other.check_not_borrowed(), std::move(other.m_Value)))
+		{
+		}
+
+		inline auto operator=(RefCell&& other) -> RefCell& {
+			if (this != &other) {
+				check_not_borrowed();
+				other.check_not_borrowed();
+				m_Value = std::move(other.m_Value);
+			}
+			return *this;
+		}
+
+		inline RefCell(const RefCell&) = delete;
+		inline auto operator=(const RefCell&) -> RefCell& = delete;
+
+		inline u32 num_borrows() const {
+			return is_mutable_borrowed() ? 0 : m_BorrowState;
+		}
+
+		inline bool is_mutable_borrowed() const {
+			return (m_BorrowState & internal::MutableBorrow) != 0;
+		}
+
+		/*
+		* Borrows the value immutably, throws if it is borrowed mutably.
+		*/
+		inline auto borrow() const {
+			if (is_mutable_borrowed()) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			m_BorrowState += 1;
+			return Ref<Type>(&m_Value, &m_BorrowState, ValidityChecker<false>());
+		}
+
+		/*
+		* Borrows the value mutably, throws if it is borrowed at all.
+		*/
+		inline auto borrow_mut() const {
+			if (is_mutable_borrowed()) {
+				throw AlreadyBorrowedMutablyException();
+			}
+
+			if (m_BorrowState > 0) {
+				throw AlreadyBorrowedImmutablyException();
+			}
+
+			m_BorrowState = internal::MutableBorrow;
+			return RefMut<Type>(&m_Value, &m_BorrowState, ValidityChecker<false>());
+		}
+
+		/*
+		* Borrows the value immutably, None instead of throwing if it is borrowed mutably.
+		*/
+		inline auto try_borrow() const {
+			if (is_mutable_borrowed()) {
+				return None<Ref<Type>>();
+			}
+			return Some<Ref<Type>>(borrow());
+		}
+
+		/*
+		* Borrows the value mutably, None instead of throwing if it is borrowed at all.
+		*/
+		inline auto try_borrow_mut() const {
+			if (m_BorrowState != 0) {
+				return None<RefMut<Type>>();
+			}
+			return Some<RefMut<Type>>(borrow_mut());
+		}
+
+		/*
+		* Stores value and returns the one that was there, throws if it is borrowed.
+		*/
+		inline auto replace(Type value) const -> Type {
+			check_not_borrowed();
+			return std::exchange(m_Value, std::move(value));
+		}
+
+		/*
+		* Moves the value out, the cell must not be used afterwards.
+		*/
+		inline auto into_inner() -> Type {
+			check_not_borrowed();
+			return std::move(m_Value);
+		}
+
+	private:
+		inline void check_not_borrowed() const {
+			if (m_BorrowState != 0) {
+				if (is_mutable_borrowed()) {
+					throw StillBorrowedMutablyException();
+				}
+				throw StillBorrowedImmutablyException();
+			}
+		}
+
+	private:
+		// The number of immutable borrows, or internal::MutableBorrow while it is borrowed mutably
+		mutable u32 m_BorrowState = 0;
+		mutable Type m_Value;
+	};
+
+	static_assert(sizeof(Cell<u64>) == sizeof(u64));
+	static_assert(sizeof(RefCell<u64>) == sizeof(std::pair<u32, u64>));
+
+	// Both only check their borrows on one thread
+	template<typename Type>
+	struct IsSync<Cell<Type>> : std::false_type {};
+
+	template<typename Type>
+	struct IsSend<RefCell<Type>> : std::bool_constant<Send<Type>> {};
+
+	template<typename Type>
+	struct IsSync<RefCell<Type>> : std::false_type {};
+}
+
+// Copy on write
+namespace rs {
+
+	/*
+	* Either a borrow of a value or an owned one, the equivalent of Rust's Cow. Reading goes
+	* through to whichever it holds, the borrowed value is only cloned the first time to_mut()
+	* is called, so a function that usually hands back its input unchanged does not copy it.
+	*/
+	template<typename Type>
+	class Cow {
+	public:
+		inline Cow(Ref<Type>&& borrowed)
+			: m_Value(std::in_place_index<0>, std::move(borrowed))
+		{
+		}
+
+		// What Val::borrow() and Option<Ref<Type>>::unwrap() return
+		inline Cow(ValRaw<Ref<Type>, false>&& borrowed)
+			: m_Value(std::in_place_index<0>, borrowed.take_value())
+		{
+		}
+
+		inline Cow(Val<Type>&& owned)
+			: m_Value(std::in_place_index<1>, std::move(owned))
+		{
+		}
+
+		inline Cow(Cow&& other) noexcept = default;
+		inline auto operator=(Cow&& other) noexcept -> Cow& = default;
+
+		inline Cow(const Cow&) = delete;
+		inline auto operator=(const Cow&) -> Cow& = delete;
+
+		inline bool is_borrowed() const {
+			return m_Value.index() == 0;
+		}
+
+		inline bool is_owned() const {
+			return m_Value.index() == 1;
+		}
+
+		inline bool is_valid() const {
+			return is_borrowed() ? std::get<0>(m_Value).is_valid() : std::get<1>(m_Value).is_valid();
+		}
+
+		inline auto value() const -> const Type* {
+			return is_borrowed() ? std::get<0>(m_Value).value() : std::get<1>(m_Value).value();
+		}
+
+		inline auto operator->() const -> const Type* { return value(); }
+		inline auto operator*() const -> const Type& { return *value(); }
+
+		/*
+		* The owned value, the borrowed one is cloned into it first and the borrow released.
+		*/
+		inline auto to_mut() -> Type& {
+			if (is_borrowed()) {
+				auto owned = Val<Type>(Type(*std::get<0>(m_Value)));
+				m_Value.template emplace<1>(std::move(owned));
+			}
+			return *std::get<1>(m_Value);
+		}
+
+		/*
+		* Moves the owned value out or clones the borrowed one, the Cow is left empty.
+		*/
+		inline auto into_owned() -> Val<Type> {
+			if (is_borrowed()) {
+				auto owned = Val<Type>(Type(*std::get<0>(m_Value)));
+				std::get<0>(m_Value).drop();
+				return owned;
+			}
+			return std::move(std::get<1>(m_Value));
+		}
+
+	private:
+		std::variant<Ref<Type>, Val<Type>> m_Value;
+	};
+
+	template<typename Type>
+	struct IsSend<Cow<Type>> : std::false_type {};
+
+	template<typename Type>
+	struct IsSync<Cow<Type>> : std::false_type {};
+}
+
+// Boxes
+namespace rs {
+
+	/*
+	* Storage for a Type that is not constructed yet, what Box::new_uninit hands out to be filled
+	* in place. Nothing is constructed or destroyed by it.
+	*/
+	template<typename Type>
+	union MaybeUninit {
+		inline MaybeUninit() {}
+		inline ~MaybeUninit() {}
+
+		Type m_Value;
+	};
+
+	namespace internal::boxed {
+		template<typename Type>
+		struct maybe_uninit_traits : std::false_type {};
+
+		template<typename Type>
+		struct maybe_uninit_traits<MaybeUninit<Type>> : std::true_type {
+			using Inner = Type;
+		};
+
+		template<typename Type>
+		concept IsMaybeUninit = maybe_uninit_traits<Type>::value;
+
+		// Every box allocates like this, so a MaybeUninit box can become a Type one
+		template<typename Type>
+		inline auto allocate(usize len) -> RawPtr<Type> {
+			if (len > std::numeric_limits<usize>::max() / sizeof(Type)) {
+				throw std::length_error("Box capacity overflow");
+			}
+			return static_cast<RawPtr<Type>>(::operator new(sizeof(Type) * len, std::align_val_t(alignof(Type))));
+		}
+
+		template<typename Type>
+		inline void deallocate(RawPtr<Type> ptr, usize len) {
+			::operator delete(ptr, sizeof(Type) * len, std::align_val_t(alignof(Type)));
+		}
+	}
+
+	/*
+	* A unique owner of a heap allocated value, the equivalent of Rust's Box. It is one pointer and
+	* nothing else: no ValidityCheckBlock and no borrow counters, use a Val if the
+	* value has to be borrowed with checks. A moved from Box is null and throws like a moved Val.
+	*/
+	template<typename Type>
+	class Box {
+	public:
+		/*
+		* Allocates the value and constructs it from args.
+		*/
+		template<typename... Args>
+		static inline auto make(Args&&... args) {
+			auto ptr = internal::boxed::allocate<Type>(1);
+			try {
+				std::construct_at(ptr, std::forward<Args>(args)...);
+			}
+			catch (...) {
+				internal::boxed::deallocate(ptr, 1);
+				throw;
+			}
+			return Box(ptr);
+		}
+
+		/*
+		* Allocates the memory for a value that is constructed later through as_mut_ptr(),
+		* assume_init() turns it into a Box<Type> once it is.
+		*/
+		static inline auto new_uninit() {
+			return Box<MaybeUninit<Type>>(internal::boxed::allocate<MaybeUninit<Type>>(1));
+		}
+
+		/*
+		* Takes ownership of a pointer that came out of into_raw().
+		*/
+		static inline auto from_raw(RawPtr<Type> ptr) {
+			return Box(ptr);
+		}
+
+		inline explicit Box(Type value)
+			: Box(make(std::move(value)))
+		{
+		}
+
+		inline Box(Box&& other) noexcept
+			: m_Ptr(std::exchange(other.m_Ptr, nullptr))
+		{
+		}
+
+		inline auto operator=(Box&& other) noexcept -> Box& {
+			if (this != &other) {
+				drop();
+				m_Ptr = std::exchange(other.m_Ptr, nullptr);
+			}
+			return *this;
+		}
+
+		inline Box(const Box&) = delete;
+		inline auto operator=(const Box&) -> Box& = delete;
+
+		inline ~Box() {
+			drop();
+		}
+
+		inline void drop() {
+			if (m_Ptr != nullptr) {
+				std::destroy_at(m_Ptr);
+				internal::boxed::deallocate(std::exchange(m_Ptr, nullptr), 1);
+			}
+		}
+
+		inline bool is_valid() const {
+			return m_Ptr != nullptr;
+		}
+
+		inline operator bool() const {
+			return is_valid();
+		}
+
+		inline auto value() const -> RawPtr<Type> {
+			if (m_Ptr == nullptr) {
+				throw ValValueMovedException();
+			}
+			return m_Ptr;
+		}
+
+		inline auto operator->() const { return value(); }
+		inline auto operator*() const -> Type& { return *value(); }
+
+		inline auto clone() const requires(std::copy_constructible<Type>) {
+			return make(*value());
+		}
+
+		/*
+		* Gives up ownership, from_raw() takes it back.
+		*/
+		inline auto into_raw() -> RawPtr<Type> {
+			return std::exchange(m_Ptr, nullptr);
+		}
+
+		/*
+		* Gives up ownership for good, the value lives until the end of the program.
+		*/
+		inline auto leak() -> Type& {
+			return *std::exchange(m_Ptr, nullptr);
+		}
+
+		inline auto as_mut_ptr() const requires(internal::boxed::IsMaybeUninit<Type>) {
+			return &value()->m_Value;
+		}
+
+		/*
+		* The value has to be constructed at as_mut_ptr() before this is called.
+		*/
+		inline auto assume_init() requires(internal::boxed::IsMaybeUninit<Type>) {
+			using Inner = typename internal::boxed::maybe_uninit_traits<Type>::Inner;
+			return Box<Inner>::from_raw(&std::exchange(m_Ptr, nullptr)->m_Value);
+		}
+
+	private:
+		inline explicit Box(RawPtr<Type> ptr)
+			: m_Ptr(ptr)
+		{
+		}
+
+	private:
+		RawPtr<Type> m_Ptr = nullptr;
+
+		template<typename Ty>
+		friend class Box;
+	};
+
+	/*
+	* A unique owner of a heap allocated array of a length fixed when it is made. The elements are
+	* allocated at once and exactly, there is no capacity like in a Vec, so it is a pointer and a length.
+	*/
+	template<typename Type>
+	class Box<Type[]> {
+	public:
+		/*
+		* Allocates len value initialized elements.
+		*/
+		static inline auto make(usize len) requires(std::default_initializable<Type>) {
+			auto ptr = internal::boxed::allocate<Type>(len);
+			try {
+				std::uninitialized_value_construct_n(ptr, len);
+			}
+			catch (...) {
+				internal::boxed::deallocate(ptr, len);
+				throw;
+			}
+			return Box(ptr, len);
+		}
+
+		/*
+		* Allocates the memory for len elements that are constructed later through as_mut_ptr(),
+		* assume_init() turns it into a Box<Type[]> once all of them are.
+		*/
+		static inline auto new_uninit(usize len) {
+			return Box<MaybeUninit<Type>[]>(internal::boxed::allocate<MaybeUninit<Type>>(len), len);
+		}
+
+		static inline auto from_raw(RawPtr<Type> ptr, usize len) {
+			return Box(ptr, len);
+		}
+
+		inline Box(std::initializer_list<Type> values)
+			: Box(internal::boxed::allocate<Type>(values.size()), values.size())
+		{
+			try {
+				std::uninitialized_copy(values.begin(), values.end(), m_Ptr);
+			}
+			catch (...) {
+				internal::boxed::deallocate(std::exchange(m_Ptr, nullptr), m_Len);
+				throw;
+			}
+		}
+
+		inline Box(Box&& other) noexcept
+			: m_Ptr(std::exchange(other.m_Ptr, nullptr)),
+			m_Len(std::exchange(other.m_Len, 0))
+		{
+		}
+
+		inline auto operator=(Box&& other) noexcept -> Box& {
+			if (this != &other) {
+				drop();
+				m_Ptr = std::exchange(other.m_Ptr, nullptr);
+				m_Len = std::exchange(other.m_Len, 0);
+			}
+			return *this;
+		}
+
+		inline Box(const Box&) = delete;
+		inline auto operator=(const Box&) -> Box& = delete;
+
+		inline ~Box() {
+			drop();
+		}
+
+		inline void drop() {
+			if (m_Ptr != nullptr) {
+				std::destroy_n(m_Ptr, m_Len);
+				internal::boxed::deallocate(std::exchange(m_Ptr, nullptr), m_Len);
+				m_Len = 0;
+			}
+		}
+
+		inline bool is_valid() const {
+			return m_Ptr != nullptr;
+		}
+
+		inline usize len() const { return m_Len; }
+		inline bool is_empty() const { return m_Len == 0; }
+
+		inline auto operator[](usize index) const -> Type& {
+			if (index >= m_Len) {
+				throw IndexOutOfBoundsException();
+			}
+			return m_Ptr[index];
+		}
+
+		inline auto begin() const { return m_Ptr; }
+		inline auto end() const { return m_Ptr + m_Len; }
+
+		inline auto as_ptr() const -> const Type* { return m_Ptr; }
+
+		inline auto as_mut_ptr() const requires(!internal::boxed::IsMaybeUninit<Type>) {
+			return m_Ptr;
+		}
+
+		inline auto as_mut_ptr() const requires(internal::boxed::IsMaybeUninit<Type>) {
+			return &m_Ptr->m_Value;
+		}
+
+		/*
+		* The elements as a slice, it is not checked against the box being dropped.
+		*/
+		inline auto as_slice() const requires(!internal::boxed::IsMaybeUninit<Type>) {
+			return Slice<Type>::from_raw_parts(m_Ptr, m_Len);
+		}
+
+		inline auto as_mut_slice() requires(!internal::boxed::IsMaybeUninit<Type>) {
+			return SliceMut<Type>::from_raw_parts(m_Ptr, m_Len);
+		}
+
+		inline auto into_raw() -> std::pair<RawPtr<Type>, usize> {
+			return std::pair(std::exchange(m_Ptr, nullptr), std::exchange(m_Len, 0));
+		}
+
+		inline auto leak() -> std::span<Type> {
+			return std::span<Type>(std::exchange(m_Ptr, nullptr), std::exchange(m_Len, 0));
+		}
+
+		/*
+		* All the elements have to be constructed at as_mut_ptr() before this is called.
+		*/
+		inline auto assume_init() requires(internal::boxed::IsMaybeUninit<Type>) {
+			using Inner = typename internal::boxed::maybe_uninit_traits<Type>::Inner;
+			auto len = std::exchange(m_Len, 0);
+			return Box<Inner[]>::from_raw(&std::exchange(m_Ptr, nullptr)->m_Value, len);
+		}
+
+	private:
+		inline Box(RawPtr<Type> ptr, usize len)
+			: m_Ptr(ptr),
+			m_Len(len)
+		{
+		}
+
+	private:
+		RawPtr<Type> m_Ptr = nullptr;
+		usize m_Len = 0;
+
+		template<typename Ty>
+		friend class Box;
+	};
+
+	static_assert(sizeof(Box<u64>) == sizeof(RawPtr<u64>));
+	static_assert(sizeof(Box<u64[]>) == sizeof(RawPtr<u64>) + sizeof(usize));
+
+	template<typename Type>
+	struct IsSend<Box<Type>> : std::bool_constant<Send<std::remove_extent_t<Type>>> {};
+
+	template<typename Type>
+	struct IsSync<Box<Type>> : std::bool_constant<Sync<std::remove_extent_t<Type>>> {};
+}
+
+// Enums
+namespace rs {
+
+	namespace internal::enums {
+		// The tag of an Enum, one byte for up to 256 variants
+		template<usize Count>
+		using TagType = std::conditional_t<(Count <= usize(std::numeric_limits<u8>::max()) + 1), u8, u16>;
+
+		template<typename Type, typename... Variants>
+		constexpr usize count_of = (usize(std::is_same_v<Type, Variants>) + ... + 0);
+
+		template<typename Type, typename... Variants>
+		concept IsVariantOf = count_of<Type, Variants...> == 1;
+
+		template<typename Type, typename First, typename... Rest>
+		constexpr usize index_of() {
+			if constexpr (std::is_same_v<Type, First>) {
+				return 0;
+			}
+			else {
+				return 1 + index_of<Type, Rest...>();
+			}
+		}
+
+		template<usize Index, typename... Variants>
+		using nth = std::tuple_element_t<Index, std::tuple<Variants...>>;
+
+		template<typename... Variants>
+		constexpr bool IsTriviallyCopyable = (std::is_trivially_copyable_v<Variants> && ...);
+
+		template<typename... Variants>
+		constexpr bool IsTriviallyDestructible = (std::is_trivially_destructible_v<Variants> && ...);
+
+		template<typename... Variants>
+		constexpr bool IsCopyable = (std::copy_constructible<Variants> && ...);
+
+		// The arms of a match as one overload set, overload resolution picks the arm of each variant
+		template<typename... Arms>
+		struct Overloaded : Arms... {
+			using Arms::operator()...;
+		};
+
+		[[noreturn]] RS_ALWAYS_INLINE void unreachable() {
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_unreachable();
+#elif defined(_MSC_VER)
+			__assume(false);
+#else
+			std::abort();
+#endif
+		}
+
+#define rs__enum_case(i) \
+			case i: \
+				if constexpr (Base + i < Count) { return visit(std::integral_constant<usize, Base + i>()); } \
+				else { break; }
+
+#define rs__enum_cases(i) \
+			rs__enum_case(i) rs__enum_case(i + 1) rs__enum_case(i + 2) rs__enum_case(i + 3) \
+			rs__enum_case(i + 4) rs__enum_case(i + 5) rs__enum_case(i + 6) rs__enum_case(i + 7)
+
+		/*
+		* Calls visit with the tag as a compile time constant. It is a switch over 64 tags at a time
+		* that the compiler turns into one jump table with the arms inlined into it, there is no table
+		* of function pointers to call through like the one std::visit builds. Chaining smaller
+		* switches would cost one more unpredictable jump per 16 variants.
+		*/
+		template<typename Result, usize Count, usize Base = 0, typename Visit>
+		RS_ALWAYS_INLINE auto dispatch(usize tag, Visit& visit) -> Result {
+			switch (tag - Base) {
+				rs__enum_cases(0) rs__enum_cases(8) rs__enum_cases(16) rs__enum_cases(24)
+				rs__enum_cases(32) rs__enum_cases(40) rs__enum_cases(48) rs__enum_cases(56)
+				default: break;
+			}
+
+			if constexpr (Base + 64 < Count) {
+				return dispatch<Result, Count, Base + 64>(tag, visit);
+			}
+			else {
+				unreachable();
+			}
+		}
+
+#undef rs__enum_cases
+#undef rs__enum_case
+
+		// Args is what the arm of each variant is called with, get gives it for a tag
+		template<typename... Args, typename Get, typename... Arms>
+		inline auto match(usize tag, Get&& get, Arms&&... arms) {
+			using Set = Overloaded<std::decay_t<Arms>...>;
+			static_assert((std::invocable<Set&, Args> && ...), "The match is not exhaustive, there is no arm for one of the variants");
+
+			using Result = std::common_type_t<std::invoke_result_t<Set&, Args>...>;
+			auto set = Set{ std::forward<Arms>(arms)... };
+			auto visit = [&](auto index) -> Result {
+				return set(get(index));
+			};
+			return dispatch<Result, sizeof...(Args)>(tag, visit);
+		}
+	}
+
+	/*
+	* A value that is one of Variants, the equivalent of a Rust enum with data. It is the storage of
+	* the largest variant and a one byte tag, and it is taken apart with match:
+	*
+	* auto size = match(message,
+	*     [](Ping&) { return 0; },
+	*     [](Data& data) { return data.len; },
+	*     [](auto&) { return -1; });
+	*
+	* A variant has to be nothrow move constructible, so assigning never leaves an Enum without one.
+	*/
+	template<typename... Variants>
+	class Enum {
+	public:
+		static_assert(sizeof...(Variants) > 0, "An Enum needs at least one variant");
+		static_assert(((internal::enums::count_of<Variants, Variants...> == 1) && ...), "The variants of an Enum must be distinct types");
+		static_assert((std::is_object_v<Variants> && ...), "The variants of an Enum must be object types");
+		static_assert((std::is_nothrow_move_constructible_v<Variants> && ...), "The variants of an Enum must be nothrow move constructible");
+
+		using Tag = internal::enums::TagType<sizeof...(Variants)>;
+
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<std::remove_cvref_t<Variant>, Variants...>)
+		inline Enum(Variant&& value)
+			: Enum(std::in_place_index<internal::enums::index_of<std::remove_cvref_t<Variant>, Variants...>()>, std::forward<Variant>(value))
+		{
+		}
+
+		template<usize Index, typename... Args>
+		inline explicit Enum(std::in_place_index_t<Index>, Args&&... args)
+			: m_Tag(static_cast<Tag>(Index))
+		{
+			std::construct_at(ptr<Index>(), std::forward<Args>(args)...);
+		}
+
+		/*
+		* Constructs the variant in place from args.
+		*/
+		template<typename Variant, typename... Args>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		static inline auto make(Args&&... args) {
+			return Enum(std::in_place_index<internal::enums::index_of<Variant, Variants...>()>, std::forward<Args>(args)...);
+		}
+
+		// An Enum of trivially copyable variants is copied like the bytes it is
+		inline Enum(const Enum& other) requires(internal::enums::IsTriviallyCopyable<Variants...>) = default;
+		inline Enum(Enum&& other) requires(internal::enums::IsTriviallyCopyable<Variants...>) = default;
+		inline auto operator=(const Enum& other) -> Enum& requires(internal::enums::IsTriviallyCopyable<Variants...>) = default;
+		inline auto operator=(Enum&& other) -> Enum& requires(internal::enums::IsTriviallyCopyable<Variants...>) = default;
+
+		inline Enum(const Enum& other) requires(!internal::enums::IsTriviallyCopyable<Variants...> && internal::enums::IsCopyable<Variants...>)
+			: m_Tag(other.m_Tag)
+		{
+			visit_tag([&](auto index) {
+				std::construct_at(ptr<index>(), *other.template ptr<index>());
+			});
+		}
+
+		inline Enum(Enum&& other) noexcept requires(!internal::enums::IsTriviallyCopyable<Variants...>)
+			: m_Tag(other.m_Tag)
+		{
+			visit_tag([&](auto index) {
+				std::construct_at(ptr<index>(), std::move(*other.template ptr<index>()));
+			});
+		}
+
+		inline auto operator=(const Enum& other) -> Enum& requires(!internal::enums::IsTriviallyCopyable<Variants...> && internal::enums::IsCopyable<Variants...>) {
+			if (this != &other) {
+				*this = Enum(other);
+			}
+			return *this;
+		}
+
+		inline auto operator=(Enum&& other) noexcept -> Enum& requires(!internal::enums::IsTriviallyCopyable<Variants...>) {
+			if (this != &other) {
+				destroy();
+				m_Tag = other.m_Tag;
+				visit_tag([&](auto index) {
+					std::construct_at(ptr<index>(), std::move(*other.template ptr<index>()));
+				});
+			}
+			return *this;
+		}
+
+		inline ~Enum() requires(internal::enums::IsTriviallyDestructible<Variants...>) = default;
+
+		inline ~Enum() requires(!internal::enums::IsTriviallyDestructible<Variants...>) {
+			destroy();
+		}
+
+		/*
+		* The position of the current variant in Variants.
+		*/
+		inline usize index() const {
+			return m_Tag;
+		}
+
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		inline bool is() const {
+			return m_Tag == internal::enums::index_of<Variant, Variants...>();
+		}
+
+		/*
+		* Borrows the variant if it is the current one, None otherwise. The reference is not
+		* checked against the Enum being assigned or destroyed.
+		*/
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		inline auto get() const {
+			if (!is<Variant>()) {
+				return None<Ref<Variant>>();
+			}
+			return Some<Ref<Variant>>(Ref<Variant>(&get_unchecked<Variant>(), nullptr, ValidityChecker<false>()));
+		}
+
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		inline auto get_mut() {
+			if (!is<Variant>()) {
+				return None<RefMut<Variant>>();
+			}
+			return Some<RefMut<Variant>>(RefMut<Variant>(&get_unchecked<Variant>(), nullptr, ValidityChecker<false>()));
+		}
+
+		/*
+		* Returns the variant without checking that it is the current one.
+		*/
+		template<usize Index>
+		inline auto get_unchecked() -> internal::enums::nth<Index, Variants...>& {
+			return *ptr<Index>();
+		}
+
+		template<usize Index>
+		inline auto get_unchecked() const -> const internal::enums::nth<Index, Variants...>& {
+			return *ptr<Index>();
+		}
+
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		inline auto get_unchecked() -> Variant& {
+			return *ptr<internal::enums::index_of<Variant, Variants...>()>();
+		}
+
+		template<typename Variant>
+			requires(internal::enums::IsVariantOf<Variant, Variants...>)
+		inline auto get_unchecked() const -> const Variant& {
+			return *ptr<internal::enums::index_of<Variant, Variants...>()>();
+		}
+
+	private:
+		template<usize Index>
+		inline auto ptr() const {
+			return std::launder(reinterpret_cast<RawPtr<internal::enums::nth<Index, Variants...>>>(const_cast<RawPtr<std::byte>>(m_Storage)));
+		}
+
+		template<typename F>
+		inline void visit_tag(F&& f) const {
+			internal::enums::dispatch<void, sizeof...(Variants)>(m_Tag, f);
+		}
+
+		inline void destroy() {
+			if constexpr (!internal::enums::IsTriviallyDestructible<Variants...>) {
+				visit_tag([&](auto index) {
+					std::destroy_at(ptr<index>());
+				});
+			}
+		}
+
+	private:
+		alignas(Variants...) std::byte m_Storage[std::max({ sizeof(Variants)... })];
+		Tag m_Tag;
+	};
+
+	/*
+	* Calls the arm that takes the current variant of value, the arms are usually lambdas and a
+	* generic one ([](auto&) { ... }) catches the variants without their own, like _ in Rust.
+	* Every variant needs an arm, the call does not compile otherwise.
+	*/
+	template<typename... Variants, typename... Arms>
+	inline auto match(Enum<Variants...>& value, Arms&&... arms) {
+		return internal::enums::match<Variants&...>(value.index(), [&](auto index) -> auto& {
+			return value.template get_unchecked<index>();
+		}, std::forward<Arms>(arms)...);
+	}
+
+	template<typename... Variants, typename... Arms>
+	inline auto match(const Enum<Variants...>& value, Arms&&... arms) {
+		return internal::enums::match<const Variants&...>(value.index(), [&](auto index) -> auto& {
+			return value.template get_unchecked<index>();
+		}, std::forward<Arms>(arms)...);
+	}
+
+	/*
+	* Matches a borrowed Enum, the arm gets the borrow of the variant (a Ref or RefMut of it) that
+	* keeps the borrow of the Enum alive, like matching on &value or &mut value in Rust.
+	*/
+	template<typename... Variants, bool Mutability, bool ThreadSafe, typename... Arms>
+	inline auto match(RefRaw<Enum<Variants...>, Mutability, ThreadSafe>&& value, Arms&&... arms) {
+		auto tag = value->index();
+		return internal::enums::match<RefRaw<Variants, Mutability, ThreadSafe>...>(tag, [&](auto index) {
+			return value.map([](auto& inner) -> auto& {
+				return inner.template get_unchecked<decltype(index)::value>();
+			});
+		}, std::forward<Arms>(arms)...);
+	}
+
+	// What Val::borrow() and Val::borrow_mut() return
+	template<typename... Variants, bool Mutability, bool ThreadSafe, typename... Arms>
+	inline auto match(ValRaw<RefRaw<Enum<Variants...>, Mutability, ThreadSafe>, ThreadSafe>&& borrowed, Arms&&... arms) {
+		return match(std::move(*borrowed.raw()), std::forward<Arms>(arms)...);
+	}
+
+	template<typename... Variants>
+	struct IsSend<Enum<Variants...>> : std::bool_constant<(Send<Variants> && ...)> {};
+
+	template<typename... Variants>
+	struct IsSync<Enum<Variants...>> : std::bool_constant<(Sync<Variants> && ...)> {};
+}
+
+// Thread pool
+namespace rs {
+
+	namespace internal::pool {
+
+		/*
+		* A unit of work for the pool. Jobs live on the stack of whoever waits for them,
+		* so nothing is allocated per job.
+		*/
+		class Job {
+		public:
+			inline explicit Job(void (*execute)(RawPtr<Job>))
+				: m_Execute(execute)
+			{
+			}
+
+			inline void execute() {
+				m_Execute(this);
+			}
+
+			inline bool is_done() const {
+				return m_Done.load(std::memory_order_acquire);
+			}
+
+		protected:
+			inline void set_done() {
+				m_Done.store(true, std::memory_order_release);
+			}
+
+		private:
+			void (*m_Execute)(RawPtr<Job>);
+			std::atomic_bool m_Done = false;
+		};
+
+		/*
+		* Runs f, keeping its result or the exception it threw for take_result.
+		*/
+		template<typename F>
+		class StackJob : public Job {
+		public:
+			using ResultType = std::invoke_result_t<F&>;
+
+			static_assert(!std::is_void_v<ResultType>, "Jobs have to return a value");
+
+			inline explicit StackJob(F& f)
+				: StackJob(f, &StackJob::run)
+			{
+			}
+
+			inline auto take_result() -> ResultType {
+				if (m_Error) {
+					std::rethrow_exception(m_Error);
+				}
+				return std::move(*m_Result);
+			}
+
+		protected:
+			inline StackJob(F& f, void (*execute)(RawPtr<Job>))
+				: Job(execute),
+				m_F(f)
+			{
+			}
+
+			inline void run_catching() {
+				try {
+					m_Result.emplace(m_F());
+				}
+				catch (...) {
+					m_Error = std::current_exception();
+				}
+			}
+
+		private:
+			static inline void run(RawPtr<Job> job) {
+				auto self = static_cast<RawPtr<StackJob>>(job);
+				self->run_catching();
+				self->set_done();
+			}
+
+		private:
+			F& m_F;
+			std::optional<ResultType> m_Result;
+			std::exception_ptr m_Error;
+		};
+
+		/*
+		* A job for a thread outside of the pool, it blocks on a mutex instead of spinning.
+		* The flag is set under the lock, so the waiter can not destroy the job while it is still being signalled.
+		*/
+		template<typename F>
+		class LatchJob : public StackJob<F> {
+		public:
+			inline explicit LatchJob(F& f)
+				: StackJob<F>(f, &LatchJob::run)
+			{
+			}
+
+			inline void wait() {
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_IsSet; });
+			}
+
+		private:
+			static inline void run(RawPtr<Job> job) {
+				auto self = static_cast<RawPtr<LatchJob>>(job);
+				self->run_catching();
+
+				std::lock_guard<std::mutex> lock(self->m_Mutex);
+				self->m_IsSet = true;
+				self->m_Condition.notify_one();
+			}
+
+		private:
+			std::mutex m_Mutex;
+			std::condition_variable m_Condition;
+			bool m_IsSet = false;
+		};
+
+		/*
+		* The Chase-Lev work stealing deque (with the memory orderings from "Correct and Efficient
+		* Work-Stealing for Weak Memory Models", publishing with a release store rather than a fence).
+		* The owner pushes and pops at the bottom, the other workers steal from the top. Outgrown
+		* buffers are kept until the deque is destroyed since a thief might still be reading from one.
+		*/
+		class Deque {
+		public:
+			inline Deque() {
+				m_Buffers.push_back(std::make_unique<Buffer>(64));
+				m_Buffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+			}
+
+			inline void push(RawPtr<Job> job) {
+				auto bottom = m_Bottom.load(std::memory_order_relaxed);
+				auto top = m_Top.load(std::memory_order_acquire);
+				auto buffer = m_Buffer.load(std::memory_order_relaxed);
+
+				if (bottom - top > buffer->capacity - 1) {
+					buffer = grow(buffer, top, bottom);
+				}
+
+				buffer->put(bottom, job);
+				m_Bottom.store(bottom + 1, std::memory_order_release);
+			}
+
+			inline auto pop() -> RawPtr<Job> {
+				auto bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+				auto buffer = m_Buffer.load(std::memory_order_relaxed);
+				m_Bottom.store(bottom, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				auto top = m_Top.load(std::memory_order_relaxed);
+
+				if (top > bottom) {
+					m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+
+				auto job = buffer->get(bottom);
+				if (top == bottom) {
+					// the last one, race the thieves for it
+					if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+						job = nullptr;
+					}
+					m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				}
+				return job;
+			}
+
+			inline auto steal() -> RawPtr<Job> {
+				auto top = m_Top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				auto bottom = m_Bottom.load(std::memory_order_acquire);
+
+				if (top >= bottom) {
+					return nullptr;
+				}
+
+				auto job = m_Buffer.load(std::memory_order_acquire)->get(top);
+				if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					return nullptr;
+				}
+				return job;
+			}
+
+		private:
+			struct Buffer {
+				i64 capacity;
+				std::unique_ptr<std::atomic<RawPtr<Job>>[]> slots;
+
+				inline explicit Buffer(i64 size)
+					: capacity(size),
+					slots(new std::atomic<RawPtr<Job>>[static_cast<usize>(size)])
+				{
+				}
+
+				inline auto get(i64 index) const -> RawPtr<Job> {
+					return slots[static_cast<usize>(index & (capacity - 1))].load(std::memory_order_relaxed);
+				}
+
+				inline void put(i64 index, RawPtr<Job> job) {
+					slots[static_cast<usize>(index & (capacity - 1))].store(job, std::memory_order_relaxed);
+				}
+			};
+
+			inline auto grow(RawPtr<Buffer> buffer, i64 top, i64 bottom) -> RawPtr<Buffer> {
+				m_Buffers.push_back(std::make_unique<Buffer>(buffer->capacity * 2));
+				auto grown = m_Buffers.back().get();
+				for (auto i = top; i < bottom; i++) {
+					grown->put(i, buffer->get(i));
+				}
+				m_Buffer.store(grown, std::memory_order_release);
+				return grown;
+			}
+
+		private:
+			alignas(64) std::atomic<i64> m_Top = 0;
+			alignas(64) std::atomic<i64> m_Bottom = 0;
+			std::atomic<RawPtr<Buffer>> m_Buffer;
+			std::vector<std::unique_ptr<Buffer>> m_Buffers;
+		};
+
+		/*
+		* A work stealing thread pool with one deque per worker. The parallel iterators run on
+		* the global one, which has a worker per core (or RS_NUM_THREADS of them).
+		*/
+		class ThreadPool {
+		public:
+			inline explicit ThreadPool(usize threads) {
+				threads = std::max<usize>(threads, 1);
+				for (usize i = 0; i < threads; i++) {
+					m_Workers.push_back(std::make_unique<Worker>());
+					m_Workers.back()->index = i;
+					m_Workers.back()->seed = i * 0x9E3779B97F4A7C15ull + 1;
+				}
+				for (auto& worker : m_Workers) {
+					worker->thread = std::thread([this, worker = worker.get()] { run_worker(*worker); });
+				}
+			}
+
+			inline ThreadPool(const ThreadPool&) = delete;
+			inline auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+			inline ~ThreadPool() {
+				m_Stop.store(true, std::memory_order_seq_cst);
+				m_Epoch.fetch_add(1, std::memory_order_seq_cst);
+				m_Epoch.notify_all();
+				for (auto& worker : m_Workers) {
+					worker->thread.join();
+				}
+			}
+
+			static inline auto global() -> ThreadPool& {
+				static ThreadPool pool(default_threads());
+				return pool;
+			}
+
+			inline usize num_threads() const {
+				return m_Workers.size();
+			}
+
+			/*
+			* Returns the index of the worker running the calling thread, or usize max outside of the pool.
+			*/
+			static inline usize current_index() {
+				return t_Worker != nullptr ? t_Worker->index : std::numeric_limits<usize>::max();
+			}
+
+			/*
+			* Runs f on a worker of this pool and blocks until it returns.
+			*/
+			template<typename F>
+			inline auto install(F&& f) {
+				if (t_Worker != nullptr && t_Pool == this) {
+					return f();
+				}
+
+				auto job = LatchJob<F>(f);
+				{
+					std::lock_guard<std::mutex> lock(m_InjectedMutex);
+					m_Injected.push_back(&job);
+					m_InjectedCount.fetch_add(1, std::memory_order_release);
+				}
+				wake();
+				job.wait();
+				return job.take_result();
+			}
+
+			/*
+			* Queues the job without waiting for it, on the deque of the calling worker
+			* or, from outside of the pool, on the injector.
+			*/
+			inline void submit(RawPtr<Job> job) {
+				if (t_Worker != nullptr && t_Pool == this) {
+					t_Worker->deque.push(job);
+				}
+				else {
+					std::lock_guard<std::mutex> lock(m_InjectedMutex);
+					m_Injected.push_back(job);
+					m_InjectedCount.fetch_add(1, std::memory_order_release);
+				}
+				wake();
+			}
+
+			static inline usize default_threads() {
+				if (auto threads = std::getenv("RS_NUM_THREADS"); threads != nullptr && std::atoi(threads) > 0) {
+					return static_cast<usize>(std::atoi(threads));
+				}
+				return std::max<usize>(std::thread::hardware_concurrency(), 1);
+			}
+
+			/*
+			* Runs a and b, potentially in parallel, and returns both of their results.
+			* b is offered to the other workers while the calling worker runs a, if nobody took
+			* it by then it runs inline. Must be called from a worker of this pool.
+			*/
+			template<typename A, typename B>
+			inline auto join(A& a, B& b) {
+				auto& worker = *t_Worker;
+
+				auto job = StackJob<B>(b);
+				worker.deque.push(&job);
+				wake();
+
+				auto left = std::optional<std::invoke_result_t<A&>>();
+				auto error = std::exception_ptr();
+				try {
+					left.emplace(a());
+				}
+				catch (...) {
+					// b might still be running and using this stack frame, so it is waited for first
+					error = std::current_exception();
+				}
+
+				if (!job.is_done()) {
+					auto popped = worker.deque.pop();
+					if (popped == &job) {
+						job.execute();
+					}
+					else {
+						if (popped != nullptr) {
+							worker.deque.push(popped);
+						}
+						wait_for(worker, job);
+					}
+				}
+
+				if (error) {
+					std::rethrow_exception(error);
+				}
+				return std::pair(std::move(*left), job.take_result());
+			}
+
+		private:
+			struct Worker {
+				Deque deque;
+				std::thread thread;
+				usize index = 0;
+				u64 seed = 0;
+			};
+
+			inline void run_worker(Worker& worker) {
+				t_Worker = &worker;
+				t_Pool = this;
+
+				while (!m_Stop.load(std::memory_order_acquire)) {
+					if (auto job = find_work(worker); job != nullptr) {
+						job->execute();
+						continue;
+					}
+					sleep(worker);
+				}
+
+				t_Worker = nullptr;
+				t_Pool = nullptr;
+			}
+
+			// While a stolen job is running elsewhere the worker helps with the rest of the work
+			inline void wait_for(Worker& worker, const Job& job) {
+				while (!job.is_done()) {
+					if (auto other = find_work(worker); other != nullptr) {
+						other->execute();
+					}
+					else {
+						std::this_thread::yield();
+					}
+				}
+			}
+
+			inline auto find_work(Worker& worker) -> RawPtr<Job> {
+				if (auto job = worker.deque.pop(); job != nullptr) {
+					return job;
+				}
+
+				// xorshift to pick where to start stealing
+				worker.seed ^= worker.seed << 13;
+				worker.seed ^= worker.seed >> 7;
+				worker.seed ^= worker.seed << 17;
+
+				auto count = m_Workers.size();
+				auto start = static_cast<usize>(worker.seed % count);
+				for (usize i = 0; i < count; i++) {
+					auto& victim = *m_Workers[(start + i) % count];
+					if (&victim == &worker) {
+						continue;
+					}
+
+					if (auto job = victim.deque.steal(); job != nullptr) {
+						return job;
+					}
+				}
+
+				if (m_InjectedCount.load(std::memory_order_acquire) > 0) {
+					std::lock_guard<std::mutex> lock(m_InjectedMutex);
+					if (!m_Injected.empty()) {
+						auto job = m_Injected.front();
+						m_Injected.pop_front();
+						m_InjectedCount.fetch_sub(1, std::memory_order_relaxed);
+						return job;
+					}
+				}
+				return nullptr;
+			}
+
+			// Spins for a bit before going to sleep, anything pushed after the epoch is read wakes it up again
+			inline void sleep(Worker& worker) {
+				for (usize spin = 0; spin < 64; spin++) {
+					if (auto job = find_work(worker); job != nullptr) {
+						job->execute();
+						return;
+					}
+					std::this_thread::yield();
+				}
+
+				auto epoch = m_Epoch.load(std::memory_order_seq_cst);
+				m_Sleeping.fetch_add(1, std::memory_order_seq_cst);
+
+				if (auto job = find_work(worker); job != nullptr) {
+					m_Sleeping.fetch_sub(1, std::memory_order_seq_cst);
+					job->execute();
+					return;
+				}
+
+				if (!m_Stop.load(std::memory_order_acquire)) {
+					m_Epoch.wait(epoch, std::memory_order_seq_cst);
+				}
+				m_Sleeping.fetch_sub(1, std::memory_order_seq_cst);
+			}
+
+			inline void wake() {
+				m_Epoch.fetch_add(1, std::memory_order_seq_cst);
+				if (m_Sleeping.load(std::memory_order_seq_cst) > 0) {
+					m_Epoch.notify_one();
+				}
+			}
+
+		private:
+			std::vector<std::unique_ptr<Worker>> m_Workers;
+			std::mutex m_InjectedMutex;
+			std::deque<RawPtr<Job>> m_Injected;
+			std::atomic<usize> m_InjectedCount = 0;
+			std::atomic<u32> m_Epoch = 0;
+			std::atomic<u32> m_Sleeping = 0;
+			std::atomic_bool m_Stop = false;
+
+			static inline thread_local RawPtr<Worker> t_Worker = nullptr;
+			static inline thread_local RawPtr<ThreadPool> t_Pool = nullptr;
+		};
+	}
+}
+
+// Parallel iterators
+namespace rs {
+
+	namespace internal::par {
+
+		struct Nothing {};
+
+		// The part [begin, end) of its output a piece of collect() constructed, or the exception
+		// that stopped it. A piece that failed destroys what it wrote, so its range is empty
+		struct Written {
+			usize begin;
+			usize end;
+			std::exception_ptr error;
+		};
+
+		/*
+		* Decides how often a range is split. It starts with one split per worker and every time
+		* a half gets stolen (so there are idle workers) the count is reset, like Rayon's adaptive splitter.
+		*/
+		class Splitter {
+		public:
+			inline explicit Splitter(usize splits)
+				: m_Splits(splits)
+			{
+			}
+
+			inline bool try_split(bool stolen, usize threads) {
+				if (stolen) {
+					m_Splits = std::max(threads, m_Splits / 2);
+					return true;
+				}
+
+				if (m_Splits > 0) {
+					m_Splits /= 2;
+					return true;
+				}
+				return false;
+			}
+
+		private:
+			usize m_Splits;
+		};
+
+		/*
+		* Splits [begin, end) in halves with join until the splitter says stop, runs leaf on every
+		* piece and combines the results on the way back.
+		*/
+		template<typename Leaf, typename Combine>
+		inline auto bridge(usize begin, usize end, Splitter splitter, bool stolen, Leaf& leaf, Combine& combine) -> std::invoke_result_t<Leaf&, usize, usize> {
+			auto& pool = pool::ThreadPool::global();
+
+			if (end - begin > 1 && splitter.try_split(stolen, pool.num_threads())) {
+				auto mid = begin + (end - begin) / 2;
+				auto owner = pool::ThreadPool::current_index();
+
+				auto left = [&] { return bridge(begin, mid, splitter, false, leaf, combine); };
+				auto right = [&] { return bridge(mid, end, splitter, pool::ThreadPool::current_index() != owner, leaf, combine); };
+				auto [a, b] = pool.join(left, right);
+				return combine(std::move(a), std::move(b));
+			}
+			return leaf(begin, end);
+		}
+
+		template<typename Leaf, typename Combine>
+		inline auto run(usize len, Leaf leaf, Combine combine) {
+			auto& pool = pool::ThreadPool::global();
+			return pool.install([&] {
+				return bridge(0, len, Splitter(pool.num_threads()), false, leaf, combine);
+			});
+		}
+
+		/*
+		* The producers hand out a sequential Iter over any index range, the leaves of a parallel
+		* iterator run on those so they get the same fused loops (and SIMD kernels) as iter().
+		*/
+		template<typename Type, bool Mutability>
+		class SliceProducer {
+		public:
+			using ElementType = std::conditional_t<Mutability, Type, const Type>;
+
+			inline explicit SliceProducer(SliceRaw<Type, Mutability>&& slice)
+				: m_Slice(std::move(slice))
+			{
+			}
+
+			inline usize len() const { return m_Slice.len(); }
+
+			inline auto iter(usize begin, usize end) const {
+				auto ptr = m_Slice.as_ptr();
+				return Iter<SliceIter<ElementType>>(SliceIter<ElementType>(ptr + begin, ptr + end));
+			}
+
+		private:
+			SliceRaw<Type, Mutability> m_Slice;
+		};
+
+		template<typename Type>
+		class ChunksProducer {
+		public:
+			inline ChunksProducer(SliceRaw<Type, true>&& slice, usize size)
+				: m_Slice(std::move(slice)),
+				m_Size(size)
+			{
+				if (size == 0) {
+					throw std::invalid_argument("Chunk size must be non-zero");
+				}
+			}
+
+			inline usize len() const { return (m_Slice.len() + m_Size - 1) / m_Size; }
+
+			// The chunks run on other threads, so they are not checked against the owner, its checker
+			// is not thread safe. m_Slice keeps the borrow for all of them until the ParIter is dropped
+			inline auto iter(usize begin, usize end) const {
+				return rs::iter(std::views::iota(begin, end)).map([ptr = m_Slice.as_ptr(), len = m_Slice.len(), size = m_Size](usize index) {
+					auto start = index * size;
+					return SliceRaw<Type, true>::from_raw_parts(ptr + start, std::min(size, len - start));
+				});
+			}
+
+		private:
+			SliceRaw<Type, true> m_Slice;
+			usize m_Size;
+		};
+
+		template<typename Base, typename F>
+		class MapProducer {
+		public:
+			inline MapProducer(Base&& base, F&& f)
+				: m_Base(std::move(base)),
+				m_F(std::move(f))
+			{
+			}
+
+			inline usize len() const { return m_Base.len(); }
+
+			// f is shared by all the workers, so it is only ever called through a const reference
+			inline auto iter(usize begin, usize end) const {
+				return m_Base.iter(begin, end).map([f = &m_F](auto&& item) {
+					return std::invoke(*f, std::forward<decltype(item)>(item));
+				});
+			}
+
+		private:
+			Base m_Base;
+			F m_F;
+		};
+	}
+
+
+	/*
+	* A parallel iterator, the equivalent of Rayon's. The work is split over the global thread pool
+	* and every piece runs as an ordinary sequential Iter.
+	*
+	* Made from a Vec or a Slice it holds a borrow of it until the ParIter is dropped. par_iter_mut
+	* hands every task a plain reference to the elements of a disjoint part, so the closures may
+	* mutate the element they get but must not touch anything else that is shared without synchronization.
+	*/
+	template<typename Producer>
+	class ParIter {
+	public:
+		using Item = typename decltype(std::declval<const Producer&>().iter(0, 0))::Item;
+		using ValueType = std::remove_cvref_t<Item>;
+
+		inline explicit ParIter(Producer&& producer)
+			: m_Producer(std::move(producer))
+		{
+		}
+
+		inline usize len() const { return m_Producer.len(); }
+
+		template<typename F> requires(Sync<F>)
+		inline auto map(F f) {
+			using Mapped = internal::par::MapProducer<Producer, F>;
+			return ParIter<Mapped>(Mapped(std::move(m_Producer), std::move(f)));
+		}
+
+		template<typename F> requires(Sync<F>)
+		inline void for_each(F f) {
+			internal::par::run(len(),
+				[&](usize begin, usize end) {
+					m_Producer.iter(begin, end).for_each([&f](auto&& item) { std::invoke(std::as_const(f), std::forward<decltype(item)>(item)); });
+					return internal::par::Nothing();
+				},
+				[](internal::par::Nothing, internal::par::Nothing) { return internal::par::Nothing(); });
+		}
+
+		/*
+		* Folds every piece starting from identity() and combines the pieces with op,
+		* so op has to be associative and identity() neutral for it.
+		*/
+		template<typename Identity, typename Op> requires(Sync<Identity> && Sync<Op> && Send<std::invoke_result_t<Identity&>>)
+		inline auto reduce(Identity identity, Op op) {
+			using Acc = std::invoke_result_t<Identity&>;
+			return internal::par::run(len(),
+				[&](usize begin, usize end) -> Acc {
+					return m_Producer.iter(begin, end).fold(std::invoke(std::as_const(identity)), [&op](Acc acc, auto&& item) {
+						return std::invoke(std::as_const(op), std::move(acc), std::forward<decltype(item)>(item));
+					});
+				},
+				[&](Acc a, Acc b) -> Acc { return std::invoke(std::as_const(op), std::move(a), std::move(b)); });
+		}
+
+		/*
+		* Sums the items, integers wrap around on overflow.
+		* Every chunk is summed on its own and the partial sums are added as the chunks are joined,
+		* so float results can differ in the last bits from iter().sum() and from run to run.
+		*/
+		inline auto sum() -> ValueType requires(Send<ValueType>) {
+			return internal::par::run(len(),
+				[&](usize begin, usize end) { return m_Producer.iter(begin, end).sum(); },
+				[](ValueType a, ValueType b) {
+					if constexpr (std::is_integral_v<ValueType> && !std::is_same_v<ValueType, bool>) {
+						using Bits = std::make_unsigned_t<ValueType>;
+						return static_cast<ValueType>(static_cast<Bits>(a) + static_cast<Bits>(b));
+					}
+					else {
+						return a + b;
+					}
+				});
+		}
+
+		/*
+		* Collects the items into a Vec in their original order. The Vec is allocated once
+		* and every task writes its own part of it. If a task throws, the items written by
+		* all the others are destroyed before the exception is rethrown.
+		*/
+		inline auto collect() requires(Send<ValueType>) {
+			using internal::par::Written;
+
+			auto count = len();
+			auto values = Vec<ValueType>::with_capacity(count);
+			auto data = values.as_mut_ptr();
+
+			// the pieces report failures instead of throwing, so no written range is lost while unwinding
+			auto written = internal::par::run(count,
+				[&](usize begin, usize end) -> Written {
+					auto out = data + begin;
+					try {
+						m_Producer.iter(begin, end).for_each([&out](auto&& item) {
+							new (out) ValueType(std::forward<decltype(item)>(item));
+							out++;
+						});
+					}
+					catch (...) {
+						std::destroy(data + begin, out);
+						return { begin, begin, std::current_exception() };
+					}
+					return { begin, end, nullptr };
+				},
+				[&](Written a, Written b) -> Written {
+					if (a.error || b.error) {
+						std::destroy(data + a.begin, data + a.end);
+						std::destroy(data + b.begin, data + b.end);
+						return { a.begin, a.begin, a.error ? a.error : b.error };
+					}
+					return { a.begin, b.end, nullptr };
+				});
+
+			if (written.error) {
+				std::rethrow_exception(written.error);
+			}
+
+			values.unsafe_set_len(count);
+			return values;
+		}
+
+	private:
+		Producer m_Producer;
+	};
+}
+
+// Threads
+namespace rs {
+
+	namespace thread {
+
+		/*
+		* What a thread that threw leaves behind, the equivalent of the payload of a Rust panic.
+		*/
+		class Panic {
+		public:
+			inline explicit Panic(std::exception_ptr payload)
+				: m_Payload(std::move(payload))
+			{
+			}
+
+			inline auto payload() const -> const std::exception_ptr& {
+				return m_Payload;
+			}
+
+			/*
+			* The message of the exception if it was a std::exception.
+			*/
+			inline auto what() const -> std::string {
+				try {
+					std::rethrow_exception(m_Payload);
+				}
+				catch (const std::exception& e) {
+					return e.what();
+				}
+				catch (...) {
+					return "unknown exception";
+				}
+			}
+
+			/*
+			* Throws the original exception again, like resume_unwind.
+			*/
+			[[noreturn]] inline void rethrow() const {
+				std::rethrow_exception(m_Payload);
+			}
+
+		private:
+			std::exception_ptr m_Payload;
+		};
+
+		/*
+		* What a thread returning void results in.
+		*/
+		struct Unit {};
+
+		class Scope;
+	}
+
+	namespace internal::thread {
+
+		template<typename F, typename... Args>
+		using ThreadResult = std::conditional_t<std::is_void_v<std::invoke_result_t<F&, Args&&...>>, rs::thread::Unit, std::invoke_result_t<F&, Args&&...>>;
+
+		// What the spawn functions move to the new thread and back
+		template<typename F, typename... Args>
+		inline void check_send() {
+			static_assert(Send<F>, "The closure must be Send to run it on another thread");
+			static_assert((Send<Args> && ...), "The arguments must be Send to move them to another thread, use the ThreadSafe types");
+			static_assert(Send<ThreadResult<F, Args...>>, "The result must be Send to move it out of the thread, use the ThreadSafe types");
+		}
+
+		// The result of a thread, filled in by the thread and read by whoever joins it
+		class PacketBase {
+		public:
+			virtual ~PacketBase() = default;
+
+			inline bool is_finished() const {
+				return m_IsFinished.load(std::memory_order_acquire);
+			}
+
+			// Whether the result was taken by a join, Scope reads it under its mutex
+			inline bool is_observed() const {
+				return m_IsObserved;
+			}
+
+		protected:
+			std::exception_ptr m_Error;
+			std::atomic_bool m_IsFinished = false;
+			bool m_IsObserved = false;
+
+			friend class rs::thread::Scope;
+		};
+
+		template<typename Type>
+		class Packet : public PacketBase {
+		public:
+			template<typename F, typename... Args>
+			inline void run(F& f, Args&&... args) {
+				try {
+					if constexpr (std::is_void_v<std::invoke_result_t<F&, Args&&...>>) {
+						std::invoke(f, std::forward<Args>(args)...);
+						m_Value.emplace();
+					}
+					else {
+						m_Value.emplace(std::invoke(f, std::forward<Args>(args)...));
+					}
+				}
+				catch (...) {
+					m_Error = std::current_exception();
+				}
+				m_IsFinished.store(true, std::memory_order_release);
+			}
+
+			// Must only be called once the thread has been joined
+			inline auto take() {
+				m_IsObserved = true;
+				if (m_Error) {
+					return Err<Type, rs::thread::Panic>(rs::thread::Panic(m_Error));
+				}
+				return Ok<Type, rs::thread::Panic>(std::move(*m_Value));
+			}
+
+		private:
+			std::optional<Type> m_Value;
+		};
+	}
+
+	namespace thread {
+
+		/*
+		* An owned permission to join a thread. Dropping it detaches the thread, just like in Rust.
+		*/
+		template<typename Type>
+		class JoinHandle {
+		public:
+			inline JoinHandle(JoinHandle&& other) noexcept = default;
+
+			inline auto operator=(JoinHandle&& other) noexcept -> JoinHandle& {
+				if (this != &other) {
+					detach();
+					m_Thread = std::move(other.m_Thread);
+					m_Packet = std::move(other.m_Packet);
+				}
+				return *this;
+			}
+
+			inline ~JoinHandle() {
+				detach();
+			}
+
+			/*
+			* Waits for the thread to finish and returns what it returned, or an Err with the
+			* exception it threw instead of terminating the program.
+			*/
+			inline auto join() -> Result<Type, Panic> {
+				if (!m_Thread.joinable()) {
+					throw std::logic_error("The thread has already been joined");
+				}
+
+				m_Thread.join();
+				return m_Packet->take();
+			}
+
+			inline bool is_finished() const {
+				return m_Packet->is_finished();
+			}
+
+			inline auto id() const {
+				return m_Thread.get_id();
+			}
+
+		private:
+			inline JoinHandle(std::thread&& thread, std::shared_ptr<internal::thread::Packet<Type>>&& packet)
+				: m_Thread(std::move(thread)),
+				m_Packet(std::move(packet))
+			{
+			}
+
+			inline void detach() {
+				if (m_Thread.joinable()) {
+					m_Thread.detach();
+				}
+			}
+
+		private:
+			std::thread m_Thread;
+			std::shared_ptr<internal::thread::Packet<Type>> m_Packet;
+
+			template<typename F, typename... Args>
+			friend auto spawn(F f, Args... args);
+		};
+
+		/*
+		* Runs f(args...) on a new thread. An exception escaping f does not terminate the program,
+		* it ends up in the Result returned by join().
+		*
+		* The arguments and the result have to be Send, a Val can not be moved to the thread but a SafeVal can.
+		*/
+		template<typename F, typename... Args>
+		inline auto spawn(F f, Args... args) {
+			internal::thread::check_send<F, Args...>();
+			using Type = internal::thread::ThreadResult<F, Args...>;
+
+			// shared since a detached thread can outlive the handle
+			auto packet = std::make_shared<internal::thread::Packet<Type>>();
+			auto thread = std::thread([packet, f = std::move(f), ...args = std::move(args)]() mutable {
+				packet->run(f, std::move(args)...);
+			});
+			return JoinHandle<Type>(std::move(thread), std::move(packet));
+		}
+
+		/*
+		* A handle to a thread spawned in a scope, the scope joins it if it is not joined before.
+		* The handle and the scope may join at the same time, the thread is joined once and whoever
+		* comes second waits for it.
+		*/
+		template<typename Type>
+		class ScopedJoinHandle {
+		public:
+			inline auto join() -> Result<Type, Panic> {
+				std::call_once(*m_Joined, [thread = m_Thread] {
+					if (thread->joinable()) {
+						thread->join();
+					}
+				});
+
+				auto lock = std::lock_guard<std::mutex>(*m_Mutex);
+				if (m_Packet->is_observed()) {
+					throw std::logic_error("The thread has already been joined");
+				}
+				return m_Packet->take();
+			}
+
+			inline bool is_finished() const {
+				return m_Packet->is_finished();
+			}
+
+			inline auto id() const {
+				return m_Id;
+			}
+
+		private:
+			inline ScopedJoinHandle(RawPtr<std::thread> thread, RawPtr<std::once_flag> joined, RawPtr<std::mutex> mutex, RawPtr<internal::thread::Packet<Type>> packet)
+				: m_Thread(thread),
+				m_Joined(joined),
+				m_Mutex(mutex),
+				m_Packet(packet),
+				m_Id(thread->get_id())
+			{
+			}
+
+		private:
+			RawPtr<std::thread> m_Thread;
+			RawPtr<std::once_flag> m_Joined;
+			RawPtr<std::mutex> m_Mutex;
+			RawPtr<internal::thread::Packet<Type>> m_Packet;
+			std::thread::id m_Id;
+
+			friend class Scope;
+		};
+
+		/*
+		* Threads spawned from a scope are all joined before scope() returns, so unlike spawn they
+		* can borrow from the stack of the caller without SafeVal or any reference counting.
+		*
+		* Borrowing a Val, Vec or Slice that is not Safe writes its non atomic borrow count, so the
+		* threads must not borrow the same one at once: take the Ref or Slice before spawning and
+		* read through a const reference to it (indexing, begin() and end() only check it).
+		*/
+		class Scope {
+		public:
+			inline Scope(const Scope&) = delete;
+			inline auto operator=(const Scope&) -> Scope& = delete;
+
+			/*
+			* Spawns a thread in the scope, it can be called from the scoped threads too.
+			* Like for thread::spawn the arguments and the result have to be Send.
+			*/
+			template<typename F, typename... Args>
+			inline auto spawn(F f, Args... args) {
+				internal::thread::check_send<F, Args...>();
+				using Type = internal::thread::ThreadResult<F, Args...>;
+
+				auto packet = new internal::thread::Packet<Type>();
+				auto lock = std::lock_guard<std::mutex>(m_Mutex);
+				auto& entry = m_Threads.emplace_back(std::unique_ptr<internal::thread::PacketBase>(packet));
+				entry.thread = std::thread([packet, f = std::move(f), ...args = std::move(args)]() mutable {
+					packet->run(f, std::move(args)...);
+				});
+				return ScopedJoinHandle<Type>(&entry.thread, &entry.joined, &m_Mutex, packet);
+			}
+
+		private:
+			struct Entry {
+				inline explicit Entry(std::unique_ptr<internal::thread::PacketBase>&& packet)
+					: packet(std::move(packet))
+				{
+				}
+
+				std::unique_ptr<internal::thread::PacketBase> packet;
+				std::thread thread;
+				std::once_flag joined;
+			};
+
+			inline Scope() = default;
+
+			// Joins everything that was not joined yet, new threads might be spawned while doing so
+			inline auto join_all() -> std::exception_ptr {
+				auto error = std::exception_ptr();
+				for (usize i = 0; ; i++) {
+					RawPtr<Entry> entry = nullptr;
+					{
+						auto lock = std::lock_guard<std::mutex>(m_Mutex);
+						if (i == m_Threads.size()) {
+							break;
+						}
+						entry = &m_Threads[i];
+					}
+
+					std::call_once(entry->joined, [entry] {
+						if (entry->thread.joinable()) {
+							entry->thread.join();
+						}
+					});
+
+					auto lock = std::lock_guard<std::mutex>(m_Mutex);
+					if (!error && entry->packet->m_Error && !entry->packet->m_IsObserved) {
+						error = entry->packet->m_Error;
+					}
+				}
+				return error;
+			}
+
+		private:
+			std::mutex m_Mutex;
+			std::deque<Entry> m_Threads;
+
+			template<typename F>
+			friend auto scope(F f);
+		};
+
+		/*
+		* Calls f with a Scope to spawn threads from and joins all of them before returning what f returned.
+		* If f throws, or one of the threads threw and it was never joined by hand, that exception is
+		* rethrown once everything is joined.
+		*/
+		template<typename F>
+		inline auto scope(F f) {
+			auto threads = Scope();
+
+			try {
+				if constexpr (std::is_void_v<std::invoke_result_t<F&, Scope&>>) {
+					f(threads);
+					if (auto error = threads.join_all()) {
+						std::rethrow_exception(error);
+					}
+				}
+				else {
+					auto result = f(threads);
+					if (auto error = threads.join_all()) {
+						std::rethrow_exception(error);
+					}
+					return result;
+				}
+			}
+			catch (...) {
+				threads.join_all();
+				throw;
+			}
+		}
+	}
+}
+
+// Async
+namespace rs {
+
+	class Executor;
+
+	template<typename Type>
+	class Task;
+
+	namespace internal::async {
+
+		class FrameArena;
+
+		class PromiseBase;
+
+		class Reactor;
+
+		struct Node;
+
+		/*
+		* Whoever is responsible for a task nobody awaits, it gets the task once it is complete.
+		*/
+		class Owner {
+		public:
+			virtual void finish(PromiseBase& promise, std::coroutine_handle<> handle) = 0;
+
+		protected:
+			~Owner() = default;
+		};
+
+		/*
+		* What runs the tasks, the single threaded Executor or the multi threaded Runtime.
+		* Every awaiter wakes the task it suspended through the scheduler that was running it.
+		*/
+		class Scheduler : public Owner {
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			virtual void schedule(Node& node) = 0;
+
+			virtual void add_timer(Clock::time_point deadline, Node& node) = 0;
+
+			// Where the coroutine frames come from, the global allocator if null
+			virtual auto arena() -> RawPtr<FrameArena> { return nullptr; }
+
+			// The reactor for the io types, only the Runtime has one
+			virtual auto reactor() -> RawPtr<Reactor> { return nullptr; }
+
+			static inline auto running() -> Scheduler&;
+
+		protected:
+			~Scheduler() = default;
+		};
+
+		// The scheduler running the task on this thread
+		inline thread_local RawPtr<Scheduler> t_Scheduler = nullptr;
+
+		inline auto Scheduler::running() -> Scheduler& {
+			if (!t_Scheduler) {
+				throw std::logic_error("There is no executor or runtime running on this thread");
+			}
+			return *t_Scheduler;
+		}
+
+		/*
+		* An entry of the ready queue or of the timers, it lives in whatever waits (a promise or an awaiter)
+		* so queueing never allocates. It is a job as well, so the Runtime can hand it to its thread pool.
+		*/
+		struct Node : public pool::Job {
+			inline Node()
+				: Job(&Node::run)
+			{
+			}
+
+			// Remembers the suspended task and who runs it, has to be called before the node is handed out
+			inline void suspend(std::coroutine_handle<> handle) {
+				m_Handle = handle;
+				m_Scheduler = &Scheduler::running();
+			}
+
+			inline void wake() {
+				m_Scheduler->schedule(*this);
+			}
+
+			// The node lives in the frame being resumed, it must not be touched once it is resumed
+			static inline void run(RawPtr<Job> job) {
+				auto node = static_cast<RawPtr<Node>>(job);
+				auto previous = std::exchange(t_Scheduler, node->m_Scheduler);
+				node->m_Handle.resume();
+				t_Scheduler = previous;
+			}
+
+			RawPtr<Node> m_Next = nullptr;
+			std::coroutine_handle<> m_Handle;
+			RawPtr<Scheduler> m_Scheduler = nullptr;
+		};
+
+		/*
+		* Where the coroutine frames of an executor come from. The frames are cut in size classes from
+		* big chunks and go back to the free list of their class, so tasks that are created and finished
+		* over and over never reach the global allocator. Bigger frames use operator new.
+		*/
+		class FrameArena {
+		public:
+			static constexpr usize Granularity = 64;
+			static constexpr usize ClassCount = 64;
+			static constexpr usize ChunkSize = 64 * 1024;
+
+			inline FrameArena() = default;
+			inline FrameArena(const FrameArena&) = delete;
+			inline auto operator=(const FrameArena&) -> FrameArena& = delete;
+
+			inline ~FrameArena() {
+				for (auto chunk : m_Chunks) {
+					::operator delete(chunk);
+				}
+			}
+
+			inline auto allocate(usize size) -> RawPtr<void> {
+				auto index = (size + Granularity - 1) / Granularity;
+				if (index > ClassCount) {
+					return ::operator new(size);
+				}
+
+				if (auto block = m_Free[index - 1]) {
+					m_Free[index - 1] = block->m_Next;
+					return block;
+				}
+
+				auto bytes = index * Granularity;
+				if (static_cast<usize>(m_End - m_Cursor) < bytes) {
+					m_Cursor = static_cast<RawPtr<std::byte>>(::operator new(ChunkSize));
+					m_End = m_Cursor + ChunkSize;
+					m_Chunks.push_back(m_Cursor);
+				}
+
+				auto block = m_Cursor;
+				m_Cursor += bytes;
+				return block;
+			}
+
+			inline void deallocate(RawPtr<void> ptr, usize size) {
+				auto index = (size + Granularity - 1) / Granularity;
+				if (index > ClassCount) {
+					::operator delete(ptr);
+					return;
+				}
+
+				m_Free[index - 1] = new (ptr) FreeBlock { m_Free[index - 1] };
+			}
+
+		private:
+			struct FreeBlock {
+				RawPtr<FreeBlock> m_Next;
+			};
+
+			std::array<RawPtr<FreeBlock>, ClassCount> m_Free = {};
+			RawPtr<std::byte> m_Cursor = nullptr;
+			RawPtr<std::byte> m_End = nullptr;
+			std::vector<RawPtr<void>> m_Chunks;
+		};
+
+		using internal::iter::result_traits;
+
+		template<typename Type>
+		concept IsResult = requires { typename result_traits<Type>::ErrorType; };
+
+		/*
+		* The part of a promise that does not depend on the output. A finished task resumes whoever
+		* awaited it, a spawned task is destroyed by its executor and a task run by block_on just stops.
+		*/
+		class PromiseBase {
+		public:
+			struct FinalAwaiter {
+				inline bool await_ready() const noexcept { return false; }
+
+				template<typename Promise>
+				inline auto await_suspend(std::coroutine_handle<Promise> self) noexcept -> std::coroutine_handle<> {
+					return self.promise().on_final(self);
+				}
+
+				inline void await_resume() const noexcept {}
+			};
+
+			inline auto initial_suspend() const noexcept { return std::suspend_always(); }
+
+			inline auto final_suspend() const noexcept { return FinalAwaiter(); }
+
+			inline void unhandled_exception() {
+				m_Error = std::current_exception();
+			}
+
+			// Frames remember where they came from, they might be freed after the executor stopped running
+			static constexpr usize HeaderSize = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+			static inline auto operator new(usize size) -> RawPtr<void> {
+				auto arena = t_Scheduler ? t_Scheduler->arena() : nullptr;
+				auto block = static_cast<RawPtr<std::byte>>(arena ? arena->allocate(size + HeaderSize) : ::operator new(size + HeaderSize));
+				new (block) RawPtr<FrameArena>(arena);
+				return block + HeaderSize;
+			}
+
+			static inline void operator delete(RawPtr<void> ptr, usize size) {
+				auto block = static_cast<RawPtr<std::byte>>(ptr) - HeaderSize;
+				auto arena = *std::launder(reinterpret_cast<RawPtr<RawPtr<FrameArena>>>(block));
+				if (arena) {
+					arena->deallocate(block, size + HeaderSize);
+				}
+				else {
+					::operator delete(block);
+				}
+			}
+
+			inline auto complete(std::coroutine_handle<> self) -> std::coroutine_handle<> {
+				m_IsComplete = true;
+				if (m_Continuation) {
+					return m_Continuation;
+				}
+				if (m_Owner) {
+					m_Owner->finish(*this, self);
+				}
+				return std::noop_coroutine();
+			}
+
+		public:
+			std::coroutine_handle<> m_Continuation;
+			std::exception_ptr m_Error;
+			bool m_IsComplete = false;
+
+			// Spawned tasks belong to their executor and are linked in its list
+			RawPtr<Owner> m_Owner = nullptr;
+			RawPtr<PromiseBase> m_Prev = nullptr;
+			RawPtr<PromiseBase> m_Next = nullptr;
+			Node m_Node;
+
+			// Set by propagate(), called instead of resuming the awaiting task when the output is an Err
+			RawPtr<std::coroutine_handle<>(RawPtr<void>)> m_Propagate = nullptr;
+			RawPtr<void> m_PropagateAwaiter = nullptr;
+		};
+
+		template<typename Type>
+		class PromiseReturn : public PromiseBase {
+		public:
+			template<typename Value = Type>
+			inline void return_value(Value&& value) {
+				m_Value.emplace(std::forward<Value>(value));
+			}
+
+		protected:
+			std::optional<Type> m_Value;
+		};
+
+		template<>
+		class PromiseReturn<void> : public PromiseBase {
+		public:
+			inline void return_void() {
+				m_Value = true;
+			}
+
+		protected:
+			bool m_Value = false;
+		};
+
+		template<typename Type>
+		class Promise : public PromiseReturn<Type> {
+		public:
+			using Output = Type;
+
+			inline auto get_return_object() {
+				return Task<Type>(std::coroutine_handle<Promise>::from_promise(*this));
+			}
+
+			inline auto on_final(std::coroutine_handle<Promise> self) -> std::coroutine_handle<> {
+				if constexpr (IsResult<Type>) {
+					if (this->m_Propagate && is_err()) {
+						return this->m_Propagate(this->m_PropagateAwaiter);
+					}
+				}
+				return this->complete(self);
+			}
+
+			// Whether the task returned an Err, which propagate() hands on instead of resuming the awaiting task
+			inline bool is_err() const requires(IsResult<Type>) {
+				return this->m_Value && result_traits<Type>::is_err(*this->m_Value);
+			}
+
+			// What the task returned, or the exception it threw
+			inline auto take() -> Type {
+				if (this->m_Error) {
+					std::rethrow_exception(std::exchange(this->m_Error, nullptr));
+				}
+				if (!this->m_Value) {
+					throw std::logic_error("The output of the task has already been taken");
+				}
+
+				if constexpr (std::is_void_v<Type>) {
+					this->m_Value = false;
+				}
+				else {
+					auto value = std::move(*this->m_Value);
+					this->m_Value.reset();
+					return value;
+				}
+			}
+		};
+
+		template<typename Type>
+		class TaskAwaiter {
+		public:
+			inline explicit TaskAwaiter(std::coroutine_handle<Promise<Type>> handle)
+				: m_Handle(handle)
+			{
+			}
+
+			inline bool await_ready() const {
+				return m_Handle.promise().m_IsComplete;
+			}
+
+			inline auto await_suspend(std::coroutine_handle<> awaiting) -> std::coroutine_handle<> {
+				m_Handle.promise().m_Continuation = awaiting;
+				return m_Handle;
+			}
+
+			inline auto await_resume() -> Type {
+				return m_Handle.promise().take();
+			}
+
+		protected:
+			std::coroutine_handle<Promise<Type>> m_Handle;
+		};
+
+		/*
+		* The awaiter behind propagate(), the ? operator of async code: an Ok gives the value to the
+		* awaiting task, an Err completes the awaiting task with that Err without ever resuming it.
+		*/
+		template<typename Type>
+		class PropagateAwaiter : public TaskAwaiter<Type> {
+		public:
+			using Traits = result_traits<Type>;
+			using ValueType = typename Traits::ValueType;
+			using ErrorType = typename Traits::ErrorType;
+
+			using TaskAwaiter<Type>::TaskAwaiter;
+
+			// A task that already finished with an Err still goes through await_suspend
+			inline bool await_ready() const {
+				auto& promise = this->m_Handle.promise();
+				return promise.m_IsComplete && !promise.is_err();
+			}
+
+			template<typename Promise>
+			inline auto await_suspend(std::coroutine_handle<Promise> awaiting) -> std::coroutine_handle<> {
+				using Output = typename Promise::Output;
+				static_assert(IsResult<Output>, "propagate() can only be awaited in a Task returning a Result");
+
+				using Outer = result_traits<Output>;
+				static_assert(std::is_constructible_v<typename Outer::ErrorType, ErrorType&&>, "The error can not be converted to the error type of the awaiting Task");
+
+				m_Awaiting = awaiting;
+				m_SetErr = [](std::coroutine_handle<> handle, ErrorType&& error) {
+					auto self = std::coroutine_handle<Promise>::from_address(handle.address());
+					self.promise().return_value(make_err<Output>(typename Outer::ErrorType(std::move(error))));
+
+					// Finished like a co_return would, so if it was awaited with propagate() too the Err goes on up
+					return self.promise().on_final(self);
+				};
+
+				auto& promise = this->m_Handle.promise();
+				if (promise.m_IsComplete) {
+					return propagate(this);
+				}
+
+				promise.m_Continuation = awaiting;
+				promise.m_Propagate = &PropagateAwaiter::propagate;
+				promise.m_PropagateAwaiter = this;
+				return this->m_Handle;
+			}
+
+			inline auto await_resume() -> ValueType {
+				auto result = this->m_Handle.promise().take();
+				if (Traits::is_err(result)) {
+					throw std::logic_error("An Err of a propagated task reached the task awaiting it");
+				}
+				return Traits::take_ok(result);
+			}
+
+		private:
+			template<typename Output, typename Error>
+			static inline auto make_err(Error&& error) -> Output {
+				using Outer = result_traits<Output>;
+				return ErrRaw<typename Outer::ValueType, typename Outer::ErrorType, Outer::IsThreadSafe>(
+					ValRaw<typename Outer::ErrorType, Outer::IsThreadSafe>(std::forward<Error>(error)));
+			}
+
+			// Runs at the final suspend of the awaited task, the awaiting task might be destroyed by it
+			static inline auto propagate(RawPtr<void> self) -> std::coroutine_handle<> {
+				auto& awaiter = *static_cast<RawPtr<PropagateAwaiter>>(self);
+				auto result = awaiter.m_Handle.promise().take();
+				return awaiter.m_SetErr(awaiter.m_Awaiting, Traits::take_err(result));
+			}
+
+		private:
+			std::coroutine_handle<> m_Awaiting;
+			RawPtr<std::coroutine_handle<>(std::coroutine_handle<>, ErrorType&&)> m_SetErr = nullptr;
+		};
+	}
+
+	/*
+	* Anything that can be co_awaited, the equivalent of Rust's Future trait.
+	*/
+	template<typename Type>
+	concept Future = requires(Type& t) {
+		{ t.await_ready() } -> std::convertible_to<bool>;
+		t.await_resume();
+	} || requires(Type&& t) {
+		std::forward<Type>(t).operator co_await();
+	};
+
+	/*
+	* A lazy coroutine, nothing runs until it is awaited, spawned or given to block_on.
+	*
+	*	auto fetch(i32 id) -> Task<Result<str, Error>> { ... }
+	*
+	*	auto handler() -> Task<Result<usize, Error>> {
+	*		auto page = co_await fetch(1).propagate();	// an Err returns it from handler right away
+	*		co_return Ok<usize, Error>(page.size());
+	*	}
+	*/
+	template<typename Type>
+	class Task {
+	public:
+		using promise_type = internal::async::Promise<Type>;
+		using Output = Type;
+
+		inline Task(const Task&) = delete;
+		inline auto operator=(const Task&) -> Task& = delete;
+
+		inline Task(Task&& other) noexcept
+			: m_Handle(std::exchange(other.m_Handle, nullptr))
+		{
+		}
+
+		inline auto operator=(Task&& other) noexcept -> Task& {
+			if (this != &other) {
+				if (m_Handle) {
+					m_Handle.destroy();
+				}
+				m_Handle = std::exchange(other.m_Handle, nullptr);
+			}
+			return *this;
+		}
+
+		inline ~Task() {
+			if (m_Handle) {
+				m_Handle.destroy();
+			}
+		}
+
+		inline auto operator co_await() {
+			return internal::async::TaskAwaiter<Type>(m_Handle);
+		}
+
+		/*
+		* Awaits a task returning a Result and gives the Ok value, an Err completes the awaiting
+		* task (which has to return a Result too) with that Err instead, without any exception.
+		*/
+		inline auto propagate() requires(internal::async::IsResult<Type>) {
+			return internal::async::PropagateAwaiter<Type>(m_Handle);
+		}
+
+		inline bool is_complete() const {
+			return m_Handle.promise().m_IsComplete;
+		}
+
+	private:
+		inline explicit Task(std::coroutine_handle<promise_type> handle)
+			: m_Handle(handle)
+		{
+		}
+
+		std::coroutine_handle<promise_type> m_Handle;
+
+		friend class internal::async::Promise<Type>;
+		friend class Executor;
+		friend class Runtime;
+	};
+
+	/*
+	* A single threaded executor, the tasks run on the thread that calls run() or block_on() one at a
+	* time until they await something. Ready tasks are kept in an intrusive queue and timers in a heap,
+	* the coroutine frames of the tasks created while it runs come from its own arena.
+	*
+	* Since everything runs on one thread, tasks can keep a Val or a Ref across a co_await, there is
+	* no need for the ThreadSafe types. A task must not outlive the executor it was created on.
+	*/
+	class Executor : public internal::async::Scheduler {
+	public:
+		inline Executor() = default;
+		inline Executor(const Executor&) = delete;
+		inline auto operator=(const Executor&) -> Executor& = delete;
+
+		inline ~Executor() {
+			auto enter = Enter(this);
+			m_Head = nullptr;
+			m_Tail = nullptr;
+			m_Timers.clear();
+
+			while (m_Spawned) {
+				auto promise = m_Spawned;
+				unlink(*promise);
+				promise->m_Node.m_Handle.destroy();
+			}
+		}
+
+		/*
+		* Hands the task over to the executor, it starts on the next run() or block_on().
+		* An exception escaping it is rethrown from run(), or from block_on() once its task is complete.
+		*/
+		template<typename Type>
+		inline void spawn(Task<Type> task) {
+			auto handle = std::exchange(task.m_Handle, nullptr);
+			auto& promise = handle.promise();
+			promise.m_Owner = this;
+			promise.m_Next = m_Spawned;
+			if (m_Spawned) {
+				m_Spawned->m_Prev = &promise;
+			}
+			m_Spawned = &promise;
+
+			promise.m_Node.m_Handle = handle;
+			promise.m_Node.m_Scheduler = this;
+			schedule(promise.m_Node);
+		}
+
+		/*
+		* Runs until no task is ready and no timer is pending.
+		*/
+		inline void run() {
+			auto enter = Enter(this);
+			while (step()) {
+				rethrow();
+			}
+		}
+
+		/*
+		* Runs the task (and the spawned ones in the meantime) until it is complete and returns its output.
+		*/
+		template<typename Type>
+		inline auto block_on(Task<Type> task) -> Type {
+			auto enter = Enter(this);
+			auto& promise = task.m_Handle.promise();
+			promise.m_Node.m_Handle = task.m_Handle;
+			promise.m_Node.m_Scheduler = this;
+			schedule(promise.m_Node);
+
+			while (!promise.m_IsComplete) {
+				if (!step()) {
+					throw std::logic_error("The task can not complete, no task is ready and no timer is pending");
+				}
+			}
+
+			// only now, the task has to be complete before its frame can go away
+			rethrow();
+			return promise.take();
+		}
+
+	private:
+		struct Timer {
+			Clock::time_point m_Deadline;
+			u64 m_Order;
+			RawPtr<internal::async::Node> m_Node;
+
+			// std::push_heap builds a max heap, the earliest deadline has to come out first
+			inline bool operator<(const Timer& other) const {
+				return std::tie(other.m_Deadline, other.m_Order) < std::tie(m_Deadline, m_Order);
+			}
+		};
+
+		class Enter {
+		public:
+			inline explicit Enter(RawPtr<Scheduler> scheduler)
+				: m_Previous(std::exchange(internal::async::t_Scheduler, scheduler))
+			{
+			}
+
+			inline ~Enter() {
+				internal::async::t_Scheduler = m_Previous;
+			}
+
+		private:
+			RawPtr<Scheduler> m_Previous;
+		};
+
+		inline void schedule(internal::async::Node& node) override {
+			node.m_Next = nullptr;
+			if (m_Tail) {
+				m_Tail->m_Next = &node;
+			}
+			else {
+				m_Head = &node;
+			}
+			m_Tail = &node;
+		}
+
+		inline void add_timer(Clock::time_point deadline, internal::async::Node& node) override {
+			m_Timers.push_back(Timer { deadline, m_TimerOrder++, &node });
+			std::push_heap(m_Timers.begin(), m_Timers.end());
+		}
+
+		inline auto arena() -> RawPtr<internal::async::FrameArena> override {
+			return &m_Arena;
+		}
+
+		// Resumes one ready task or waits for the next timer, false when there is nothing left to do
+		inline bool step() {
+			if (auto node = m_Head) {
+				m_Head = node->m_Next;
+				if (!m_Head) {
+					m_Tail = nullptr;
+				}
+
+				node->m_Handle.resume();
+				return true;
+			}
+
+			if (m_Timers.empty()) {
+				return false;
+			}
+
+			std::this_thread::sleep_until(m_Timers.front().m_Deadline);
+			auto now = Clock::now();
+			while (!m_Timers.empty() && m_Timers.front().m_Deadline <= now) {
+				std::pop_heap(m_Timers.begin(), m_Timers.end());
+				schedule(*m_Timers.back().m_Node);
+				m_Timers.pop_back();
+			}
+			return true;
+		}
+
+		inline void rethrow() {
+			if (m_Error) {
+				std::rethrow_exception(std::exchange(m_Error, nullptr));
+			}
+		}
+
+		inline void unlink(internal::async::PromiseBase& promise) {
+			if (promise.m_Prev) {
+				promise.m_Prev->m_Next = promise.m_Next;
+			}
+			else {
+				m_Spawned = promise.m_Next;
+			}
+			if (promise.m_Next) {
+				promise.m_Next->m_Prev = promise.m_Prev;
+			}
+		}
+
+		// A spawned task completed, nothing awaits it so it is destroyed right away
+		inline void finish(internal::async::PromiseBase& promise, std::coroutine_handle<> handle) override {
+			unlink(promise);
+			if (promise.m_Error && !m_Error) {
+				m_Error = promise.m_Error;
+			}
+			handle.destroy();
+		}
+
+	private:
+		RawPtr<internal::async::Node> m_Head = nullptr;
+		RawPtr<internal::async::Node> m_Tail = nullptr;
+		std::vector<Timer> m_Timers;
+		u64 m_TimerOrder = 0;
+		RawPtr<internal::async::PromiseBase> m_Spawned = nullptr;
+		std::exception_ptr m_Error;
+		internal::async::FrameArena m_Arena;
+	};
+
+	/*
+	* Suspends the task until the deadline, the other tasks keep running meanwhile.
+	*/
+	class Sleep {
+	public:
+		inline explicit Sleep(std::chrono::steady_clock::time_point deadline)
+			: m_Deadline(deadline)
+		{
+		}
+
+		inline bool await_ready() const {
+			return m_Deadline <= std::chrono::steady_clock::now();
+		}
+
+		inline void await_suspend(std::coroutine_handle<> handle) {
+			m_Node.suspend(handle);
+			m_Node.m_Scheduler->add_timer(m_Deadline, m_Node);
+		}
+
+		inline void await_resume() const {}
+
+	private:
+		std::chrono::steady_clock::time_point m_Deadline;
+		internal::async::Node m_Node;
+	};
+
+	/*
+	* Lets the other ready tasks run before continuing.
+	*/
+	class YieldNow {
+	public:
+		inline bool await_ready() const { return false; }
+
+		inline void await_suspend(std::coroutine_handle<> handle) {
+			m_Node.suspend(handle);
+			m_Node.wake();
+		}
+
+		inline void await_resume() const {}
+
+	private:
+		internal::async::Node m_Node;
+	};
+
+	inline auto sleep_until(std::chrono::steady_clock::time_point deadline) {
+		return Sleep(deadline);
+	}
+
+	template<typename Rep, typename Period>
+	inline auto sleep_for(std::chrono::duration<Rep, Period> duration) {
+		return Sleep(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration));
+	}
+
+	inline auto yield_now() {
+		return YieldNow();
+	}
+
+	/*
+	* Runs the task to completion on a new executor and returns its output.
+	*/
+	template<typename Type>
+	inline auto block_on(Task<Type> task) -> Type {
+		auto executor = Executor();
+		return executor.block_on(std::move(task));
+	}
+
+	namespace internal::async {
+
+		template<typename Type>
+		struct Channel {
+			std::mutex m_Mutex;
+			std::deque<Type> m_Queue;
+			RawPtr<Node> m_Waiter = nullptr;
+			usize m_Senders = 1;
+			bool m_IsReceiverAlive = true;
+		};
+
+		template<typename Type>
+		class Recv {
+		public:
+			inline explicit Recv(Channel<Type>& channel)
+				: m_Channel(channel)
+			{
+			}
+
+			inline Recv(const Recv&) = delete;
+			inline auto operator=(const Recv&) -> Recv& = delete;
+
+			inline ~Recv() {
+				std::lock_guard<std::mutex> lock(m_Channel.m_Mutex);
+				if (m_Channel.m_Waiter == &m_Node) {
+					m_Channel.m_Waiter = nullptr;
+				}
+			}
+
+			inline bool await_ready() const { return false; }
+
+			inline bool await_suspend(std::coroutine_handle<> handle) {
+				std::lock_guard<std::mutex> lock(m_Channel.m_Mutex);
+				if (!m_Channel.m_Queue.empty() || m_Channel.m_Senders == 0) {
+					return false;
+				}
+				m_Node.suspend(handle);
+				m_Channel.m_Waiter = &m_Node;
+				return true;
+			}
+
+			inline auto await_resume() -> Option<Type> {
+				std::lock_guard<std::mutex> lock(m_Channel.m_Mutex);
+				if (m_Channel.m_Queue.empty()) {
+					return None<Type>();
+				}
+				auto value = std::move(m_Channel.m_Queue.front());
+				m_Channel.m_Queue.pop_front();
+				return Some<Type>(std::move(value));
+			}
+
+		private:
+			Channel<Type>& m_Channel;
+			Node m_Node;
+		};
+
+		// A task waiting for an async Mutex, the mutex is handed to it directly on unlock
+		struct LockWaiter : public Node {
+			RawPtr<LockWaiter> m_NextWaiter = nullptr;
+			bool m_IsQueued = false;
+			bool m_IsOwner = false;
+		};
+	}
+
+	/*
+	* The async synchronization primitives, they suspend the task instead of blocking the thread
+	* and work on the Executor as well as on the Runtime.
+	*/
+	namespace sync {
+
+		template<typename Type>
+		class Sender;
+
+		template<typename Type>
+		class Receiver;
+
+		template<typename Type>
+		class Mutex;
+
+		template<typename Type>
+		inline auto channel() -> std::pair<Sender<Type>, Receiver<Type>>;
+
+		/*
+		* The sending half of an unbounded channel, it can be copied to have multiple producers.
+		*/
+		template<typename Type>
+		class Sender {
+		public:
+			inline Sender(const Sender& other)
+				: m_Channel(other.m_Channel)
+			{
+				std::lock_guard<std::mutex> lock(m_Channel->m_Mutex);
+				m_Channel->m_Senders++;
+			}
+
+			inline Sender(Sender&& other) noexcept = default;
+
+			inline auto operator=(const Sender& other) -> Sender& {
+				if (this != &other) {
+					*this = Sender(other);
+				}
+				return *this;
+			}
+
+			inline auto operator=(Sender&& other) noexcept -> Sender& {
+				if (this != &other) {
+					drop();
+					m_Channel = std::move(other.m_Channel);
+				}
+				return *this;
+			}
+
+			inline ~Sender() {
+				drop();
+			}
+
+			/*
+			* Queues the value and wakes the receiver, gives false back if the receiver is gone.
+			*/
+			inline bool send(Type value) {
+				std::lock_guard<std::mutex> lock(m_Channel->m_Mutex);
+				if (!m_Channel->m_IsReceiverAlive) {
+					return false;
+				}
+
+				m_Channel->m_Queue.push_back(std::move(value));
+				if (auto waiter = std::exchange(m_Channel->m_Waiter, nullptr)) {
+					waiter->wake();
+				}
+				return true;
+			}
+
+		private:
+			inline explicit Sender(std::shared_ptr<internal::async::Channel<Type>> channel)
+				: m_Channel(std::move(channel))
+			{
+			}
+
+			// The last sender wakes the receiver up, recv() gives None from then on
+			inline void drop() {
+				if (!m_Channel) {
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_Channel->m_Mutex);
+					if (--m_Channel->m_Senders == 0) {
+						if (auto waiter = std::exchange(m_Channel->m_Waiter, nullptr)) {
+							waiter->wake();
+						}
+					}
+				}
+				m_Channel.reset();
+			}
+
+		private:
+			std::shared_ptr<internal::async::Channel<Type>> m_Channel;
+
+			friend auto channel<Type>() -> std::pair<Sender<Type>, Receiver<Type>>;
+		};
+
+		/*
+		* The receiving half of a channel, there is only ever one.
+		*/
+		template<typename Type>
+		class Receiver {
+		public:
+			inline Receiver(Receiver&& other) noexcept = default;
+
+			inline auto operator=(Receiver&& other) noexcept -> Receiver& {
+				if (this != &other) {
+					drop();
+					m_Channel = std::move(other.m_Channel);
+				}
+				return *this;
+			}
+
+			inline ~Receiver() {
+				drop();
+			}
+
+			/*
+			* Waits for the next value, None once the channel is empty and every Sender is gone.
+			*/
+			inline auto recv() {
+				return internal::async::Recv<Type>(*m_Channel);
+			}
+
+			/*
+			* The next value if there is one, without waiting.
+			*/
+			inline auto try_recv() -> Option<Type> {
+				std::lock_guard<std::mutex> lock(m_Channel->m_Mutex);
+				if (m_Channel->m_Queue.empty()) {
+					return None<Type>();
+				}
+				auto value = std::move(m_Channel->m_Queue.front());
+				m_Channel->m_Queue.pop_front();
+				return Some<Type>(std::move(value));
+			}
+
+		private:
+			inline explicit Receiver(std::shared_ptr<internal::async::Channel<Type>> channel)
+				: m_Channel(std::move(channel))
+			{
+			}
+
+			inline void drop() {
+				if (!m_Channel) {
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_Channel->m_Mutex);
+					m_Channel->m_IsReceiverAlive = false;
+					m_Channel->m_Queue.clear();
+				}
+				m_Channel.reset();
+			}
+
+		private:
+			std::shared_ptr<internal::async::Channel<Type>> m_Channel;
+
+			friend auto channel<Type>() -> std::pair<Sender<Type>, Receiver<Type>>;
+		};
+
+		/*
+		* Creates an unbounded multi producer single consumer channel. The values cross threads
+		* on a Runtime, so they have to be Send.
+		*/
+		template<typename Type>
+		inline auto channel() -> std::pair<Sender<Type>, Receiver<Type>> {
+			static_assert(Send<Type>, "The values of a channel must be Send, use the ThreadSafe types");
+			auto state = std::make_shared<internal::async::Channel<Type>>();
+			return std::pair(Sender<Type>(state), Receiver<Type>(state));
+		}
+
+		/*
+		* Unlocks the Mutex when dropped.
+		*/
+		template<typename Type>
+		class MutexGuard {
+		public:
+			inline MutexGuard(MutexGuard&& other) noexcept
+				: m_Mutex(std::exchange(other.m_Mutex, nullptr))
+			{
+			}
+
+			inline auto operator=(MutexGuard&& other) noexcept -> MutexGuard& {
+				if (this != &other) {
+					if (m_Mutex) {
+						m_Mutex->unlock();
+					}
+					m_Mutex = std::exchange(other.m_Mutex, nullptr);
+				}
+				return *this;
+			}
+
+			inline ~MutexGuard() {
+				if (m_Mutex) {
+					m_Mutex->unlock();
+				}
+			}
+
+			inline auto operator*() const -> Type& { return m_Mutex->m_Value; }
+
+			inline auto operator->() const -> RawPtr<Type> { return &m_Mutex->m_Value; }
+
+		private:
+			inline explicit MutexGuard(RawPtr<Mutex<Type>> mutex)
+				: m_Mutex(mutex)
+			{
+			}
+
+			RawPtr<Mutex<Type>> m_Mutex;
+
+			friend class Mutex<Type>;
+		};
+
+		/*
+		* A mutex that can be held across a co_await. Waiting tasks are queued in order
+		* and the mutex is handed from one to the next.
+		*/
+		template<typename Type>
+		class Mutex {
+		public:
+			inline explicit Mutex(Type value)
+				: m_Value(std::move(value))
+			{
+			}
+
+			inline Mutex(const Mutex&) = delete;
+			inline auto operator=(const Mutex&) -> Mutex& = delete;
+
+			/*
+			* Waits for the mutex and gives a MutexGuard for the value.
+			*/
+			inline auto lock() {
+				return Lock(*this);
+			}
+
+			inline auto try_lock() -> Option<MutexGuard<Type>> {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_IsLocked) {
+					return None<MutexGuard<Type>>();
+				}
+				m_IsLocked = true;
+				return Some<MutexGuard<Type>>(MutexGuard<Type>(this));
+			}
+
+		private:
+			class Lock {
+			public:
+				inline explicit Lock(Mutex& mutex)
+					: m_Mutex(mutex)
+				{
+				}
+
+				inline Lock(const Lock&) = delete;
+				inline auto operator=(const Lock&) -> Lock& = delete;
+
+				// A task dropped while waiting leaves the queue, or passes the mutex on if it was handed to it already
+				inline ~Lock() {
+					if (m_IsGuarded) {
+						return;
+					}
+
+					std::lock_guard<std::mutex> lock(m_Mutex.m_Mutex);
+					if (m_Waiter.m_IsOwner) {
+						m_Mutex.unlock_locked();
+					}
+					else if (m_Waiter.m_IsQueued) {
+						m_Mutex.remove_locked(m_Waiter);
+					}
+				}
+
+				inline bool await_ready() {
+					std::lock_guard<std::mutex> lock(m_Mutex.m_Mutex);
+					return acquire_locked();
+				}
+
+				inline bool await_suspend(std::coroutine_handle<> handle) {
+					std::lock_guard<std::mutex> lock(m_Mutex.m_Mutex);
+					if (acquire_locked()) {
+						return false;
+					}
+
+					m_Waiter.suspend(handle);
+					m_Waiter.m_IsQueued = true;
+					if (m_Mutex.m_Tail) {
+						m_Mutex.m_Tail->m_NextWaiter = &m_Waiter;
+					}
+					else {
+						m_Mutex.m_Head = &m_Waiter;
+					}
+					m_Mutex.m_Tail = &m_Waiter;
+					return true;
+				}
+
+				inline auto await_resume() {
+					m_IsGuarded = true;
+					return MutexGuard<Type>(&m_Mutex);
+				}
+
+			private:
+				inline bool acquire_locked() {
+					if (m_Mutex.m_IsLocked) {
+						return false;
+					}
+					m_Mutex.m_IsLocked = true;
+					m_Waiter.m_IsOwner = true;
+					return true;
+				}
+
+			private:
+				Mutex& m_Mutex;
+				internal::async::LockWaiter m_Waiter;
+				bool m_IsGuarded = false;
+			};
+
+			inline void unlock() {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				unlock_locked();
+			}
+
+			inline void unlock_locked() {
+				auto next = m_Head;
+				if (!next) {
+					m_IsLocked = false;
+					return;
+				}
+
+				m_Head = next->m_NextWaiter;
+				if (!m_Head) {
+					m_Tail = nullptr;
+				}
+				next->m_IsQueued = false;
+				next->m_IsOwner = true;
+				next->wake();
+			}
+
+			inline void remove_locked(internal::async::LockWaiter& waiter) {
+				RawPtr<internal::async::LockWaiter> previous = nullptr;
+				for (auto current = m_Head; current; previous = current, current = current->m_NextWaiter) {
+					if (current != &waiter) {
+						continue;
+					}
+
+					(previous ? previous->m_NextWaiter : m_Head) = current->m_NextWaiter;
+					if (m_Tail == current) {
+						m_Tail = previous;
+					}
+					break;
+				}
+				waiter.m_IsQueued = false;
+			}
+
+		private:
+			std::mutex m_Mutex;
+			bool m_IsLocked = false;
+			RawPtr<internal::async::LockWaiter> m_Head = nullptr;
+			RawPtr<internal::async::LockWaiter> m_Tail = nullptr;
+			Type m_Value;
+
+			friend class MutexGuard<Type>;
+		};
+	}
+}
+
+// Async runtime
+#ifdef __linux__
+namespace rs {
+
+	namespace internal::async {
+
+		/*
+		* The readiness of one file descriptor. The reactor bumps the tick of a direction on every event
+		* for it, an io future that got EAGAIN only waits if no event came in since it read the tick.
+		*/
+		class IoSource {
+		public:
+			enum Direction : usize {
+				Read = 0,
+				Write = 1,
+			};
+
+			inline explicit IoSource(int fd)
+				: m_Fd(fd)
+			{
+			}
+
+			inline auto tick(Direction direction) -> u64 {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				return m_Ticks[direction];
+			}
+
+			inline bool is_registered() const {
+				return m_Token != 0;
+			}
+
+			inline void fire(u32 events) {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+					wake_locked(Read);
+				}
+				if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+					wake_locked(Write);
+				}
+			}
+
+		private:
+			inline void wake_locked(Direction direction) {
+				m_Ticks[direction]++;
+				if (auto waiter = std::exchange(m_Waiters[direction], nullptr)) {
+					waiter->wake();
+				}
+			}
+
+		private:
+			std::mutex m_Mutex;
+			std::array<u64, 2> m_Ticks = {};
+			std::array<RawPtr<Node>, 2> m_Waiters = {};
+			int m_Fd;
+			u64 m_Token = 0;
+
+			friend class Readiness;
+			friend class Reactor;
+		};
+
+		/*
+		* Waits until the reactor reports the direction ready after tick, does not wait at all if it already did.
+		*/
+		class Readiness {
+		public:
+			inline Readiness(IoSource& source, IoSource::Direction direction, u64 tick)
+				: m_Source(source),
+				m_Direction(direction),
+				m_Tick(tick)
+			{
+			}
+
+			inline Readiness(const Readiness&) = delete;
+			inline auto operator=(const Readiness&) -> Readiness& = delete;
+
+			inline ~Readiness() {
+				std::lock_guard<std::mutex> lock(m_Source.m_Mutex);
+				if (m_Source.m_Waiters[m_Direction] == &m_Node) {
+					m_Source.m_Waiters[m_Direction] = nullptr;
+				}
+			}
+
+			inline bool await_ready() const { return false; }
+
+			inline bool await_suspend(std::coroutine_handle<> handle) {
+				std::lock_guard<std::mutex> lock(m_Source.m_Mutex);
+				if (m_Source.m_Ticks[m_Direction] != m_Tick) {
+					return false;
+				}
+				m_Node.suspend(handle);
+				m_Source.m_Waiters[m_Direction] = &m_Node;
+				return true;
+			}
+
+			inline void await_resume() const {}
+
+		private:
+			IoSource& m_Source;
+			IoSource::Direction m_Direction;
+			u64 m_Tick;
+			Node m_Node;
+		};
+
+		/*
+		* The epoll reactor of a Runtime. It runs on a thread of its own, waits for the registered file
+		* descriptors (edge triggered, so every descriptor is registered once for both directions) and
+		* for the earliest timer, and hands whatever became ready to the workers.
+		*
+		* The sources are looked up by a token rather than by pointer, so an event that arrives for a
+		* descriptor that was closed meanwhile is simply dropped.
+		*/
+		class Reactor {
+		public:
+			inline Reactor()
+				: m_Epoll(epoll_create1(EPOLL_CLOEXEC)),
+				m_Wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+			{
+				if (m_Epoll < 0 || m_Wake < 0) {
+					throw std::system_error(errno, std::system_category(), "Failed to create the reactor");
+				}
+
+				auto event = epoll_event {};
+				event.events = EPOLLIN;
+				event.data.u64 = 0;
+				epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_Wake, &event);
+
+				m_Thread = std::thread([this] { run(); });
+			}
+
+			inline Reactor(const Reactor&) = delete;
+			inline auto operator=(const Reactor&) -> Reactor& = delete;
+
+			inline ~Reactor() {
+				stop();
+				::close(m_Wake);
+				::close(m_Epoll);
+			}
+
+			// Stops the thread, the sources can still be removed afterwards
+			inline void stop() {
+				if (!m_Thread.joinable()) {
+					return;
+				}
+				m_Stop.store(true, std::memory_order_release);
+				notify();
+				m_Thread.join();
+
+				std::lock_guard<std::mutex> lock(m_TimersMutex);
+				m_Timers.clear();
+			}
+
+			inline auto add_source(IoSource& source) -> std::error_code {
+				std::lock_guard<std::mutex> lock(m_SourcesMutex);
+				source.m_Token = ++m_NextToken;
+
+				auto event = epoll_event {};
+				event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+				event.data.u64 = source.m_Token;
+				if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, source.m_Fd, &event) < 0) {
+					return std::error_code(errno, std::system_category());
+				}
+				m_Sources.emplace(source.m_Token, &source);
+				return std::error_code();
+			}
+
+			inline void remove_source(IoSource& source) {
+				std::lock_guard<std::mutex> lock(m_SourcesMutex);
+				if (m_Sources.erase(source.m_Token) > 0) {
+					epoll_ctl(m_Epoll, EPOLL_CTL_DEL, source.m_Fd, nullptr);
+				}
+			}
+
+			inline void add_timer(Scheduler::Clock::time_point deadline, Node& node) {
+				bool earliest;
+				{
+					std::lock_guard<std::mutex> lock(m_TimersMutex);
+					m_Timers.push_back(Timer { deadline, m_TimerOrder++, &node });
+					std::push_heap(m_Timers.begin(), m_Timers.end());
+					earliest = m_Timers.front().m_Node == &node;
+				}
+
+				// epoll_wait has to pick up the new timeout
+				if (earliest) {
+					notify();
+				}
+			}
+
+		private:
+			struct Timer {
+				Scheduler::Clock::time_point m_Deadline;
+				u64 m_Order;
+				RawPtr<Node> m_Node;
+
+				inline bool operator<(const Timer& other) const {
+					return std::tie(other.m_Deadline, other.m_Order) < std::tie(m_Deadline, m_Order);
+				}
+			};
+
+			inline void notify() {
+				u64 one = 1;
+				[[maybe_unused]] auto written = ::write(m_Wake, &one, sizeof(one));
+			}
+
+			// Milliseconds until the earliest timer rounded up, -1 without timers
+			inline int timeout() {
+				std::lock_guard<std::mutex> lock(m_TimersMutex);
+				if (m_Timers.empty()) {
+					return -1;
+				}
+				auto left = m_Timers.front().m_Deadline - Scheduler::Clock::now();
+				auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(left).count();
+				return static_cast<int>(std::clamp<i64>(milliseconds, 0, std::numeric_limits<int>::max()));
+			}
+
+			inline void run() {
+				auto events = std::array<epoll_event, 256>();
+				auto expired = std::vector<RawPtr<Node>>();
+
+				while (!m_Stop.load(std::memory_order_acquire)) {
+					auto count = epoll_wait(m_Epoll, events.data(), static_cast<int>(events.size()), timeout());
+
+					if (count > 0) {
+						std::lock_guard<std::mutex> lock(m_SourcesMutex);
+						for (auto& event : std::span(events.data(), static_cast<usize>(count))) {
+							if (event.data.u64 == 0) {
+								u64 value;
+								[[maybe_unused]] auto read = ::read(m_Wake, &value, sizeof(value));
+								continue;
+							}
+							if (auto found = m_Sources.find(event.data.u64); found != m_Sources.end()) {
+								found->second->fire(event.events);
+							}
+						}
+					}
+
+					{
+						std::lock_guard<std::mutex> lock(m_TimersMutex);
+						auto now = Scheduler::Clock::now();
+						while (!m_Timers.empty() && m_Timers.front().m_Deadline <= now) {
+							std::pop_heap(m_Timers.begin(), m_Timers.end());
+							expired.push_back(m_Timers.back().m_Node);
+							m_Timers.pop_back();
+						}
+					}
+					for (auto node : expired) {
+						node->wake();
+					}
+					expired.clear();
+				}
+			}
+
+		private:
+			int m_Epoll;
+			int m_Wake;
+			std::thread m_Thread;
+			std::atomic_bool m_Stop = false;
+
+			std::mutex m_SourcesMutex;
+			std::unordered_map<u64, RawPtr<IoSource>> m_Sources;
+			u64 m_NextToken = 0;
+
+			std::mutex m_TimersMutex;
+			std::vector<Timer> m_Timers;
+			u64 m_TimerOrder = 0;
+		};
+
+		// block_on waits on this instead of the task being destroyed when it completes
+		class RootLatch : public Owner {
+		public:
+			inline void finish(PromiseBase&, std::coroutine_handle<>) override {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_IsSet = true;
+				m_Condition.notify_one();
+			}
+
+			inline void wait() {
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this] { return m_IsSet; });
+			}
+
+		private:
+			std::mutex m_Mutex;
+			std::condition_variable m_Condition;
+			bool m_IsSet = false;
+		};
+
+		inline auto io_error() {
+			return std::error_code(errno, std::system_category());
+		}
+
+		inline bool would_block() {
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		// The reactor of the Runtime running on this thread, the io types check for it before they
+		// open a file descriptor so a misuse throws without leaking one
+		inline auto runtime_reactor() -> RawPtr<Reactor> {
+			auto reactor = Scheduler::running().reactor();
+			if (!reactor) {
+				throw std::logic_error("The io types need a Runtime, an Executor has no reactor");
+			}
+			return reactor;
+		}
+	}
+
+	/*
+	* The multi threaded runtime. The tasks run on a work stealing thread pool of its own, every
+	* worker has a local queue and steals from the others when it runs dry, and an epoll reactor
+	* thread drives the timers and the io types in rs::io and rs::net.
+	*
+	* Tasks move between the workers, so what they return has to be Send. What a task keeps across
+	* a co_await is only ever used by one thread at a time, so a Val held there is still fine.
+	*/
+	class Runtime : public internal::async::Scheduler {
+	public:
+		inline explicit Runtime(usize workers = internal::pool::ThreadPool::default_threads())
+			: m_Pool(std::make_unique<internal::pool::ThreadPool>(workers)),
+			m_Reactor(std::make_unique<internal::async::Reactor>())
+		{
+		}
+
+		inline Runtime(const Runtime&) = delete;
+		inline auto operator=(const Runtime&) -> Runtime& = delete;
+
+		// Nothing wakes or runs the tasks anymore once the reactor and the workers stopped, then the spawned ones are dropped
+		inline ~Runtime() {
+			m_Reactor->stop();
+			m_Pool.reset();
+
+			while (m_Spawned) {
+				auto promise = m_Spawned;
+				unlink(*promise);
+				promise->m_Node.m_Handle.destroy();
+			}
+		}
+
+		inline usize num_workers() const {
+			return m_Pool->num_threads();
+		}
+
+		/*
+		* Runs the task on the workers, an exception escaping it is rethrown from the next block_on().
+		*/
+		template<typename Type>
+		inline void spawn(Task<Type> task) {
+			static_assert(Send<Type>, "A task spawned on a Runtime must return something Send, use the ThreadSafe types");
+
+			auto handle = std::exchange(task.m_Handle, nullptr);
+			auto& promise = handle.promise();
+			promise.m_Owner = this;
+			{
+				std::lock_guard<std::mutex> lock(m_SpawnedMutex);
+				promise.m_Next = m_Spawned;
+				if (m_Spawned) {
+					m_Spawned->m_Prev = &promise;
+				}
+				m_Spawned = &promise;
+			}
+
+			promise.m_Node.m_Handle = handle;
+			promise.m_Node.m_Scheduler = this;
+			schedule(promise.m_Node);
+		}
+
+		/*
+		* Runs the task on the workers and blocks the calling thread until it is complete.
+		*/
+		template<typename Type>
+		inline auto block_on(Task<Type> task) -> Type {
+			if (internal::async::t_Scheduler == this) {
+				throw std::logic_error("block_on can not be called from a task of the same runtime");
+			}
+
+			auto latch = internal::async::RootLatch();
+			auto& promise = task.m_Handle.promise();
+			promise.m_Owner = &latch;
+			promise.m_Node.m_Handle = task.m_Handle;
+			promise.m_Node.m_Scheduler = this;
+			schedule(promise.m_Node);
+			latch.wait();
+
+			{
+				std::lock_guard<std::mutex> lock(m_SpawnedMutex);
+				if (m_Error) {
+					std::rethrow_exception(std::exchange(m_Error, nullptr));
+				}
+			}
+			return promise.take();
+		}
+
+	private:
+		inline void schedule(internal::async::Node& node) override {
+			m_Pool->submit(&node);
+		}
+
+		inline void add_timer(Clock::time_point deadline, internal::async::Node& node) override {
+			m_Reactor->add_timer(deadline, node);
+		}
+
+		inline auto reactor() -> RawPtr<internal::async::Reactor> override {
+			return m_Reactor.get();
+		}
+
+		inline void finish(internal::async::PromiseBase& promise, std::coroutine_handle<> handle) override {
+			{
+				std::lock_guard<std::mutex> lock(m_SpawnedMutex);
+				unlink(promise);
+				if (promise.m_Error && !m_Error) {
+					m_Error = promise.m_Error;
+				}
+			}
+			handle.destroy();
+		}
+
+		inline void unlink(internal::async::PromiseBase& promise) {
+			if (promise.m_Prev) {
+				promise.m_Prev->m_Next = promise.m_Next;
+			}
+			else {
+				m_Spawned = promise.m_Next;
+			}
+			if (promise.m_Next) {
+				promise.m_Next->m_Prev = promise.m_Prev;
+			}
+		}
+
+	private:
+		std::unique_ptr<internal::pool::ThreadPool> m_Pool;
+		std::unique_ptr<internal::async::Reactor> m_Reactor;
+		std::mutex m_SpawnedMutex;
+		RawPtr<internal::async::PromiseBase> m_Spawned = nullptr;
+		std::exception_ptr m_Error;
+	};
+
+	namespace io {
+
+		/*
+		* A non blocking file descriptor registered with the reactor of the running Runtime, it is
+		* closed when dropped. It has to be created on the Runtime and must not outlive it.
+		*/
+		class AsyncFd {
+		public:
+			/*
+			* Takes ownership of fd and switches it to non blocking mode, fd is closed if this throws.
+			*/
+			static inline auto from_raw_fd(int fd) -> Result<AsyncFd, std::error_code> {
+				auto reactor = RawPtr<internal::async::Reactor>(nullptr);
+				auto source = std::unique_ptr<internal::async::IoSource>();
+				try {
+					reactor = internal::async::runtime_reactor();
+					source = std::make_unique<internal::async::IoSource>(fd);
+				}
+				catch (...) {
+					::close(fd);
+					throw;
+				}
+
+				auto async = AsyncFd(fd, reactor, std::move(source));
+				if (auto flags = fcntl(fd, F_GETFL); flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+					return Err<AsyncFd, std::error_code>(internal::async::io_error());
+				}
+
+				struct stat status;
+				async.m_IsSocket = fstat(fd, &status) == 0 && S_ISSOCK(status.st_mode);
+
+				if (auto error = reactor->add_source(*async.m_Source)) {
+					return Err<AsyncFd, std::error_code>(std::move(error));
+				}
+				return Ok<AsyncFd, std::error_code>(std::move(async));
+			}
+
+			inline AsyncFd(AsyncFd&& other) noexcept
+				: m_Fd(std::exchange(other.m_Fd, -1)),
+				m_IsSocket(other.m_IsSocket),
+				m_Reactor(other.m_Reactor),
+				m_Source(std::move(other.m_Source))
+			{
+			}
+
+			inline auto operator=(AsyncFd&& other) noexcept -> AsyncFd& {
+				if (this != &other) {
+					close();
+					m_Fd = std::exchange(other.m_Fd, -1);
+					m_IsSocket = other.m_IsSocket;
+					m_Reactor = other.m_Reactor;
+					m_Source = std::move(other.m_Source);
+				}
+				return *this;
+			}
+
+			inline ~AsyncFd() {
+				close();
+			}
+
+			inline int as_raw_fd() const {
+				return m_Fd;
+			}
+
+			/*
+			* Reads into buffer and gives the number of bytes read, 0 at the end of the stream.
+			*/
+			inline auto read(SliceMut<u8> buffer) -> Task<Result<usize, std::error_code>> {
+				for (;;) {
+					auto tick = m_Source->tick(internal::async::IoSource::Read);
+					auto count = ::read(m_Fd, buffer.as_ptr(), buffer.len());
+					if (count >= 0) {
+						co_return Ok<usize, std::error_code>(static_cast<usize>(count));
+					}
+					if (internal::async::would_block()) {
+						co_await internal::async::Readiness(*m_Source, internal::async::IoSource::Read, tick);
+					}
+					else if (errno != EINTR) {
+						co_return Err<usize, std::error_code>(internal::async::io_error());
+					}
+				}
+			}
+
+			/*
+			* Writes some of buffer and gives the number of bytes written.
+			*/
+			inline auto write(Slice<u8> buffer) -> Task<Result<usize, std::error_code>> {
+				for (;;) {
+					auto tick = m_Source->tick(internal::async::IoSource::Write);
+					auto count = write_some(buffer.as_ptr(), buffer.len());
+					if (count >= 0) {
+						co_return Ok<usize, std::error_code>(static_cast<usize>(count));
+					}
+					if (internal::async::would_block()) {
+						co_await internal::async::Readiness(*m_Source, internal::async::IoSource::Write, tick);
+					}
+					else if (errno != EINTR) {
+						co_return Err<usize, std::error_code>(internal::async::io_error());
+					}
+				}
+			}
+
+			/*
+			* Writes the whole buffer.
+			*/
+			inline auto write_all(Slice<u8> buffer) -> Task<Result<usize, std::error_code>> {
+				usize written = 0;
+				while (written < buffer.len()) {
+					auto tick = m_Source->tick(internal::async::IoSource::Write);
+					auto count = write_some(buffer.as_ptr() + written, buffer.len() - written);
+					if (count >= 0) {
+						written += static_cast<usize>(count);
+					}
+					else if (internal::async::would_block()) {
+						co_await internal::async::Readiness(*m_Source, internal::async::IoSource::Write, tick);
+					}
+					else if (errno != EINTR) {
+						co_return Err<usize, std::error_code>(internal::async::io_error());
+					}
+				}
+				co_return Ok<usize, std::error_code>(std::move(written));
+			}
+
+		protected:
+			inline AsyncFd(int fd, RawPtr<internal::async::Reactor> reactor, std::unique_ptr<internal::async::IoSource> source) noexcept
+				: m_Fd(fd),
+				m_Reactor(reactor),
+				m_Source(std::move(source))
+			{
+			}
+
+			// Waits until the reactor reports the direction ready again after tick
+			inline auto ready(internal::async::IoSource::Direction direction, u64 tick) {
+				return internal::async::Readiness(*m_Source, direction, tick);
+			}
+
+			inline auto tick(internal::async::IoSource::Direction direction) -> u64 {
+				return m_Source->tick(direction);
+			}
+
+		private:
+			// Sockets are written with MSG_NOSIGNAL, a closed peer gives EPIPE instead of SIGPIPE
+			inline auto write_some(RawPtr<const u8> data, usize len) -> ssize_t {
+				if (m_IsSocket) {
+					return ::send(m_Fd, data, len, MSG_NOSIGNAL);
+				}
+				return ::write(m_Fd, data, len);
+			}
+
+			inline void close() {
+				if (m_Fd < 0) {
+					return;
+				}
+				if (m_Source->is_registered()) {
+					m_Reactor->remove_source(*m_Source);
+				}
+				::close(m_Fd);
+				m_Fd = -1;
+			}
+
+		private:
+			int m_Fd;
+			bool m_IsSocket = false;
+			RawPtr<internal::async::Reactor> m_Reactor;
+			std::unique_ptr<internal::async::IoSource> m_Source;
+		};
+
+		/*
+		* Creates a pipe, the first one is the reading end and the second one the writing end.
+		*/
+		inline auto pipe() -> Result<std::pair<AsyncFd, AsyncFd>, std::error_code> {
+			internal::async::runtime_reactor();
+
+			int fds[2];
+			if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+				return Err<std::pair<AsyncFd, AsyncFd>, std::error_code>(internal::async::io_error());
+			}
+
+			// from_raw_fd closes the reading end if it throws, the writing end is not owned yet
+			auto reader = [&] {
+				try {
+					return AsyncFd::from_raw_fd(fds[0]);
+				}
+				catch (...) {
+					::close(fds[1]);
+					throw;
+				}
+			}();
+			auto writer = AsyncFd::from_raw_fd(fds[1]);
+			if (reader.is_err() || writer.is_err()) {
+				auto error = reader.is_err() ? *reader.unwrap_err() : *writer.unwrap_err();
+				return Err<std::pair<AsyncFd, AsyncFd>, std::error_code>(std::move(error));
+			}
+			return Ok<std::pair<AsyncFd, AsyncFd>, std::error_code>(std::pair(std::move(*reader.unwrap()), std::move(*writer.unwrap())));
+		}
+
+		/*
+		* An eventfd, a counter that tasks can wait on and that anything (also other threads) can bump.
+		*/
+		class EventFd : public AsyncFd {
+		public:
+			static inline auto create(u64 initial = 0) -> Result<EventFd, std::error_code> {
+				auto fd = ::eventfd(static_cast<unsigned int>(initial), EFD_NONBLOCK | EFD_CLOEXEC);
+				if (fd < 0) {
+					return Err<EventFd, std::error_code>(internal::async::io_error());
+				}
+
+				auto async = AsyncFd::from_raw_fd(fd);
+				if (async.is_err()) {
+					return Err<EventFd, std::error_code>(std::move(*async.unwrap_err()));
+				}
+				return Ok<EventFd, std::error_code>(EventFd(std::move(*async.unwrap())));
+			}
+
+			/*
+			* Adds value to the counter, waking up a waiting task.
+			*/
+			inline auto notify(u64 value = 1) -> std::error_code {
+				if (::eventfd_write(as_raw_fd(), value) < 0) {
+					return internal::async::io_error();
+				}
+				return std::error_code();
+			}
+
+			/*
+			* Waits until the counter is not zero, gives its value and resets it.
+			*/
+			inline auto wait() -> Task<Result<u64, std::error_code>> {
+				for (;;) {
+					auto before = tick(internal::async::IoSource::Read);
+					eventfd_t value;
+					if (::eventfd_read(as_raw_fd(), &value) == 0) {
+						co_return Ok<u64, std::error_code>(static_cast<u64>(value));
+					}
+					if (internal::async::would_block()) {
+						co_await ready(internal::async::IoSource::Read, before);
+					}
+					else if (errno != EINTR) {
+						co_return Err<u64, std::error_code>(internal::async::io_error());
+					}
+				}
+			}
+
+		private:
+			inline explicit EventFd(AsyncFd&& fd)
+				: AsyncFd(std::move(fd))
+			{
+			}
+		};
+	}
+
+	namespace net {
+
+		/*
+		* A TCP connection, reads and writes are those of io::AsyncFd. Nagle's algorithm is turned off.
+		*/
+		class TcpStream : public io::AsyncFd {
+		public:
+			/*
+			* Connects to an IPv4 address like "127.0.0.1".
+			*/
+			static inline auto connect(str host, u16 port) -> Task<Result<TcpStream, std::error_code>> {
+				auto address = sockaddr_in {};
+				address.sin_family = AF_INET;
+				address.sin_port = htons(port);
+				if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+					co_return Err<TcpStream, std::error_code>(std::make_error_code(std::errc::invalid_argument));
+				}
+
+				rs::internal::async::runtime_reactor();
+				auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+				if (fd < 0) {
+					co_return Err<TcpStream, std::error_code>(rs::internal::async::io_error());
+				}
+
+				auto async = AsyncFd::from_raw_fd(fd);
+				if (async.is_err()) {
+					co_return Err<TcpStream, std::error_code>(std::move(*async.unwrap_err()));
+				}
+				auto stream = TcpStream(std::move(*async.unwrap()));
+
+				auto before = stream.tick(rs::internal::async::IoSource::Write);
+				if (::connect(fd, reinterpret_cast<RawPtr<sockaddr>>(&address), sizeof(address)) < 0) {
+					if (errno != EINPROGRESS) {
+						co_return Err<TcpStream, std::error_code>(rs::internal::async::io_error());
+					}
+
+					co_await stream.ready(rs::internal::async::IoSource::Write, before);
+
+					int error = 0;
+					auto length = static_cast<socklen_t>(sizeof(error));
+					getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+					if (error != 0) {
+						co_return Err<TcpStream, std::error_code>(std::error_code(error, std::system_category()));
+					}
+				}
+
+				stream.set_nodelay();
+				co_return Ok<TcpStream, std::error_code>(std::move(stream));
+			}
+
+		private:
+			inline explicit TcpStream(io::AsyncFd&& fd)
+				: AsyncFd(std::move(fd))
+			{
+			}
+
+			inline void set_nodelay() {
+				int one = 1;
+				setsockopt(as_raw_fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			}
+
+			friend class TcpListener;
+		};
+
+		/*
+		* A listening TCP socket.
+		*/
+		class TcpListener : public io::AsyncFd {
+		public:
+			/*
+			* Listens on an IPv4 address like "127.0.0.1", port 0 picks a free one (see local_port).
+			*/
+			static inline auto bind(str host, u16 port) -> Result<TcpListener, std::error_code> {
+				auto address = sockaddr_in {};
+				address.sin_family = AF_INET;
+				address.sin_port = htons(port);
+				if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+					return Err<TcpListener, std::error_code>(std::make_error_code(std::errc::invalid_argument));
+				}
+
+				rs::internal::async::runtime_reactor();
+				auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+				if (fd < 0) {
+					return Err<TcpListener, std::error_code>(rs::internal::async::io_error());
+				}
+
+				int one = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+				if (::bind(fd, reinterpret_cast<RawPtr<sockaddr>>(&address), sizeof(address)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+					auto error = rs::internal::async::io_error();
+					::close(fd);
+					return Err<TcpListener, std::error_code>(std::move(error));
+				}
+
+				auto async = AsyncFd::from_raw_fd(fd);
+				if (async.is_err()) {
+					return Err<TcpListener, std::error_code>(std::move(*async.unwrap_err()));
+				}
+				return Ok<TcpListener, std::error_code>(TcpListener(std::move(*async.unwrap())));
+			}
+
+			inline auto local_port() const -> u16 {
+				auto address = sockaddr_in {};
+				auto length = static_cast<socklen_t>(sizeof(address));
+				getsockname(as_raw_fd(), reinterpret_cast<RawPtr<sockaddr>>(&address), &length);
+				return ntohs(address.sin_port);
+			}
+
+			/*
+			* Waits for the next connection.
+			*/
+			inline auto accept() -> Task<Result<TcpStream, std::error_code>> {
+				for (;;) {
+					auto before = tick(rs::internal::async::IoSource::Read);
+					auto fd = ::accept4(as_raw_fd(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+					if (fd >= 0) {
+						auto async = AsyncFd::from_raw_fd(fd);
+						if (async.is_err()) {
+							co_return Err<TcpStream, std::error_code>(std::move(*async.unwrap_err()));
+						}
+						auto stream = TcpStream(std::move(*async.unwrap()));
+						stream.set_nodelay();
+						co_return Ok<TcpStream, std::error_code>(std::move(stream));
+					}
+					if (rs::internal::async::would_block()) {
+						co_await ready(rs::internal::async::IoSource::Read, before);
+					}
+					else if (errno != EINTR && errno != ECONNABORTED) {
+						co_return Err<TcpStream, std::error_code>(rs::internal::async::io_error());
+					}
+				}
+			}
+
+		private:
+			inline explicit TcpListener(io::AsyncFd&& fd)
+				: AsyncFd(std::move(fd))
+			{
+			}
+		};
+	}
+}
+#endif
+
+
+// the print proxy for all the types
+namespace rs {
+
+	template<bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const ValidityCheckBlock<ThreadSafe>& a) -> std::ostream& {
+		return os << typeid(a).name() << " { is_valid: " << a.is_valid() << " }";
+	}
+
+	template<bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const ValidityChecker<ThreadSafe>& a) -> std::ostream& {
+		if (a.is_null()) {
+			return os << typeid(a).name() << " { is_null: true }";
+		}
+		return os << typeid(a).name() << " { is_valid: " << a.is_valid() << ", ref_count: " << a.ref_count() << " }";
+	}
+
+	template<typename Type, bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const ValRaw<Type, ThreadSafe>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { value: " << *a.value() << " }";
+	}
+
+	template<typename Type, bool Mutable, bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const RefRaw<Type, Mutable, ThreadSafe>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { value: " << *a.value() << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const ArenaVal<Type>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { value: " << *a.value() << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const PooledVal<Type>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { value: " << *a.value() << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const Box<Type>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { value: " << *a << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const Cow<Type>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		return os << typeid(a).name() << " { is_owned: " << std::boolalpha << a.is_owned() << ", value: " << *a << " }";
+	}
+
+	// At least one variant, so that deducing it from os << std::endl fails instead of naming Enum<>
+	template<typename First, typename... Rest>
+	inline auto operator<<(std::ostream& os, const Enum<First, Rest...>& a) -> std::ostream& {
+		os << typeid(a).name() << " { index: " << a.index() << ", value: ";
+		match(a, [&](const auto& value) { os << value; });
+		return os << " }";
+	}
+
+	template<typename Type, bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const OptionRaw<Type, ThreadSafe>& a) -> std::ostream& {
+		if (a.is_some()) {
+			return os << typeid(a).name() << " { is_some: true, value: " << *a.unsafe_ptr() << " }";
+		}
+		return os << typeid(a).name() << " { is_some: false }";
+	}
+
+	template<typename Type, typename Err, bool ThreadSafe>
+	inline auto operator<<(std::ostream& os, const ResultRaw<Type, Err, ThreadSafe>& a) -> std::ostream& {
+		if (a.is_ok()) {
+			return os << typeid(a).name() << " { Ok, value: " << *a.unsafe_ptr() << " }";
+		}
+		return os << typeid(a).name() << " { Err, error: " << *a.unsafe_error_ptr() << " }";
+	}
+
+	namespace internal {
+		template<typename Range>
+		inline auto print_elements(std::ostream& os, const Range& range) -> std::ostream& {
+			os << "[";
+			auto first = true;
+			for (const auto& value : range) {
+				if (!first) {
+					os << ", ";
+				}
+				os << value;
+				first = false;
+			}
+			return os << "]";
+		}
+	}
+
+	template<typename Type, usize InlineCapacity, typename Growth>
+	inline auto operator<<(std::ostream& os, const VecRaw<Type, InlineCapacity, Growth>& a) -> std::ostream& {
+		os << typeid(a).name() << " { len: " << a.len() << ", values: ";
+		return internal::print_elements(os, a) << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const Box<Type[]>& a) -> std::ostream& {
+		os << typeid(a).name() << " { len: " << a.len() << ", values: ";
+		return internal::print_elements(os, a) << " }";
+	}
+
+	template<typename Type>
+	inline auto operator<<(std::ostream& os, const SlotMap<Type>& a) -> std::ostream& {
+		os << typeid(a).name() << " { len: " << a.len() << ", values: [";
+		auto first = true;
+		// iterating borrows the map, which only touches its borrow count
+		for (const auto& value : a.iter()) {
+			if (!first) {
+				os << ", ";
+			}
+			os << value;
+			first = false;
+		}
+		return os << "] }";
+	}
+
+	template<typename Key, typename Value, typename Hasher>
+	inline auto operator<<(std::ostream& os, const HashMap<Key, Value, Hasher>& a) -> std::ostream& {
+		os << typeid(a).name() << " { len: " << a.len() << ", values: {";
+		auto first = true;
+		// iterating borrows the map, which only touches its borrow count
+		for (const auto& [key, value] : a.iter()) {
+			if (!first) {
+				os << ", ";
+			}
+			os << key << ": " << value;
+			first = false;
+		}
+		return os << "} }";
+	}
+
+	template<typename Key, typename Hasher>
+	inline auto operator<<(std::ostream& os, const HashSet<Key, Hasher>& a) -> std::ostream& {
+		os << typeid(a).name() << " { len: " << a.len() << ", values: {";
+		auto first = true;
+		for (const auto& key : a.iter()) {
+			if (!first) {
+				os << ", ";
+			}
+			os << key;
+			first = false;
+		}
+		return os << "} }";
+	}
+
+	template<typename Type, bool Mutable>
+	inline auto operator<<(std::ostream& os, const SliceRaw<Type, Mutable>& a) -> std::ostream& {
+		if (!a.is_valid()) {
+			return os << typeid(a).name() << " { is_valid: false }";
+		}
+		os << typeid(a).name() << " { len: " << a.len() << ", values: ";
+		return internal::print_elements(os, a) << " }";
+	}
+
+	namespace thread {
+
+		inline auto operator<<(std::ostream& os, const Panic& a) -> std::ostream& {
+			return os << typeid(a).name() << " { what: " << a.what() << " }";
+		}
+
+		inline auto operator<<(std::ostream& os, const Unit& a) -> std::ostream& {
+			return os << typeid(a).name() << " { }";
+		}
+	}
+}
+
+#ifdef RS_EXPORT
+
+namespace std {
+	template<bool ThreadSafe>
+	struct formatter<rs::ValidityCheckBlock<ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::ValidityCheckBlock<ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<bool ThreadSafe>
+	struct formatter<rs::ValidityChecker<ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::ValidityChecker<ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, bool ThreadSafe>
+	struct formatter<rs::ValRaw<Type, ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::ValRaw<Type, ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, bool Mutable, bool ThreadSafe>
+	struct formatter<rs::RefRaw<Type, Mutable, ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::RefRaw<Type, Mutable, ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::ArenaVal<Type>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::ArenaVal<Type>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::PooledVal<Type>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::PooledVal<Type>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::Box<Type>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::Box<Type>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::Box<Type[]>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::Box<Type[]>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::Cow<Type>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::Cow<Type>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename... Variants>
+	struct formatter<rs::Enum<Variants...>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::Enum<Variants...>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, bool ThreadSafe>
+	struct formatter<rs::OptionRaw<Type, ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::OptionRaw<Type, ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, typename Err, bool ThreadSafe>
+	struct formatter<rs::ResultRaw<Type, Err, ThreadSafe>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::ResultRaw<Type, Err, ThreadSafe>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, rs::usize InlineCapacity, typename Growth>
+	struct formatter<rs::VecRaw<Type, InlineCapacity, Growth>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::VecRaw<Type, InlineCapacity, Growth>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type>
+	struct formatter<rs::SlotMap<Type>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::SlotMap<Type>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Key, typename Value, typename Hasher>
+	struct formatter<rs::HashMap<Key, Value, Hasher>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::HashMap<Key, Value, Hasher>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Key, typename Hasher>
+	struct formatter<rs::HashSet<Key, Hasher>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::HashSet<Key, Hasher>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+
+	template<typename Type, bool Mutable>
+	struct formatter<rs::SliceRaw<Type, Mutable>>
+	{
+		template<typename ParseContext>
+		constexpr auto parse(ParseContext& ctx) { return ctx.begin(); }
+		template<typename FormatContext>
+		auto format(const rs::SliceRaw<Type, Mutable>& value, FormatContext& ctx) const
+		{
+			auto ss = std::stringstream();
+			ss << value;
+			return format_to(ctx.out(), "{}", ss.str());
+		}
+	};
+}
+
+RS_FORMATTER_GENERATOR(rs::thread::Panic)
+RS_FORMATTER_GENERATOR(rs::thread::Unit)
+
+#endif
+
+// Traits for C++
+
+namespace rs {
+
+    namespace internal {
+        constexpr auto hash_string(const char* input) {
+            usize hash = sizeof(usize) == 8 ? 0xcbf29ce484222325 : 0x811c9dc5;
+            const size_t prime = sizeof(usize) == 8 ? 0x00000100000001b3 : 0x01000193;
+
+            while (*input) {
+                hash ^= static_cast<usize>(*input);
+                hash *= prime;
+                ++input;
+            }
+
+                return hash;
+        }
+
+        template <auto T> 
+        constexpr auto get_type_hash()
+        {
+            #ifdef _MSC_VER
+            return hash_string(__FUNCSIG__);
+            #else
+            return hash_string(__PRETTY_FUNCTION__);
+            #endif
+        }
+
+        template<typename... T>
+        struct func_types;
+
+        template<typename RetType, typename Class, typename... ValTypes> 
+        struct func_types<RetType(Class::*)(ValTypes...)> {
+            using ParamsType = std::tuple<ValTypes...>;
+			using ParamsTypeWithContext = std::tuple<void*, ValTypes...>;
+            using ReturnType = RetType;
+            using ClassType = Class;
+            using FunctionType = RetType(ValTypes...);
+            using FunctionTypeWithContext = RetType(void*, ValTypes...);
+            static constexpr bool IsConst = false;
+        };
+
+        template<typename RetType, typename Class, typename... ValTypes> 
+        struct func_types<RetType(Class::*)(ValTypes...) const> : func_types<RetType(Class::*)(ValTypes...)> {
+            static constexpr bool IsConst = true;
+        };
+    }
 
 
     // The main trait object
@@ -1771,7 +12812,7 @@ namespace rs {
 		using CallerType = typename FuncType::FunctionTypeWithContext*;
 
         template<auto ptr>
-        constexpr auto get_caller() {
+        constexpr auto get_caller() const {
   	        if constexpr (internal::get_type_hash<This>() == internal::get_type_hash<ptr>()) {
     	        return Caller;
             } else {
@@ -1802,8 +12843,141 @@ namespace rs {
 	};
 
 
+    // A const trait method has to be implemented by a const method, as it can be called through a TraitRef
     template <auto A, auto B>
-    concept MatchFunctionPointers = std::is_same_v<typename internal::func_types<decltype(A)>::FunctionType, typename internal::func_types<decltype(B)>::FunctionType>;
+    concept MatchFunctionPointers = std::is_same_v<typename internal::func_types<decltype(A)>::FunctionType, typename internal::func_types<decltype(B)>::FunctionType>
+        && (!internal::func_types<decltype(A)>::IsConst || internal::func_types<decltype(B)>::IsConst);
+
+
+	/*
+	* A trait object which also holds on to the borrow it was made from.
+	*
+	* TraitRef<T> is made from a Ref and only exposes the trait methods declared const,
+	* TraitRefMut<T> is made from a RefMut and exposes all of them. The borrow is released
+	* when the view is dropped. Every call checks that the borrowed value is still alive,
+	* which is a single branch in checked mode and nothing at all when RS_CHECKED is 0.
+	*/
+	template<typename Type, bool Mutability>
+	class TraitView {
+	public:
+		inline TraitView(TraitView&& other) noexcept
+			: m_Trait(other.m_Trait),
+			m_Borrow(std::move(other.m_Borrow)),
+			m_Alive(other.m_Alive)
+		{
+			other.m_Alive = &s_Dropped;
+		}
+
+		inline TraitView(const TraitView& other) requires(!Mutability)
+			: m_Trait(other.m_Trait),
+			m_Borrow(other.m_Borrow.share()),
+			m_Alive(other.m_Alive)
+		{
+		}
+
+		inline auto operator=(TraitView&& other) noexcept -> TraitView& {
+			if (this != &other) {
+				m_Trait = other.m_Trait;
+				m_Borrow = std::move(other.m_Borrow);
+				m_Alive = other.m_Alive;
+				other.m_Alive = &s_Dropped;
+			}
+			return *this;
+		}
+
+		inline auto operator=(const TraitView& other) -> TraitView& requires(!Mutability) {
+			if (this != &other) {
+				m_Trait = other.m_Trait;
+				m_Borrow = other.m_Borrow.share();
+				m_Alive = other.m_Alive;
+			}
+			return *this;
+		}
+
+		inline ~TraitView() = default;
+
+		inline bool is_valid() const {
+			return m_Borrow.is_valid();
+		}
+
+		inline operator bool() const {
+			return is_valid();
+		}
+
+		// Releases the borrow, the view can not be used after this
+		inline void drop() {
+			m_Borrow.drop();
+			m_Alive = &s_Dropped;
+		}
+
+		inline auto operator->() const -> const trait<Type>* {
+			check();
+			return &m_Trait;
+		}
+
+		inline auto operator->() -> trait<Type>* requires(Mutability) {
+			check();
+			return &m_Trait;
+		}
+
+		inline auto operator*() const -> const trait<Type>& {
+			check();
+			return m_Trait;
+		}
+
+		inline auto operator*() -> trait<Type>& requires(Mutability) {
+			check();
+			return m_Trait;
+		}
+
+		inline constexpr bool is_ref_mutable() const {
+			return Mutability;
+		}
+
+	private:
+		inline TraitView(const trait<Type>& t, RefRaw<void, Mutability, false>&& borrow)
+			: m_Trait(t),
+			m_Borrow(std::move(borrow)),
+			m_Alive(m_Borrow.m_DropCheck.is_null() ? &s_Unchecked : m_Borrow.m_DropCheck.validity_flag())
+		{
+		}
+
+		// A Ref is shared with the view, a RefMut is moved into it
+		template<typename GenericType>
+		static inline auto from(const trait<Type>& t, RefRaw<GenericType, Mutability, false>& ref) {
+			if constexpr (Mutability) {
+				return TraitView(t, ref.erase());
+			}
+			else {
+				return TraitView(t, ref.share().erase());
+			}
+		}
+
+		inline void check() const {
+#if RS_CHECKED
+			if (!*m_Alive) {
+				throw RefValueExpiredException();
+			}
+#endif
+		}
+
+	private:
+		trait<Type> m_Trait;
+		RefRaw<void, Mutability, false> m_Borrow;
+		const bool* m_Alive;
+
+		static inline const bool s_Dropped = false;
+		static inline const bool s_Unchecked = true;
+
+		template<typename Ty>
+		friend struct trait;
+	};
+
+	template<typename Type>
+	using TraitRef = TraitView<Type, false>;
+
+	template<typename Type>
+	using TraitRefMut = TraitView<Type, true>;
 
 
 }
@@ -1841,6 +13015,15 @@ inline internal::func_types<decltype(&type::method)>::ReturnType method(FnArgs..
 	} else { \
 		return get_caller<&type::method>()(m_This, std::forward<FnArgs>(args)...); \
 	} \
+} \
+template<typename... FnArgs> \
+requires (std::is_same_v<internal::func_types<decltype(&type::method)>::ParamsType, std::tuple<FnArgs...>> && internal::func_types<decltype(&type::method)>::IsConst) \
+inline internal::func_types<decltype(&type::method)>::ReturnType method(FnArgs... args) const { \
+	if constexpr (std::is_same_v<internal::func_types<decltype(&type::method)>::ReturnType, void>) { \
+		get_caller<&type::method>()(m_This, std::forward<FnArgs>(args)...); \
+	} else { \
+		return get_caller<&type::method>()(m_This, std::forward<FnArgs>(args)...); \
+	} \
 }
 
 #define rs__macro_foreach_1(func, sep, type, method, ...)  func(type, method)
@@ -1904,6 +13087,34 @@ struct rs::trait<type> : public rs::trait_methods< rs__macro_make_type_methods(t
 		t.m_This = type_val; \
 		return t; \
     } \
+ \
+    template <typename GenericType> \
+    rs__macro_create_generic_type_contraint(type, GenericType, __VA_ARGS__) \
+    static auto make(rs::Ref<GenericType>& type_ref) \
+    { \
+        return rs::TraitRef<type>::from(make(const_cast<GenericType*>(type_ref.value())), type_ref); \
+    } \
+ \
+    template <typename GenericType> \
+    rs__macro_create_generic_type_contraint(type, GenericType, __VA_ARGS__) \
+    static auto make(rs::RefMut<GenericType>& type_ref) \
+    { \
+        return rs::TraitRefMut<type>::from(make(type_ref.value()), type_ref); \
+    } \
+ \
+    template <typename GenericType> \
+    rs__macro_create_generic_type_contraint(type, GenericType, __VA_ARGS__) \
+    static auto make(rs::Val<rs::Ref<GenericType>>& type_ref) \
+    { \
+        return make(*type_ref.raw()); \
+    } \
+ \
+    template <typename GenericType> \
+    rs__macro_create_generic_type_contraint(type, GenericType, __VA_ARGS__) \
+    static auto make(rs::Val<rs::RefMut<GenericType>>& type_ref) \
+    { \
+        return make(*type_ref.raw()); \
+    } \
  \
     rs__macro_make_method_impls(type, __VA_ARGS__) \
  \